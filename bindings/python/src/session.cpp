@@ -1152,7 +1152,7 @@ void bind_session()
         )
         .def("outgoing_ports", depr(&outgoing_ports))
 #endif
-        .def("post_torrent_updates", allow_threads(&lt::session::post_torrent_updates), arg("flags") = 0xffffffff)
+        .def("post_torrent_updates", allow_threads(&lt::session::post_torrent_updates), arg("flags") = status_flags_t::all() & ~torrent_handle::query_memory_usage)
         .def("post_dht_stats", allow_threads(&lt::session::post_dht_stats))
         .def("post_session_stats", allow_threads(&lt::session::post_session_stats))
         .def("is_listening", allow_threads(&lt::session::is_listening))
@@ -488,8 +488,8 @@ void bind_torrent_handle()
         .def("__hash__", (std::size_t (*)(torrent_handle const&))&libtorrent::hash_value)
         .def("get_peer_info", get_peer_info)
         .def("post_peer_info", &torrent_handle::post_peer_info)
-        .def("status", _(&torrent_handle::status), arg("flags") = 0xffffffff)
-        .def("post_status", &torrent_handle::post_status, arg("flags") = 0xffffffff)
+        .def("status", _(&torrent_handle::status), arg("flags") = status_flags_t::all() & ~torrent_handle::query_memory_usage)
+        .def("post_status", &torrent_handle::post_status, arg("flags") = status_flags_t::all() & ~torrent_handle::query_memory_usage)
         .def("get_download_queue", get_download_queue)
         .def("post_download_queue", &torrent_handle::post_download_queue)
         .def("file_progress", file_progress, arg("flags") = file_progress_flags_t{})
@@ -608,6 +608,7 @@ void bind_torrent_handle()
     s.attr("query_last_seen_complete") = torrent_handle::query_last_seen_complete;
     s.attr("query_pieces") = torrent_handle::query_pieces;
     s.attr("query_verified_pieces") = torrent_handle::query_verified_pieces;
+    s.attr("query_memory_usage") = torrent_handle::query_memory_usage;
     }
 
     class_<open_file_state>("open_file_state")
@@ -670,6 +671,7 @@ void bind_torrent_handle()
     s.attr("query_last_seen_complete") = torrent_handle::query_last_seen_complete;
     s.attr("query_pieces") = torrent_handle::query_pieces;
     s.attr("query_verified_pieces") = torrent_handle::query_verified_pieces;
+    s.attr("query_memory_usage") = torrent_handle::query_memory_usage;
 	 }
 
 }
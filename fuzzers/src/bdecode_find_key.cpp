@@ -0,0 +1,58 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "libtorrent/bdecode.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+	lt::span<char const> const buf(reinterpret_cast<char const*>(data), int(size));
+
+	lt::error_code ec;
+	lt::span<char const> const value = lt::bdecode_find_key(buf, "a", ec);
+
+	// whenever the whole buffer is a valid dictionary, looking up a key
+	// without decoding it must agree with bdecode()
+	lt::error_code ec2;
+	lt::bdecode_node const e = lt::bdecode(buf, ec2);
+	if (ec2 || e.type() != lt::bdecode_node::dict_t) return 0;
+	if (ec) __builtin_trap();
+
+	lt::bdecode_node const n = e.dict_find("a");
+	if (!n)
+	{
+		if (!value.empty()) __builtin_trap();
+		return 0;
+	}
+	lt::span<char const> const expected = n.data_section();
+	if (expected.data() != value.data() || expected.size() != value.size())
+		__builtin_trap();
+	return 0;
+}
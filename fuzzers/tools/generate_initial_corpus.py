@@ -8,6 +8,7 @@ corpus_dirs = [
     'torrent_info', 'upnp', 'gzip', 'base32decode', 'base32encode',
     'base64encode', 'bdecode_node', 'convert_from_native', 'convert_to_native',
     'dht_node', 'escape_path', 'escape_string', 'file_storage_add_file',
+    'find_non_digit',
     'http_parser', 'lazy_bdecode', 'parse_int', 'parse_magnet_uri', 'resume_data',
     'sanitize_path', 'utf8_codepoint', 'utp',
     'verify_encoding', 'peer_conn', 'add_torrent', 'idna', 'parse_url', 'http_tracker']
@@ -53,6 +54,25 @@ for i in urls:
     open(os.path.join('corpus', 'parse_url', '%d' % counter), 'w+').write(i)
     counter += 1
 
+# digit runs of every length around the 8 byte words find_non_digit() scans,
+# ending in the delimiters bdecode looks for. Integers near the limits of
+# int64 exercise the overflow checks in parse_int()
+digit_runs = []
+for n in range(0, 25):
+    digits = ''.join(str(i % 10) for i in range(1, n + 1))
+    for end in ['', ':', 'e', 'x', '/', '\x80']:
+        digit_runs.append(digits + end)
+for v in ['9223372036854775807', '9223372036854775808', '99999999999999999999', '-0', '00']:
+    digit_runs.append(v + ':')
+    digit_runs.append('i' + v + 'e')
+    digit_runs.append(v + ':' + 'a' * 8)
+
+counter = 0
+for d in digit_runs:
+    for p in ['find_non_digit', 'parse_int']:
+        open(os.path.join('corpus', p, '%d' % counter), 'w+').write(d)
+    counter += 1
+
 counter = 0
 tracker_fields = ['interval', 'min interval', 'tracker id', 'failure reason',
     'warning message', 'complete', 'incomplete', 'downloaded', 'downloaders', 'external ip']
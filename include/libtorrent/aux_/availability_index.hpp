@@ -0,0 +1,135 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef TORRENT_AVAILABILITY_INDEX_HPP_INCLUDED
+#define TORRENT_AVAILABILITY_INDEX_HPP_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/units.hpp"
+#include "libtorrent/bitfield.hpp"
+#include "libtorrent/aux_/vector.hpp"
+#include "libtorrent/aux_/export.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	// keeps track of how many peers have each piece, with the pieces kept
+	// sorted by that count. Every update is constant time and finding the
+	// rarest piece matching some condition only visits pieces in order of
+	// rarity. Unlike the piece picker, this exists independently of whether
+	// we still need any pieces, which makes it usable for super seeding and
+	// share mode.
+	struct TORRENT_EXTRA_EXPORT availability_index
+	{
+		explicit availability_index(int num_pieces);
+
+		int num_pieces() const { return int(m_order.size()); }
+
+		// a peer announced or lost a single piece
+		void inc(piece_index_t index);
+		void dec(piece_index_t index);
+
+		// a peer with the pieces in the bitfield connected or disconnected
+		void inc(typed_bitfield<piece_index_t> const& bits);
+		void dec(typed_bitfield<piece_index_t> const& bits);
+
+		// a seed connected or disconnected. Seeds are counted separately,
+		// like in the piece picker, to not have to touch every piece
+		void inc_all();
+		void dec_all();
+
+		// the number of peers that have the piece, including seeds
+		int availability(piece_index_t index) const
+		{ return m_count[index] + m_seeds; }
+
+		// returns the piece with the lowest availability, no lower than
+		// min_availability, for which pred returns true. Among pieces that
+		// are equally rare, the search starts at a position derived from
+		// rand. If no piece is accepted by pred, -1 is returned.
+		template <typename Pred>
+		piece_index_t pick_rarest(int const min_availability
+			, std::uint32_t const rand, Pred pred) const
+		{
+			int const first_level = std::max(0, min_availability - m_seeds);
+			for (int level = first_level; level < num_levels(); ++level)
+			{
+				int const begin = m_level_start[std::size_t(level)];
+				int const size = m_level_start[std::size_t(level) + 1] - begin;
+				if (size == 0) continue;
+				int const offset = int(rand % std::uint32_t(size));
+				for (int i = 0; i < size; ++i)
+				{
+					piece_index_t const p = m_order[std::size_t(begin + (offset + i) % size)];
+					if (pred(p)) return p;
+				}
+			}
+			return piece_index_t(-1);
+		}
+
+#if TORRENT_USE_INVARIANT_CHECKS
+		void check_invariant() const;
+#endif
+
+	private:
+
+		int num_levels() const { return int(m_level_start.size()) - 1; }
+
+		// swap the piece with whichever piece is at pos in m_order
+		void move_to(piece_index_t index, int pos);
+
+		// a piece is lost that no peer, other than the seeds, has. Turn one
+		// of the seeds into a regular peer that has every piece
+		void break_one_seed();
+
+		// the number of peers that have each piece, not counting seeds
+		aux::vector<int, piece_index_t> m_count;
+
+		// the position of each piece in m_order
+		aux::vector<int, piece_index_t> m_pos;
+
+		// all pieces, sorted by m_count
+		std::vector<piece_index_t> m_order;
+
+		// the pieces with a count of n are found in m_order in the range
+		// [m_level_start[n], m_level_start[n + 1]). The last element is
+		// always the number of pieces.
+		std::vector<int> m_level_start;
+
+		// the number of peers that have every piece
+		int m_seeds = 0;
+	};
+} }
+
+#endif
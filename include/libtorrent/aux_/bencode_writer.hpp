@@ -0,0 +1,202 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TORRENT_BENCODE_WRITER_HPP_INCLUDED
+#define TORRENT_BENCODE_WRITER_HPP_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/assert.hpp"
+#include "libtorrent/string_view.hpp"
+#include "libtorrent/span.hpp"
+#include "libtorrent/entry.hpp" // for integer_to_str
+
+namespace libtorrent {
+namespace aux {
+
+	// bencode_writer writes bencoded structures straight to an output
+	// iterator, without building an entry tree first. This is meant for
+	// messages and files that are generated on hot paths, where allocating a
+	// node per item (the way entry does) is a significant part of the cost.
+	//
+	// dictionary keys must be written in sorted order, as required by the
+	// bencoding specification. Since there's no tree to sort, this is the
+	// caller's responsibility, and it's asserted in debug builds.
+	//
+	// To encode into a growable buffer, pass a back_insert_iterator::
+	//
+	//	std::vector<char> buf;
+	//	aux::bencode_writer<std::back_insert_iterator<std::vector<char>>> w(std::back_inserter(buf));
+	//	w.begin_dict();
+	//	w.key("a");
+	//	w.int_value(1);
+	//	w.end();
+	template <typename OutIt>
+	struct bencode_writer
+	{
+		explicit bencode_writer(OutIt out) : m_out(std::move(out)) {}
+
+		void begin_dict()
+		{
+			pre_value();
+			put('d');
+#if TORRENT_USE_ASSERTS
+			m_stack.push_back({true, false, {}});
+#endif
+		}
+
+		void begin_list()
+		{
+			pre_value();
+			put('l');
+#if TORRENT_USE_ASSERTS
+			m_stack.push_back({false, false, {}});
+#endif
+		}
+
+		// terminates the innermost dictionary or list
+		void end()
+		{
+#if TORRENT_USE_ASSERTS
+			TORRENT_ASSERT(!m_stack.empty());
+			// a key without a value
+			TORRENT_ASSERT(!m_stack.back().expect_value);
+			m_stack.pop_back();
+#endif
+			put('e');
+		}
+
+		// writes a dictionary key. Must be followed by exactly one value
+		// (int, string, list or dictionary). Keys must be strictly increasing,
+		// compared as raw byte strings
+		void key(string_view const k)
+		{
+#if TORRENT_USE_ASSERTS
+			TORRENT_ASSERT(!m_stack.empty());
+			frame& f = m_stack.back();
+			TORRENT_ASSERT(f.dict);
+			TORRENT_ASSERT(!f.expect_value);
+			TORRENT_ASSERT(f.num_keys == 0 || f.last_key < k);
+			f.last_key.assign(k.data(), k.size());
+			f.expect_value = true;
+			++f.num_keys;
+#endif
+			put_string(k);
+		}
+
+		void int_value(std::int64_t const v)
+		{
+			pre_value();
+			put('i');
+			put_integer(v);
+			put('e');
+		}
+
+		void string_value(string_view const s)
+		{
+			pre_value();
+			put_string(s);
+		}
+
+		// writes an already bencoded value as-is
+		void preformatted_value(span<char const> const buf)
+		{
+			pre_value();
+			for (char const c : buf) put(c);
+		}
+
+		// the number of bytes written so far
+		int size() const { return m_size; }
+
+	private:
+
+		void pre_value()
+		{
+#if TORRENT_USE_ASSERTS
+			if (m_stack.empty())
+			{
+				// only a single top-level item is allowed
+				TORRENT_ASSERT(m_size == 0);
+				return;
+			}
+			frame& f = m_stack.back();
+			TORRENT_ASSERT(!f.dict || f.expect_value);
+			f.expect_value = false;
+#endif
+		}
+
+		void put(char const c)
+		{
+			*m_out = c;
+			++m_out;
+			++m_size;
+		}
+
+		void put_integer(std::int64_t const v)
+		{
+			std::array<char, 21> buf;
+			for (char const c : integer_to_str(buf, v)) put(c);
+		}
+
+		void put_string(string_view const s)
+		{
+			put_integer(std::int64_t(s.size()));
+			put(':');
+			for (char const c : s) put(c);
+		}
+
+		OutIt m_out;
+		int m_size = 0;
+
+#if TORRENT_USE_ASSERTS
+		struct frame
+		{
+			bool dict;
+			bool expect_value;
+			std::string last_key;
+			int num_keys = 0;
+		};
+		std::vector<frame> m_stack;
+#endif
+	};
+
+	template <typename OutIt>
+	bencode_writer<OutIt> make_bencode_writer(OutIt out)
+	{ return bencode_writer<OutIt>(std::move(out)); }
+}
+}
+
+#endif
@@ -0,0 +1,280 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TORRENT_INDEXED_QUEUE_HPP_INCLUDED
+#define TORRENT_INDEXED_QUEUE_HPP_INCLUDED
+
+#include <cstdint>
+#include <iterator>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/assert.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	// the intrusive node for an element in an indexed_queue. The owner of
+	// the element embeds one of these and passes it to the queue.
+	template <typename T>
+	struct queue_node
+	{
+		explicit queue_node(T* v) : value(v) {}
+		queue_node(queue_node const&) = delete;
+		queue_node& operator=(queue_node const&) = delete;
+
+		bool in_queue() const { return size > 0; }
+
+		T* value;
+		queue_node* left = nullptr;
+		queue_node* right = nullptr;
+		queue_node* parent = nullptr;
+		std::uint32_t priority = 0;
+
+		// the number of nodes in the subtree rooted at this node. 0 means this
+		// node is not in a queue
+		int size = 0;
+	};
+
+	// indexed_queue is an ordered sequence of elements, where the position
+	// of an element, the element at a position, inserting at a position and
+	// removing an element are all O(log n). It's a treap keyed implicitly
+	// by position, where each node keeps the size of its subtree.
+	//
+	// This is used for the download queue, where moving one torrent to the
+	// top of the queue would otherwise shift the position of every torrent
+	// in front of it. Here, the positions of the other elements change
+	// implicitly.
+	template <typename T>
+	struct indexed_queue
+	{
+		using node = queue_node<T>;
+
+		struct const_iterator
+		{
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = T* const*;
+			using reference = T* const&;
+
+			const_iterator() = default;
+			explicit const_iterator(node const* n) : m_node(n) {}
+
+			reference operator*() const { return m_node->value; }
+			const_iterator& operator++() { m_node = next(m_node); return *this; }
+			const_iterator operator++(int)
+			{ const_iterator ret(*this); m_node = next(m_node); return ret; }
+
+			bool operator==(const_iterator const& rhs) const { return m_node == rhs.m_node; }
+			bool operator!=(const_iterator const& rhs) const { return m_node != rhs.m_node; }
+		private:
+			node const* m_node = nullptr;
+		};
+
+		indexed_queue() = default;
+		indexed_queue(indexed_queue const&) = delete;
+		indexed_queue& operator=(indexed_queue const&) = delete;
+
+		int size() const { return subtree_size(m_root); }
+		bool empty() const { return m_root == nullptr; }
+
+		const_iterator begin() const
+		{
+			node const* n = m_root;
+			if (n == nullptr) return end();
+			while (n->left) n = n->left;
+			return const_iterator(n);
+		}
+		const_iterator end() const { return const_iterator(); }
+
+		// inserts n before the element at ``pos``. A position at or past the
+		// end appends it
+		void insert(node& n, int pos)
+		{
+			TORRENT_ASSERT(!n.in_queue());
+			TORRENT_ASSERT(pos >= 0);
+			if (pos > size()) pos = size();
+
+			// xorshift32. The priorities only need to be spread out to keep
+			// the tree balanced
+			m_seed ^= m_seed << 13;
+			m_seed ^= m_seed >> 17;
+			m_seed ^= m_seed << 5;
+
+			n.left = nullptr;
+			n.right = nullptr;
+			n.parent = nullptr;
+			n.priority = m_seed;
+			n.size = 1;
+
+			node* l;
+			node* r;
+			split(m_root, pos, l, r);
+			set_root(merge(merge(l, &n), r));
+		}
+
+		void erase(node& n)
+		{
+			TORRENT_ASSERT(n.in_queue());
+			node* l;
+			node* m;
+			node* r;
+			split(m_root, position(n), l, r);
+			split(r, 1, m, r);
+			TORRENT_ASSERT(m == &n);
+			TORRENT_UNUSED(m);
+			set_root(merge(l, r));
+
+			n.left = nullptr;
+			n.right = nullptr;
+			n.parent = nullptr;
+			n.size = 0;
+		}
+
+		// moves n to ``pos``, counted after n has been removed, i.e. a
+		// position past the end moves it to the back
+		void move(node& n, int const pos)
+		{
+			erase(n);
+			insert(n, pos);
+		}
+
+		// returns the position of n in the queue it belongs to. This only
+		// depends on the node, not on the queue
+		static int position(node const& n)
+		{
+			TORRENT_ASSERT(n.in_queue());
+			int ret = subtree_size(n.left);
+			for (node const* c = &n; c->parent != nullptr; c = c->parent)
+			{
+				if (c->parent->right == c)
+					ret += subtree_size(c->parent->left) + 1;
+			}
+			return ret;
+		}
+
+		T* operator[](int pos) const
+		{
+			TORRENT_ASSERT(pos >= 0);
+			TORRENT_ASSERT(pos < size());
+			node const* n = m_root;
+			for (;;)
+			{
+				int const left = subtree_size(n->left);
+				if (pos < left) n = n->left;
+				else if (pos == left) return n->value;
+				else
+				{
+					pos -= left + 1;
+					n = n->right;
+				}
+			}
+		}
+
+	private:
+
+		static int subtree_size(node const* n) { return n ? n->size : 0; }
+
+		static node const* next(node const* n)
+		{
+			if (n->right)
+			{
+				n = n->right;
+				while (n->left) n = n->left;
+				return n;
+			}
+			while (n->parent && n->parent->right == n) n = n->parent;
+			return n->parent;
+		}
+
+		static void update(node* n)
+		{
+			n->size = 1 + subtree_size(n->left) + subtree_size(n->right);
+			if (n->left) n->left->parent = n;
+			if (n->right) n->right->parent = n;
+		}
+
+		void set_root(node* n)
+		{
+			m_root = n;
+			if (n) n->parent = nullptr;
+		}
+
+		// splits the tree rooted at t into its first ``pos`` nodes, l, and
+		// the rest, r
+		static void split(node* t, int const pos, node*& l, node*& r)
+		{
+			if (t == nullptr)
+			{
+				l = nullptr;
+				r = nullptr;
+				return;
+			}
+			int const left = subtree_size(t->left);
+			if (pos <= left)
+			{
+				split(t->left, pos, l, t->left);
+				r = t;
+			}
+			else
+			{
+				split(t->right, pos - left - 1, t->right, r);
+				l = t;
+			}
+			update(t);
+			if (l) l->parent = nullptr;
+			if (r) r->parent = nullptr;
+		}
+
+		// concatenates the sequences in a and b
+		static node* merge(node* a, node* b)
+		{
+			if (a == nullptr) return b;
+			if (b == nullptr) return a;
+			if (a->priority > b->priority)
+			{
+				a->right = merge(a->right, b);
+				update(a);
+				return a;
+			}
+			b->left = merge(a, b->left);
+			update(b);
+			return b;
+		}
+
+		node* m_root = nullptr;
+		std::uint32_t m_seed = 0x9e3779b9;
+	};
+}
+}
+
+#endif
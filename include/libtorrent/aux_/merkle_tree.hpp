@@ -98,6 +98,9 @@ struct TORRENT_EXTRA_EXPORT merkle_tree
 	std::size_t size() const;
 	int end_index() const { return int(size()); }
 
+	// an estimate of the number of bytes of heap memory used by this tree
+	std::int64_t memory_usage() const;
+
 	bool has_node(int idx) const;
 
 	bool compare_node(int idx, sha256_hash const& h) const;
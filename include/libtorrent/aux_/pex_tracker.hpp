@@ -0,0 +1,228 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef TORRENT_PEX_TRACKER_HPP_INCLUDED
+#define TORRENT_PEX_TRACKER_HPP_INCLUDED
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/socket.hpp"
+#include "libtorrent/socket_io.hpp"
+#include "libtorrent/pex_flags.hpp"
+#include "libtorrent/string_view.hpp"
+#include "libtorrent/aux_/io.hpp"
+#include "libtorrent/aux_/ip_helpers.hpp" // for is_v4
+#include "libtorrent/aux_/bencode_writer.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	// an encoded PEX message, shared by all peers it's sent to
+	using pex_msg_t = std::shared_ptr<std::vector<char> const>;
+
+	// keeps track of which peers a torrent has advertised over ut_pex and
+	// builds the messages. Peers are added and dropped as they connect and
+	// disconnect, so building a message only looks at the peers that changed
+	// since the last one. Connection is only used as a key.
+	template <typename Connection>
+	struct pex_tracker
+	{
+		// the most peers included in a single message. The remaining peers
+		// are included in the next one
+		static constexpr int max_peer_entries = 100;
+
+		struct advertised_peer
+		{
+			tcp::endpoint ep;
+			pex_flags_t flags;
+		};
+
+		void peer_connected(Connection const* p)
+		{
+			m_pending.insert(p);
+		}
+
+		void peer_disconnected(Connection const* p)
+		{
+			if (m_pending.erase(p) > 0) return;
+			auto const i = m_advertised.find(p);
+			if (i == m_advertised.end()) return;
+			m_dropped.push_back(i->second.ep);
+			m_advertised.erase(i);
+		}
+
+		// builds the diff against the previous message and, if the set of
+		// advertised peers changed, the full message. describe(p, ap) fills
+		// in how to advertise p, or returns false if p can't be advertised
+		// yet.
+		template <typename Describe>
+		void update(Describe describe)
+		{
+			std::string pla, plf, pla6, plf6;
+			std::string pld, pld6;
+			auto pla_out = std::back_inserter(pla);
+			auto plf_out = std::back_inserter(plf);
+			auto pla6_out = std::back_inserter(pla6);
+			auto plf6_out = std::back_inserter(plf6);
+			auto pld_out = std::back_inserter(pld);
+			auto pld6_out = std::back_inserter(pld6);
+
+			m_peers_in_message = 0;
+			int num_added = 0;
+			for (auto i = m_pending.begin(); i != m_pending.end();)
+			{
+				if (num_added >= max_peer_entries) break;
+
+				Connection const* p = *i;
+				advertised_peer ap;
+				if (!describe(*p, ap))
+				{
+					++i;
+					continue;
+				}
+
+				if (aux::is_v4(ap.ep))
+				{
+					aux::write_endpoint(ap.ep, pla_out);
+					aux::write_uint8(static_cast<std::uint8_t>(ap.flags), plf_out);
+				}
+				else
+				{
+					aux::write_endpoint(ap.ep, pla6_out);
+					aux::write_uint8(static_cast<std::uint8_t>(ap.flags), plf6_out);
+				}
+				m_advertised.emplace(p, ap);
+				i = m_pending.erase(i);
+				++num_added;
+				++m_peers_in_message;
+			}
+
+			for (auto const& ep : m_dropped)
+			{
+				if (aux::is_v4(ep))
+					aux::write_endpoint(ep, pld_out);
+				else
+					aux::write_endpoint(ep, pld6_out);
+				++m_peers_in_message;
+			}
+			bool const any_dropped = !m_dropped.empty();
+			m_dropped.clear();
+
+			m_diff_msg = encode_msg(pla, plf, pla6, plf6, pld, pld6);
+
+			// the full message is sent to peers the first time, it must not
+			// include peers that have disconnected
+			if (num_added == 0 && !any_dropped && m_full_msg) return;
+
+			pla.clear();
+			plf.clear();
+			pla6.clear();
+			plf6.clear();
+			int num_full = 0;
+			for (auto const& ap : m_advertised)
+			{
+				if (num_full >= max_peer_entries) break;
+				if (aux::is_v4(ap.second.ep))
+				{
+					aux::write_endpoint(ap.second.ep, pla_out);
+					aux::write_uint8(static_cast<std::uint8_t>(ap.second.flags), plf_out);
+				}
+				else
+				{
+					aux::write_endpoint(ap.second.ep, pla6_out);
+					aux::write_uint8(static_cast<std::uint8_t>(ap.second.flags), plf6_out);
+				}
+				++num_full;
+			}
+			// leave the dropped strings empty
+			m_full_msg = encode_msg(pla, plf, pla6, plf6, {}, {});
+		}
+
+		// the diff since the previous message
+		pex_msg_t const& diff_msg() const { return m_diff_msg; }
+
+		// all the peers we advertised as of the last diff message. This is
+		// what's sent to peers the first time. Subsequent diffs are relative
+		// to this
+		pex_msg_t const& full_msg() const { return m_full_msg; }
+
+		// the number of peers added or dropped by the diff message
+		int peers_in_msg() const { return m_peers_in_message; }
+
+	private:
+
+		static pex_msg_t encode_msg(string_view added, string_view added_f
+			, string_view added6, string_view added6_f
+			, string_view dropped, string_view dropped6)
+		{
+			auto msg = std::make_shared<std::vector<char>>();
+			auto w = aux::make_bencode_writer(std::back_inserter(*msg));
+			w.begin_dict();
+			w.key("added");
+			w.string_value(added);
+			w.key("added.f");
+			w.string_value(added_f);
+			w.key("added6");
+			w.string_value(added6);
+			w.key("added6.f");
+			w.string_value(added6_f);
+			w.key("dropped");
+			w.string_value(dropped);
+			w.key("dropped6");
+			w.string_value(dropped6);
+			w.end();
+			return msg;
+		}
+
+		// connections we haven't advertised yet. Either because they
+		// connected since the last message was built, or because they
+		// couldn't be advertised yet
+		std::unordered_set<Connection const*> m_pending;
+
+		// connections we have advertised, and how we advertised them
+		std::unordered_map<Connection const*, advertised_peer> m_advertised;
+
+		// advertised peers that have disconnected since the last message
+		std::vector<tcp::endpoint> m_dropped;
+
+		pex_msg_t m_diff_msg;
+		pex_msg_t m_full_msg;
+		int m_peers_in_message = 0;
+	};
+} }
+
+#endif
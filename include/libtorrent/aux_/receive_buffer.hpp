@@ -41,14 +41,42 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/numeric_cast.hpp"
 
 #include <climits>
+#include <vector>
 
 namespace libtorrent {
 namespace aux {
 
+// a free-list of small receive buffers, shared by all peer connections of a
+// session. A connection borrows one when its socket becomes readable and
+// hands it back once it's at a message boundary with nothing buffered. This
+// makes receive buffer memory scale with the number of active connections,
+// rather than all of them. Connections that receive large messages grow out
+// of the pooled buffer into one of their own.
+struct TORRENT_EXTRA_EXPORT receive_buffer_pool
+{
+	// the requested size of pooled buffers
+	static constexpr int buffer_size = 1024;
+
+	// the max number of unused buffers to hold on to
+	static constexpr int max_free = 512;
+
+	buffer borrow();
+	void give_back(buffer b);
+
+	// the number of unused buffers currently held by the pool
+	int num_free() const { return int(m_free.size()); }
+
+private:
+	std::vector<buffer> m_free;
+};
+
 struct TORRENT_EXTRA_EXPORT receive_buffer
 {
 	friend struct crypto_receive_buffer;
 
+	receive_buffer() = default;
+	explicit receive_buffer(receive_buffer_pool* pool) : m_pool(pool) {}
+
 	// explicitly disallow assignment, to silence msvc warning
 	receive_buffer& operator=(receive_buffer const&) = delete;
 
@@ -109,8 +137,21 @@ struct TORRENT_EXTRA_EXPORT receive_buffer
 	void normalize(int force_shrink = 0);
 	bool normalized() const { return m_recv_start == 0; }
 
+	// true if there are no received bytes in the buffer, and we're at the
+	// start of a packet
+	bool empty() const { return m_recv_end == 0 && m_recv_pos == 0; }
+
 	void reset(int packet_size);
 
+	// frees the underlying buffer, or hands it back to the pool it was
+	// borrowed from. This may only be called when there are no buffered
+	// bytes. The next call to reserve() allocates (or borrows) a new one.
+	// This is used to not hold on to memory for idle connections
+	void release();
+
+	// true if the current buffer is borrowed from a receive_buffer_pool
+	bool pooled() const { return m_pooled; }
+
 #if TORRENT_USE_INVARIANT_CHECKS
 	void check_invariant() const
 	{
@@ -161,7 +202,17 @@ private:
 	// enough of it we shrink it
 	sliding_average<std::ptrdiff_t, 20> m_watermark;
 
+	// replaces m_recv_buffer, handing the old one back to the pool if it was
+	// borrowed
+	void replace_buffer(buffer b);
+
 	buffer m_recv_buffer;
+
+	// if set, small buffers are borrowed from here, rather than allocated
+	receive_buffer_pool* m_pool = nullptr;
+
+	// true if m_recv_buffer was borrowed from m_pool
+	bool m_pooled = false;
 };
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
@@ -36,8 +36,12 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "libtorrent/config.hpp"
 #include "libtorrent/aux_/session_impl.hpp"
+#include "libtorrent/error_code.hpp"
 
 #include <functional>
+#include <exception>
+#include <new> // for bad_alloc
+#include <utility>
 
 namespace libtorrent { namespace aux {
 
@@ -46,6 +50,71 @@ void dump_call_profile();
 
 void torrent_wait(bool& done, aux::session_impl& ses);
 
+// the completion handler of one of the async_* calls on session_handle
+// and torrent_handle. The handler is called exactly once. If this object
+// is destroyed before that, because the session shut down before the
+// call could run, the handler is called with operation_aborted
+template <typename Ret>
+struct completion_handler
+{
+	using handler_type = std::function<void(error_code const&, Ret)>;
+
+	explicit completion_handler(handler_type h) : m_handler(std::move(h)) {}
+	completion_handler(completion_handler&& rhs) noexcept
+		: m_handler(std::move(rhs.m_handler))
+	{ rhs.m_handler = nullptr; }
+	completion_handler(completion_handler const&) = delete;
+	completion_handler& operator=(completion_handler const&) = delete;
+	completion_handler& operator=(completion_handler&&) = delete;
+
+	~completion_handler()
+	{
+		if (!m_handler) return;
+#ifndef BOOST_NO_EXCEPTIONS
+		try {
+#endif
+			complete(boost::asio::error::operation_aborted, Ret{});
+#ifndef BOOST_NO_EXCEPTIONS
+		} catch (...) {}
+#endif
+	}
+
+	// calls f() and passes its result to the handler. If f() throws, the
+	// handler is passed the error instead. Exceptions thrown by the
+	// handler itself are not caught
+	template <typename Fun>
+	void call(Fun&& f)
+	{
+		error_code ec;
+		Ret r{};
+#ifndef BOOST_NO_EXCEPTIONS
+		try {
+#endif
+			r = f();
+#ifndef BOOST_NO_EXCEPTIONS
+		} catch (system_error const& e) {
+			ec = e.code();
+		} catch (std::bad_alloc const&) {
+			ec = make_error_code(boost::system::errc::not_enough_memory);
+		} catch (std::exception const&) {
+			ec = make_error_code(boost::system::errc::invalid_argument);
+		}
+#endif
+		complete(ec, std::move(r));
+	}
+
+	void complete(error_code const& ec, Ret r)
+	{
+		TORRENT_ASSERT(m_handler);
+		handler_type h = std::move(m_handler);
+		m_handler = nullptr;
+		h(ec, std::move(r));
+	}
+
+private:
+	handler_type m_handler;
+};
+
 } } // namespace aux namespace libtorrent
 
 #endif // TORRENT_SESSION_CALL_HPP_INCLUDED
@@ -50,6 +50,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/allocating_handler.hpp"
 #include "libtorrent/aux_/time.hpp"
 #include "libtorrent/aux_/torrent_list.hpp"
+#include "libtorrent/aux_/indexed_queue.hpp"
+#include "libtorrent/aux_/receive_buffer.hpp"
 #include "libtorrent/session_params.hpp" // for disk_io_constructor_type
 
 #ifdef TORRENT_SSL_PEERS
@@ -103,6 +105,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <vector>
 #include <set>
+#include <map>
 #include <list>
 #include <deque>
 #include <condition_variable>
@@ -351,7 +354,8 @@ namespace aux {
 				plugins_optimistic_unchoke_idx = 1, // optimistic_unchoke_feature
 				plugins_tick_idx = 2, // tick_feature
 				plugins_dht_request_idx = 3, // dht_request_feature
-				plugins_unknown_torrent_idx = 4 // unknown_torrent_feature
+				plugins_unknown_torrent_idx = 4, // unknown_torrent_feature
+				plugins_unchoke_idx = 5 // unchoke_feature
 			};
 
 			template <typename Fun, typename... Args>
@@ -467,6 +471,8 @@ namespace aux {
 			std::shared_ptr<torrent> delay_load_torrent(info_hash_t const& info_hash
 				, peer_connection* pc) override;
 			void set_queue_position(torrent*, queue_position_t) override;
+			void insert_queued_seed(torrent* t, int rank) override;
+			void erase_queued_seed(torrent* t, int rank) override;
 
 			void close_connection(peer_connection* p) noexcept override;
 
@@ -545,7 +551,8 @@ namespace aux {
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
 			torrent const* find_encrypted_torrent(
-				sha1_hash const& info_hash, sha1_hash const& xor_mask) override;
+				sha1_hash const& info_hash, sha1_hash const& xor_mask
+				, protocol_version& v) override;
 #endif
 
 			void on_lsd_announce(error_code const& e);
@@ -670,6 +677,16 @@ namespace aux {
 			// ``num_peers_half_open`` instead.
 			int num_connections() const override { return int(m_connections.size()); }
 
+			int num_web_seed_connections(std::string const& host, int port) const override;
+			void inc_web_seed_connections(std::string const& host, int port, int delta) override;
+
+			void cache_metadata(info_hash_t const& ih, span<char const> info_section) override;
+
+			// returns a torrent_info built from the metadata cache, for the
+			// torrent with the specified info-hashes. Returns nullptr if it's
+			// not in the cache
+			std::shared_ptr<torrent_info> cached_metadata(info_hash_t const& ih);
+
 			void trigger_unchoke() noexcept override
 			{
 				TORRENT_ASSERT(is_single_thread());
@@ -806,6 +823,7 @@ namespace aux {
 			bool has_lsd() const override;
 
 			std::vector<block_info>& block_info_storage() override { return m_block_info_storage; }
+			aux::receive_buffer_pool& recv_buffer_pool() override { return m_recv_buffer_pool; }
 
 			libtorrent::aux::utp_socket_manager* utp_socket_manager() override
 			{ return &m_utp_socket_manager; }
@@ -858,6 +876,9 @@ namespace aux {
 
 			void update_socket_buffer_size();
 			void update_dht_announce_interval();
+			void update_metadata_cache_size();
+			void update_seed_rank_limits();
+			void update_shed_peer_list_timeout();
 			void update_download_rate();
 			void update_upload_rate();
 			void update_connections_limit();
@@ -903,6 +924,10 @@ namespace aux {
 			// by torrent::get_download_queue.
 			std::vector<block_info> m_block_info_storage;
 
+			// small receive buffers lent to peer connections while they
+			// receive a message
+			aux::receive_buffer_pool m_recv_buffer_pool;
+
 			io_context& m_io_context;
 
 #if TORRENT_USE_SSL
@@ -975,7 +1000,24 @@ namespace aux {
 
 			// all torrents that are downloading or queued,
 			// ordered by their queue position
-			aux::vector<torrent*, queue_position_t> m_download_queue;
+			aux::indexed_queue<torrent> m_download_queue;
+
+			// a seed and its seed rank. Ordered by highest rank first
+			using ranked_seed = std::pair<int, torrent*>;
+			struct higher_seed_rank
+			{
+				bool operator()(ranked_seed const& lhs, ranked_seed const& rhs) const
+				{
+					if (lhs.first != rhs.first) return lhs.first > rhs.first;
+					return std::less<torrent*>()(lhs.second, rhs.second);
+				}
+			};
+
+			// all paused, auto-managed seeds, ordered by seed rank. The rank
+			// of a paused torrent doesn't change with time, so it's only
+			// updated when anything it depends on changes. This is the order
+			// the auto-manager starts seeds in
+			std::set<ranked_seed, higher_seed_rank> m_queued_seeds;
 
 			// peer connections are put here when disconnected to avoid
 			// race conditions with the disk thread. It's important that
@@ -994,6 +1036,26 @@ namespace aux {
 			// peers.
 			connection_map m_connections;
 
+			// the number of web seed connections open to each host and port,
+			// across all torrents. Entries are removed when they drop to zero
+			std::map<std::pair<std::string, int>, int> m_web_seed_connections;
+
+			// info-dictionaries of torrents that downloaded their metadata. The
+			// least recently used entry is first. The total size of the buffers
+			// is kept within settings_pack::metadata_cache_size
+			struct cached_info_section
+			{
+				info_hash_t info_hashes;
+				std::vector<char> buf;
+			};
+			std::vector<cached_info_section> m_metadata_cache;
+			std::int64_t m_metadata_cache_bytes = 0;
+
+			// when the torrent memory budget could not be reached by trimming
+			// peer lists, this is the usage (plus some slack) that has to be
+			// exceeded before trying again. 0 when the last trim succeeded
+			std::int64_t m_memory_budget_retry = 0;
+
 #ifdef TORRENT_SSL_PEERS
 			// this list holds incoming connections while they
 			// are performing SSL handshake. When we shut down
@@ -1107,11 +1169,29 @@ namespace aux {
 
 			void on_tick(error_code const& e);
 
+			// re-publish the status snapshot of all torrents on the
+			// torrent_snapshot_updates list
+			void publish_status_snapshots();
+
+			// if the memory used by torrents exceeds
+			// settings_pack::torrent_memory_budget, trim peer lists until
+			// it's below the low-water mark of the budget
+			void enforce_torrent_memory_budget();
+
+			// shed the peer lists of the torrents on the
+			// torrent_want_shed_peer_list list that have been idle for long
+			// enough
+			void shed_idle_peer_lists();
+
 			void try_connect_more_peers();
 			void auto_manage_checking_torrents(std::vector<torrent*>& list
 				, int& limit);
-			void auto_manage_torrents(std::vector<torrent*>& list
+			void auto_manage_torrent(torrent& t
 				, int& dht_limit, int& tracker_limit
+				, int& lsd_limit, int& hard_limit, int& type_limit);
+			void auto_manage_downloaders(int& dht_limit, int& tracker_limit
+				, int& lsd_limit, int& hard_limit, int type_limit);
+			void auto_manage_seeds(int& dht_limit, int& tracker_limit
 				, int& lsd_limit, int& hard_limit, int type_limit);
 			void recalculate_auto_managed_torrents();
 			void recalculate_unchoke_slots();
@@ -1332,7 +1412,7 @@ namespace aux {
 
 #ifndef TORRENT_DISABLE_EXTENSIONS
 			// this is a list to allow extensions to potentially remove themselves.
-			std::array<std::vector<std::shared_ptr<plugin>>, 5> m_ses_extensions;
+			std::array<std::vector<std::shared_ptr<plugin>>, 6> m_ses_extensions;
 #endif
 
 #if TORRENT_ABI_VERSION == 1
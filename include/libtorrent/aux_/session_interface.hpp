@@ -74,6 +74,7 @@ namespace libtorrent {
 
 namespace aux {
 	struct utp_socket_manager;
+	struct receive_buffer_pool;
 	struct bandwidth_channel;
 	struct bandwidth_manager;
 	struct resolver_interface;
@@ -184,11 +185,25 @@ namespace aux {
 		virtual void update_torrent_info_hash(std::shared_ptr<torrent> const& t
 			, info_hash_t const& old_ih) = 0;
 		virtual void set_queue_position(torrent* t, queue_position_t p) = 0;
+
+		// paused, auto-managed seeds are kept ordered by seed rank, see
+		// torrent::update_seed_order()
+		virtual void insert_queued_seed(torrent* t, int rank) = 0;
+		virtual void erase_queued_seed(torrent* t, int rank) = 0;
 		virtual int num_torrents() const = 0;
 
 		virtual void close_connection(peer_connection* p) noexcept = 0;
 		virtual int num_connections() const = 0;
 
+		// the number of web seed connections, across all torrents, to the
+		// specified host and port
+		virtual int num_web_seed_connections(std::string const& host, int port) const = 0;
+		virtual void inc_web_seed_connections(std::string const& host, int port, int delta) = 0;
+
+		// remembers the (verified) info-dictionary of a torrent that
+		// downloaded its metadata, in case the same torrent is added again
+		virtual void cache_metadata(info_hash_t const& ih, span<char const> info_section) = 0;
+
 		virtual void deferred_submit_jobs() = 0;
 
 		virtual std::uint16_t listen_port() const = 0;
@@ -270,7 +285,22 @@ namespace aux {
 		static constexpr torrent_list_index_t torrent_seeding_auto_managed{6};
 		static constexpr torrent_list_index_t torrent_checking_auto_managed{7};
 
-		static constexpr std::size_t num_torrent_lists = 8;
+			// torrents whose status snapshot (see
+			// torrent_handle::status_snapshot()) is out of date. These are
+			// re-published on the next session tick
+		static constexpr torrent_list_index_t torrent_snapshot_updates{8};
+
+			// paused, auto-managed and finished torrents that will shed
+			// their peer lists once they've been idle for
+			// settings_pack::shed_peer_list_timeout seconds
+		static constexpr torrent_list_index_t torrent_want_shed_peer_list{9};
+
+			// the torrents on the downloading and seeding auto-managed lists
+			// that are not paused. When recalculating which torrents to
+			// start, these are the only ones that may need to be paused
+		static constexpr torrent_list_index_t torrent_started_auto_managed{10};
+
+		static constexpr std::size_t num_torrent_lists = 11;
 
 		virtual aux::vector<torrent*>& torrent_list(torrent_list_index_t i) = 0;
 
@@ -279,6 +309,7 @@ namespace aux {
 		virtual libtorrent::aux::utp_socket_manager* utp_socket_manager() = 0;
 		virtual void inc_boost_connections() = 0;
 		virtual std::vector<block_info>& block_info_storage() = 0;
+		virtual aux::receive_buffer_pool& recv_buffer_pool() = 0;
 
 #ifdef TORRENT_SSL_PEERS
 		virtual libtorrent::aux::utp_socket_manager* ssl_utp_socket_manager() = 0;
@@ -288,8 +319,10 @@ namespace aux {
 #endif
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
+		// v is set to the protocol version of the info-hash that matched
 		virtual torrent const* find_encrypted_torrent(
-			sha1_hash const& info_hash, sha1_hash const& xor_mask) = 0;
+			sha1_hash const& info_hash, sha1_hash const& xor_mask
+			, protocol_version& v) = 0;
 #endif
 
 #ifndef TORRENT_DISABLE_DHT
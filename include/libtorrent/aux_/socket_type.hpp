@@ -94,6 +94,35 @@ namespace aux {
 
 	// properly shuts down SSL sockets. holder keeps s alive
 	void async_shutdown(socket_type& s, std::shared_ptr<void> holder);
+
+	// returns true if the socket can notify us when it becomes readable,
+	// without posting a receive buffer. This is only supported by plain TCP
+	// and uTP sockets. Streams that may buffer data internally (SSL and
+	// proxies) must always be read from
+	bool can_wait_read(socket_type const& s);
+
+	// invokes the handler with an error_code once the socket has bytes to
+	// read (or fails). s must satisfy can_wait_read()
+	template <typename Handler>
+	void async_wait_read(socket_type& s, Handler handler)
+	{
+#if !defined TORRENT_BUILD_SIMULATOR
+		if (auto* t = boost::get<tcp::socket>(&s))
+		{
+			t->async_wait(tcp::socket::wait_read, std::move(handler));
+			return;
+		}
+		if (auto* u = boost::get<utp_stream>(&s))
+		{
+			u->async_wait_read([h = std::move(handler)](error_code const& ec, std::size_t) mutable
+				{ h(ec); });
+			return;
+		}
+#endif
+		TORRENT_UNUSED(s);
+		TORRENT_UNUSED(handler);
+		TORRENT_ASSERT_FAIL();
+	}
 }
 }
 
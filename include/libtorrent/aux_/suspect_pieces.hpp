@@ -0,0 +1,248 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef TORRENT_SUSPECT_PIECES_HPP_INCLUDED
+#define TORRENT_SUSPECT_PIECES_HPP_INCLUDED
+
+#include <list>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/sha1_hash.hpp"
+#include "libtorrent/units.hpp"
+#include "libtorrent/assert.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	// the block hashes of pieces that have failed the hash check, used by
+	// the smart_ban plugin to find the peers that sent bad data. The total
+	// number of hashes kept is bounded. When more pieces fail, the least
+	// recently failed ones are evicted. Peer identifies who sent a block and
+	// needs to be equality comparable.
+	template <typename Peer>
+	struct suspect_pieces
+	{
+		// this ties a specific block hash to the peer that sent it
+		struct block_record
+		{
+			Peer peer;
+			sha1_hash digest;
+			int block;
+		};
+
+		explicit suspect_pieces(int const max_records)
+			: m_max_records(max_records)
+		{}
+
+		// returns true if the piece has failed the hash check and not
+		// passed yet. The blocks of such pieces need to be hashed as they're
+		// received
+		bool is_suspect(piece_index_t const p) const
+		{ return m_pieces.find(p) != m_pieces.end(); }
+
+		// records the hash of a block received for the current attempt at
+		// downloading a suspect piece
+		void block_received(piece_index_t const p, block_record const& rec)
+		{
+			auto const i = m_pieces.find(p);
+			if (i == m_pieces.end()) return;
+			i->second.received.push_back(rec);
+			++m_num_records;
+			trim();
+		}
+
+		// the piece failed the hash check. The hashes recorded as this
+		// attempt's blocks were received are now known to (in part) be bad.
+		// ban(block_record, sha1_hash) is called for any peer that sent
+		// different data for the same block in two failed attempts, at least
+		// one of them must have been bad. Returns the blocks that weren't
+		// hashed as they were received. Their data has to be read back and
+		// passed to failed_block()
+		template <typename Ban>
+		std::vector<bool> piece_failed(piece_index_t const p, int const num_blocks
+			, Ban const& ban)
+		{
+			std::vector<bool> read_back(std::size_t(num_blocks), true);
+			auto i = m_pieces.find(p);
+			if (i == m_pieces.end())
+			{
+				i = m_pieces.emplace(p, suspect_piece{}).first;
+				m_lru.push_front(p);
+				i->second.lru = m_lru.begin();
+				return read_back;
+			}
+
+			m_lru.splice(m_lru.begin(), m_lru, i->second.lru);
+
+			std::vector<block_record> received;
+			received.swap(i->second.received);
+			m_num_records -= int(received.size());
+			for (block_record const& rec : received)
+			{
+				if (rec.block >= 0 && rec.block < num_blocks)
+					read_back[std::size_t(rec.block)] = false;
+				add_failed(i->second, rec, ban);
+			}
+			trim();
+			return read_back;
+		}
+
+		// records a block of a failed attempt, read back after the fact
+		template <typename Ban>
+		void failed_block(piece_index_t const p, block_record const& rec
+			, Ban const& ban)
+		{
+			auto const i = m_pieces.find(p);
+			if (i == m_pieces.end()) return;
+			add_failed(i->second, rec, ban);
+			trim();
+		}
+
+		// the piece passed the hash check. Compares the block hashes from
+		// the failed attempts against the hashes of the blocks that made the
+		// piece pass and calls ban(block_record, sha1_hash) with every
+		// record of a bad block and the good hash. Failed blocks whose
+		// passing data wasn't hashed on receive are returned, to be compared
+		// against the data read back from disk
+		template <typename Ban>
+		std::vector<block_record> piece_passed(piece_index_t const p, Ban const& ban)
+		{
+			std::vector<block_record> unresolved;
+			auto const i = m_pieces.find(p);
+			if (i == m_pieces.end()) return unresolved;
+
+			suspect_piece const& sp = i->second;
+			for (block_record const& bad : sp.failed)
+			{
+				// if different peers sent us different data for this block
+				// (e.g. in end-game mode) we don't know which one was used
+				sha1_hash const* ok_digest = nullptr;
+				bool ambiguous = false;
+				for (block_record const& ok : sp.received)
+				{
+					if (ok.block != bad.block) continue;
+					if (ok_digest != nullptr && *ok_digest != ok.digest) ambiguous = true;
+					ok_digest = &ok.digest;
+				}
+				if (ambiguous) continue;
+				if (ok_digest == nullptr)
+				{
+					unresolved.push_back(bad);
+					continue;
+				}
+				if (*ok_digest == bad.digest) continue;
+				ban(bad, *ok_digest);
+			}
+
+			m_num_records -= int(sp.failed.size() + sp.received.size());
+			m_lru.erase(sp.lru);
+			m_pieces.erase(i);
+			return unresolved;
+		}
+
+		void clear()
+		{
+			m_pieces.clear();
+			m_lru.clear();
+			m_num_records = 0;
+		}
+
+		int num_pieces() const { return int(m_pieces.size()); }
+		int num_records() const { return m_num_records; }
+
+		std::int64_t memory_usage() const
+		{
+			return std::int64_t(m_num_records) * std::int64_t(sizeof(block_record))
+				+ std::int64_t(m_pieces.size()) * std::int64_t(sizeof(typename piece_map::value_type)
+					+ sizeof(piece_index_t) + 3 * sizeof(void*));
+		}
+
+	private:
+
+		struct suspect_piece
+		{
+			// hashes of blocks from attempts that failed the hash check
+			std::vector<block_record> failed;
+			// hashes of blocks received for the current attempt
+			std::vector<block_record> received;
+			typename std::list<piece_index_t>::iterator lru;
+		};
+
+		using piece_map = std::unordered_map<piece_index_t, suspect_piece>;
+
+		template <typename Ban>
+		void add_failed(suspect_piece& sp, block_record const& rec, Ban const& ban)
+		{
+			for (block_record const& f : sp.failed)
+			{
+				if (f.block != rec.block || !(f.peer == rec.peer)) continue;
+				// this peer sent us this block in an earlier failed attempt
+				// too. If the data is different, at least one of them was bad
+				if (f.digest != rec.digest) ban(rec, f.digest);
+				return;
+			}
+			sp.failed.push_back(rec);
+			++m_num_records;
+		}
+
+		// evict the least recently failed pieces until we're within the
+		// limit again
+		void trim()
+		{
+			while (m_num_records > m_max_records && !m_lru.empty())
+			{
+				auto const i = m_pieces.find(m_lru.back());
+				TORRENT_ASSERT(i != m_pieces.end());
+				m_num_records -= int(i->second.failed.size() + i->second.received.size());
+				m_lru.pop_back();
+				m_pieces.erase(i);
+			}
+		}
+
+		int const m_max_records;
+
+		// pieces that have failed the hash check and haven't passed yet,
+		// with the block hashes recorded for them
+		piece_map m_pieces;
+
+		// the pieces in m_pieces, the most recently failed first
+		std::list<piece_index_t> m_lru;
+
+		// the total number of block_records in m_pieces
+		int m_num_records = 0;
+	};
+}
+}
+
+#endif
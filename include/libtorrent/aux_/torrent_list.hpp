@@ -39,17 +39,15 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/sha1_hash.hpp"
 #include "libtorrent/info_hash.hpp"
 #include "libtorrent/hasher.hpp"
+#include "libtorrent/random.hpp"
 #include "libtorrent/aux_/array.hpp"
 #include "libtorrent/aux_/invariant_check.hpp"
-#include "libtorrent/aux_/scope_end.hpp"
 
+#include <array>
 #include <memory> // for shared_ptr
 #include <vector>
-#include <unordered_map>
-
-#if TORRENT_USE_INVARIANT_CHECKS
-#include <set>
-#endif
+#include <cstdint>
+#include <cstring> // for memcpy
 
 namespace libtorrent {
 namespace aux {
@@ -57,8 +55,6 @@ namespace aux {
 template <typename T>
 struct torrent_list
 {
-	// These are non-owning pointers. Lifetime is managed by the `torrent_array`
-	using torrent_map = std::unordered_map<sha1_hash, T*>;
 	using torrent_array = std::vector<std::shared_ptr<T>>;
 
 	using iterator = typename torrent_array::iterator;
@@ -96,106 +92,110 @@ struct torrent_list
 		bool duplicate = false;
 		ih.for_each([&](sha1_hash const& hash, protocol_version)
 		{
-			if (m_index.find(hash) != m_index.end()) duplicate = true;
+			if (find_slot(hash, false) != nullptr) duplicate = true;
 		});
 
 		// if we already have a torrent with this hash, don't do anything
 		if (duplicate) return false;
 
-		aux::array<bool, 4> rollback({ false, false, false, false});
-		auto abort_add = aux::scope_end([&]
-		{
-			ih.for_each([&](sha1_hash const& hash, protocol_version const v)
-			{
-				if (rollback[int(v)])
-					m_index.erase(hash);
+		key_set const keys = make_keys(ih, nullptr);
+		auto const idx = std::uint32_t(m_array.size());
+		insert_keys(keys, idx, t.get());
 
-#if !defined TORRENT_DISABLE_ENCRYPTION
-				if (rollback[2 + int(v)])
-				{
-					static char const req2[4] = { 'r', 'e', 'q', '2' };
-					hasher h(req2);
-					h.update(hash);
-						m_obfuscated_index.erase(h.final());
-				}
-#endif
-			});
-		});
+		m_array.emplace_back(std::move(t));
+		m_keys.push_back(keys);
 
-		ih.for_each([&](sha1_hash const& hash, protocol_version const v)
-		{
-			if (m_index.insert({hash, t.get()}).second)
-				rollback[int(v)] = true;
+		return true;
+	}
 
-#if !defined TORRENT_DISABLE_ENCRYPTION
-			static char const req2[4] = { 'r', 'e', 'q', '2' };
-			hasher h(req2);
-			h.update(hash);
-			// this is SHA1("req2" + info-hash), used for
-			// encrypted hand shakes
-			if (m_obfuscated_index.insert({h.final(), t.get()}).second)
-				rollback[2 + int(v)] = true;
-#endif
-		});
+	// replaces the keys of the torrent indexed by old_ih with the keys of
+	// new_ih. Unlike erase() followed by insert(), the torrent keeps its
+	// position in the list and the obfuscated hashes of the info-hashes
+	// the two have in common are not computed again. Returns false if
+	// there's no torrent with old_ih or if new_ih belongs to a different
+	// torrent
+	bool update_info_hash(info_hash_t const& old_ih, info_hash_t const& new_ih)
+	{
+		INVARIANT_CHECK;
 
-		m_array.emplace_back(std::move(t));
+		slot const* found = find_any(old_ih);
+		if (!found) return false;
+		T* const t = found->torrent;
+		std::uint32_t const idx = found->index & index_mask;
 
-		abort_add.disarm();
+		bool conflict = false;
+		new_ih.for_each([&](sha1_hash const& hash, protocol_version)
+		{
+			slot const* s = find_slot(hash, false);
+			if (s != nullptr && s->torrent != t) conflict = true;
+		});
+		if (conflict) return false;
 
+		key_set const keys = make_keys(new_ih, &m_keys[idx]);
+		erase_keys(m_keys[idx]);
+		insert_keys(keys, idx, t);
+		m_keys[idx] = keys;
 		return true;
 	}
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
-	T* find_obfuscated(sha1_hash const& ih)
+	// looks up a torrent by SHA1("req2" + info-hash), which is what the
+	// initiating side of an encrypted handshake sends. If v is set, it's
+	// set to the protocol version of the info-hash that matched
+	T* find_obfuscated(sha1_hash const& ih, protocol_version* v = nullptr)
 	{
-		auto const i = m_obfuscated_index.find(ih);
-		if (i == m_obfuscated_index.end()) return nullptr;
-		return i->second;
+		slot const* s = find_slot(ih, true);
+		if (s == nullptr) return nullptr;
+		if (v) *v = (s->index & v2_bit) ? protocol_version::V2 : protocol_version::V1;
+		return s->torrent;
 	}
 #endif
 
 	T* find(sha1_hash const& ih) const
 	{
-		auto const i = m_index.find(ih);
-		if (i == m_index.end()) return nullptr;
-		return i->second;
+		slot const* s = find_slot(ih, false);
+		return s ? s->torrent : nullptr;
 	}
 
 	bool erase(info_hash_t const& ih)
 	{
 		INVARIANT_CHECK;
 
-		T* found = nullptr;
-		ih.for_each([&](sha1_hash const& hash, protocol_version)
-		{
-			auto const i = m_index.find(hash);
-			if (i != m_index.end())
-			{
-				TORRENT_ASSERT(found == nullptr || found == i->second);
-				found = i->second;
-				m_index.erase(i);
-			}
-
-#if !defined TORRENT_DISABLE_ENCRYPTION
-			static char const req2[4] = { 'r', 'e', 'q', '2' };
-			hasher h(req2);
-			h.update(hash);
-			m_obfuscated_index.erase(h.final());
-#endif
-		});
+		slot const* found = find_any(ih);
 		if (!found) return false;
 
-		auto const array_iter = std::find_if(m_array.begin(), m_array.end()
-			, [&](std::shared_ptr<T> const& p) { return p.get() == found; });
-		TORRENT_ASSERT(array_iter != m_array.end());
+		std::uint32_t const idx = found->index & index_mask;
+		TORRENT_ASSERT(idx < m_array.size());
+
+		// remove all the keys the torrent was inserted with, which may be
+		// more than ih has
+		erase_keys(m_keys[idx]);
 
-		TORRENT_ASSERT(m_index.find(ih.v1) == m_index.end());
+		TORRENT_ASSERT(find(ih.v1) == nullptr);
 
-		if (array_iter != m_array.end() - 1)
-			std::swap(*array_iter, m_array.back());
+		auto const last = std::uint32_t(m_array.size() - 1);
+		if (idx != last)
+		{
+			std::swap(m_array[idx], m_array.back());
+			std::swap(m_keys[idx], m_keys.back());
+
+			// the torrent that was moved into the hole needs its keys to
+			// point to its new position
+			key_set const& moved = m_keys[idx];
+			for (int i = 0; i < moved.num; ++i)
+			{
+				slot* s = find_slot(moved.plain[i], false);
+				s->index = (s->index & ~index_mask) | idx;
+#if !defined TORRENT_DISABLE_ENCRYPTION
+				s = find_slot(moved.obfuscated[i], true);
+				s->index = (s->index & ~index_mask) | idx;
+#endif
+			}
+		}
 
 		// This is where we, potentially, remove the last reference
 		m_array.pop_back();
+		m_keys.pop_back();
 
 		return true;
 	}
@@ -205,59 +205,265 @@ struct torrent_list
 		INVARIANT_CHECK;
 
 		m_array.clear();
+		m_keys.clear();
 		m_index.clear();
-#if !defined TORRENT_DISABLE_ENCRYPTION
-		m_obfuscated_index.clear();
-#endif
+		m_num_keys = 0;
 	}
 
 #if TORRENT_USE_INVARIANT_CHECKS
 	void check_invariant() const
 	{
+		TORRENT_ASSERT(m_array.size() == m_keys.size());
+		TORRENT_ASSERT(m_num_keys * 2 <= int(m_index.size()));
 #ifndef TORRENT_EXPENSIVE_INVARIANT_CHECKS
 		// if we have many torrents, this would be an expensive
 		// invariant check, so don't run it in that case (unless we
 		// enabled expensive invariant checks)
 		if (m_array.size() > 100) return;
 #endif
-		std::set<T*> all_torrents;
-		std::set<T*> all_indexed_torrents;
+		int num_keys = 0;
+		for (std::uint32_t i = 0; i < m_array.size(); ++i)
+		{
+			key_set const& keys = m_keys[i];
+			TORRENT_ASSERT(keys.num > 0);
+			for (int k = 0; k < keys.num; ++k)
+			{
+				slot const* s = find_slot(keys.plain[k], false);
+				TORRENT_ASSERT(s != nullptr);
+				TORRENT_ASSERT(s->torrent == m_array[i].get());
+				TORRENT_ASSERT((s->index & index_mask) == i);
+				++num_keys;
 #if !defined TORRENT_DISABLE_ENCRYPTION
-		std::set<T*> all_obf_indexed_torrents;
+				s = find_slot(keys.obfuscated[k], true);
+				TORRENT_ASSERT(s != nullptr);
+				TORRENT_ASSERT(s->torrent == m_array[i].get());
+				TORRENT_ASSERT((s->index & index_mask) == i);
+				++num_keys;
+#endif
+			}
+		}
+		TORRENT_ASSERT(num_keys == m_num_keys);
+	}
 #endif
 
-		for (auto const& t : m_array)
-			all_torrents.insert(t.get());
+private:
 
-		for (auto const& t : m_index)
-		{
-			all_indexed_torrents.insert(t.second);
-		}
 #if !defined TORRENT_DISABLE_ENCRYPTION
-		for (auto const& t : m_obfuscated_index)
+	// this is SHA1("req2" + info-hash), used for encrypted hand shakes
+	static sha1_hash obfuscate(sha1_hash const& hash)
+	{
+		static char const req2[4] = { 'r', 'e', 'q', '2' };
+		hasher h(req2);
+		h.update(hash);
+		return h.final();
+	}
+	static constexpr int keys_per_torrent = 4;
+#else
+	static constexpr int keys_per_torrent = 2;
+#endif
+
+	// set in slot::index for keys that are obfuscated info-hashes
+	static constexpr std::uint32_t obfuscated_bit = 0x80000000;
+	// set in slot::index for keys derived from the v2 info-hash
+	static constexpr std::uint32_t v2_bit = 0x40000000;
+	static constexpr std::uint32_t index_mask = 0x3fffffff;
+
+	// a slot in the open addressing hash table. All keys, for every torrent,
+	// are in the same table, v1 and (truncated) v2 info-hashes as well as
+	// their obfuscated counterparts.
+	struct slot
+	{
+		sha1_hash key;
+		// the position of the torrent in m_array (masked by index_mask),
+		// along with obfuscated_bit and v2_bit
+		std::uint32_t index;
+		// nullptr means this slot is empty
+		T* torrent;
+	};
+
+	// the keys a torrent was inserted with, used to remove them again and
+	// to update them when the torrent moves in m_array
+	struct key_set
+	{
+		std::array<sha1_hash, 2> plain;
+#if !defined TORRENT_DISABLE_ENCRYPTION
+		std::array<sha1_hash, 2> obfuscated;
+#endif
+		std::array<protocol_version, 2> version;
+		int num = 0;
+	};
+
+	// computes the keys for ih. The obfuscated hashes of keys that are also
+	// in reuse are copied from there rather than computed
+	static key_set make_keys(info_hash_t const& ih, key_set const* reuse)
+	{
+		key_set keys;
+		ih.for_each([&](sha1_hash const& hash, protocol_version const v)
 		{
-			all_obf_indexed_torrents.insert(t.second);
-		}
+			// a v2 info-hash may truncate to the same value as the v1 hash.
+			// In that case the key is considered a v2 key
+			if (keys.num == 1 && keys.plain[0] == hash)
+			{
+				keys.version[0] = v;
+				return;
+			}
+			keys.plain[keys.num] = hash;
+			keys.version[keys.num] = v;
+#if !defined TORRENT_DISABLE_ENCRYPTION
+			bool reused = false;
+			for (int i = 0; reuse != nullptr && i < reuse->num; ++i)
+			{
+				if (reuse->plain[i] != hash) continue;
+				keys.obfuscated[keys.num] = reuse->obfuscated[i];
+				reused = true;
+			}
+			if (!reused) keys.obfuscated[keys.num] = obfuscate(hash);
 #endif
+			++keys.num;
+		});
+		return keys;
+	}
 
-		TORRENT_ASSERT(all_torrents == all_indexed_torrents);
+	void insert_keys(key_set const& keys, std::uint32_t const idx, T* t)
+	{
+		TORRENT_ASSERT(idx <= index_mask);
+		reserve_keys(m_num_keys + keys_per_torrent);
+		for (int i = 0; i < keys.num; ++i)
+		{
+			std::uint32_t const v2 = keys.version[i] == protocol_version::V2 ? v2_bit : 0;
+			insert_key(slot{keys.plain[i], idx | v2, t});
 #if !defined TORRENT_DISABLE_ENCRYPTION
-		TORRENT_ASSERT(all_torrents == all_obf_indexed_torrents);
+			insert_key(slot{keys.obfuscated[i], idx | v2 | obfuscated_bit, t});
 #endif
+		}
 	}
+
+	void erase_keys(key_set const& keys)
+	{
+		for (int i = 0; i < keys.num; ++i)
+		{
+			erase_key(keys.plain[i], false);
+#if !defined TORRENT_DISABLE_ENCRYPTION
+			erase_key(keys.obfuscated[i], true);
 #endif
+		}
+	}
 
-private:
+	// returns the slot of any of the (non-obfuscated) hashes in ih
+	slot const* find_any(info_hash_t const& ih) const
+	{
+		slot const* found = nullptr;
+		ih.for_each([&](sha1_hash const& hash, protocol_version)
+		{
+			slot const* s = find_slot(hash, false);
+			TORRENT_ASSERT(found == nullptr || s == nullptr
+				|| found->torrent == s->torrent);
+			if (found == nullptr) found = s;
+		});
+		return found;
+	}
+
+	// the keys are SHA-1 digests, so any 8 bytes of them are as good a hash
+	// as we could compute. The random seed keeps someone who can pick
+	// info-hashes (e.g. via magnet links) from lining them up in the table
+	std::size_t home(sha1_hash const& key) const
+	{
+		std::uint64_t h;
+		std::memcpy(&h, key.data(), sizeof(h));
+		h = (h ^ m_seed) * 0x9e3779b97f4a7c15ULL;
+		return std::size_t(h >> 32) & (m_index.size() - 1);
+	}
+
+	slot* find_slot(sha1_hash const& key, bool const obfuscated)
+	{
+		return const_cast<slot*>(
+			static_cast<torrent_list const*>(this)->find_slot(key, obfuscated));
+	}
+
+	slot const* find_slot(sha1_hash const& key, bool const obfuscated) const
+	{
+		if (m_index.empty()) return nullptr;
+		std::size_t const mask = m_index.size() - 1;
+		for (std::size_t i = home(key);; i = (i + 1) & mask)
+		{
+			slot const& s = m_index[i];
+			if (s.torrent == nullptr) return nullptr;
+			if (s.key == key && ((s.index & obfuscated_bit) != 0) == obfuscated)
+				return &s;
+		}
+	}
+
+	// make sure there's room for n keys while keeping the load factor at
+	// or below 50%
+	void reserve_keys(int const n)
+	{
+		if (n * 2 <= int(m_index.size())) return;
+		std::size_t size = m_index.empty() ? 16 : m_index.size();
+		while (int(size) < n * 2) size *= 2;
+
+		std::vector<slot> old(size, slot{sha1_hash(), 0, nullptr});
+		old.swap(m_index);
+		m_num_keys = 0;
+		for (slot const& s : old)
+			if (s.torrent != nullptr) insert_key(s);
+	}
+
+	void insert_key(slot const& s)
+	{
+		TORRENT_ASSERT((m_num_keys + 1) * 2 <= int(m_index.size()));
+		std::size_t const mask = m_index.size() - 1;
+		for (std::size_t i = home(s.key);; i = (i + 1) & mask)
+		{
+			slot& dst = m_index[i];
+			if (dst.torrent == nullptr)
+			{
+				dst = s;
+				++m_num_keys;
+				return;
+			}
+			TORRENT_ASSERT(dst.key != s.key || dst.index != s.index);
+		}
+	}
+
+	// removes the key using backward shift deletion, to not leave any
+	// tombstones behind
+	void erase_key(sha1_hash const& key, bool const obfuscated)
+	{
+		slot* s = find_slot(key, obfuscated);
+		if (s == nullptr) return;
+
+		std::size_t const mask = m_index.size() - 1;
+		std::size_t hole = std::size_t(s - m_index.data());
+		for (std::size_t i = (hole + 1) & mask;; i = (i + 1) & mask)
+		{
+			slot& next = m_index[i];
+			if (next.torrent == nullptr) break;
+
+			// the entry can only move back into the hole if that doesn't put
+			// it in front of its home slot
+			std::size_t const h = home(next.key);
+			if (((i - h) & mask) < ((i - hole) & mask)) continue;
+
+			m_index[hole] = next;
+			hole = i;
+		}
+		m_index[hole].torrent = nullptr;
+		--m_num_keys;
+	}
 
 	torrent_array m_array;
 
-	torrent_map m_index;
+	// m_keys[i] are the keys m_array[i] is indexed by
+	std::vector<key_set> m_keys;
 
-#if !defined TORRENT_DISABLE_ENCRYPTION
-	// this maps obfuscated hashes to torrents. It's only
-	// used when encryption is enabled
-	torrent_map m_obfuscated_index;
-#endif
+	// open addressing hash table with linear probing, mapping all info-hashes
+	// (and, if encryption is enabled, their obfuscated hashes) to torrents.
+	// The size is a power of 2
+	std::vector<slot> m_index;
+	int m_num_keys = 0;
+
+	std::uint64_t const m_seed = (std::uint64_t(random(0xffffffff)) << 32)
+		| random(0xffffffff);
 };
 
 }
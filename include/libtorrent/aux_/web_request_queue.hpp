@@ -0,0 +1,128 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef TORRENT_WEB_REQUEST_QUEUE_HPP_INCLUDED
+#define TORRENT_WEB_REQUEST_QUEUE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/file_storage.hpp"
+#include "libtorrent/peer_request.hpp"
+#include "libtorrent/units.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	// a byte range of a single file, requested with one HTTP request
+	struct web_file_request
+	{
+		file_index_t file_index;
+		int length;
+		std::int64_t start;
+	};
+
+	// bittorrent requests issued to a web seed, but not yet sent as HTTP
+	// requests. They are held back until the bittorrent engine is done issuing
+	// requests for this round, so that adjacent byte ranges can be requested
+	// with a single HTTP request. Until then, they can also be cancelled.
+	struct web_request_queue
+	{
+		void push_back(peer_request const& r) { m_requests.push_back(r); }
+
+		bool empty() const { return m_requests.empty(); }
+
+		// removes ``r`` from the queue. Returns false if it isn't queued,
+		// i.e. it has already been sent
+		bool cancel(peer_request const& r)
+		{
+			auto const it = std::find(m_requests.begin(), m_requests.end(), r);
+			if (it == m_requests.end()) return false;
+			m_requests.erase(it);
+			return true;
+		}
+
+		// empties the queue and returns the file ranges covered by the
+		// requests, in order. A range that immediately follows the previous
+		// one in the same file is merged into it. Ranges in pad files are
+		// never merged, they are not requested from the server.
+		std::vector<web_file_request> flush(file_storage const& fs)
+		{
+			std::vector<web_file_request> ret;
+			for (auto const& r : m_requests)
+			{
+				if (fs.num_files() == 1)
+				{
+					append(fs, ret, {file_index_t(0)
+						, r.length
+						, std::int64_t(static_cast<int>(r.piece)) * fs.piece_length() + r.start});
+					continue;
+				}
+
+				for (auto const& f : fs.map_block(r.piece, r.start, r.length))
+				{
+					// TODO: 3 file_index_t should not allow negative values
+					TORRENT_ASSERT(f.file_index >= file_index_t(0));
+					append(fs, ret, {f.file_index, int(f.size), f.offset});
+				}
+			}
+			m_requests.clear();
+			return ret;
+		}
+
+	private:
+
+		static void append(file_storage const& fs, std::vector<web_file_request>& ret
+			, web_file_request const& r)
+		{
+			if (!ret.empty())
+			{
+				web_file_request& last = ret.back();
+				if (last.file_index == r.file_index
+					&& last.start + last.length == r.start
+					&& !fs.pad_file_at(r.file_index)
+					&& last.length <= std::numeric_limits<int>::max() - r.length)
+				{
+					last.length += r.length;
+					return;
+				}
+			}
+			ret.push_back(r);
+		}
+
+		std::vector<peer_request> m_requests;
+	};
+} }
+
+#endif
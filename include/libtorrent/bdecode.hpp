@@ -166,6 +166,11 @@ namespace aux {
 // internal
 void escape_string(std::string& ret, char const* str, int len);
 
+// internal
+// returns a pointer to the first character in the range [start, end) that is
+// not a decimal digit, or end if there is none
+TORRENT_EXTRA_EXPORT char const* find_non_digit(char const* start, char const* end);
+
 // internal
 struct bdecode_token
 {
@@ -478,6 +483,26 @@ TORRENT_EXPORT bdecode_node bdecode(span<char const> buffer
 TORRENT_EXPORT bdecode_node bdecode(span<char const> buffer
 	, int depth_limit = 100, int token_limit = 2000000);
 
+// Finds the value of ``key`` in the bencoded dictionary in ``buffer``,
+// without building a tree of tokens for it. The values of all keys preceding
+// it are validated and skipped, without allocating any memory. The returned
+// span is the bencoded representation of the value, which can be passed to
+// bdecode(), or back to this function to look up a key in a nested
+// dictionary. This is much cheaper than bdecode() when only a few fields of
+// a very large structure are needed, e.g. the name of a torrent with millions
+// of files::
+//
+//	error_code ec;
+//	span<char const> info = bdecode_find_key(buf, "info", ec);
+//	bdecode_node name = bdecode(bdecode_find_key(info, "name", ec), ec);
+//
+// If the key is not found, an empty span is returned. If ``buffer`` is not a
+// valid dictionary (at least up to and including the value of ``key``),
+// an empty span is returned and ``ec`` is set. ``depth_limit`` has the same
+// meaning as for bdecode().
+TORRENT_EXPORT span<char const> bdecode_find_key(span<char const> buffer
+	, string_view key, error_code& ec, int depth_limit = 100);
+
 }
 
 #endif // TORRENT_BDECODE_HPP
@@ -178,6 +178,37 @@ namespace libtorrent {
 		// returns the index to the last cleared bit in the bitfield, i.e. 0 bit.
 		int find_last_clear() const noexcept;
 
+		// returns the index of the first set bit at or after ``start``, or -1
+		// if there is none. ``start`` may be equal to size().
+		int find_next_set(int start) const noexcept;
+
+		// calls ``f`` with the index of every set bit, in increasing order.
+		// Words with no bits set are skipped without looking at their bits.
+		template <typename Fun>
+		void for_each_set(Fun f) const
+		{
+			for (int i = find_next_set(0); i >= 0; i = find_next_set(i + 1))
+				f(i);
+		}
+
+		// these operate on whole words at a time. Both bitfields are expected
+		// to have the same size. ``count_and()`` returns the number of bits
+		// set in both, ``count_and_not()`` the number of bits set in this
+		// bitfield but not in ``rhs``. ``any_and()`` and ``any_and_not()``
+		// return whether that number is non-zero, stopping at the first word
+		// where it is.
+		int count_and(bitfield const& rhs) const noexcept;
+		int count_and_not(bitfield const& rhs) const noexcept;
+		bool any_and(bitfield const& rhs) const noexcept;
+		bool any_and_not(bitfield const& rhs) const noexcept;
+
+		// in-place set operations. Every bit in this bitfield is replaced by
+		// its value AND, OR or AND NOT the corresponding bit in ``rhs``. Both
+		// bitfields are expected to have the same size.
+		void bitwise_and(bitfield const& rhs) noexcept;
+		void bitwise_or(bitfield const& rhs) noexcept;
+		void bitwise_and_not(bitfield const& rhs) noexcept;
+
 		bool operator==(lt::bitfield const& rhs) const;
 
 		// internal
@@ -328,6 +359,14 @@ namespace libtorrent {
 		void set_bit(IndexType const index)
 		{ this->bitfield::set_bit(static_cast<int>(index)); }
 
+		// returns the first set bit at or after ``start``, or -1
+		IndexType find_next_set(IndexType const start) const noexcept
+		{ return IndexType(this->bitfield::find_next_set(static_cast<int>(start))); }
+
+		template <typename Fun>
+		void for_each_set(Fun f) const
+		{ this->bitfield::for_each_set([&f](int const i) { f(IndexType(i)); }); }
+
 		IndexType end_index() const noexcept { return IndexType(this->size()); }
 	};
 }
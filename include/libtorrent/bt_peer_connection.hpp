@@ -465,33 +465,40 @@ namespace libtorrent {
 		std::vector<hash_request> m_hash_requests;
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
-		// initialized during write_pe1_2_dhkey, and destroyed on
-		// creation of m_enc_handler. Cannot reinitialize once
-		// initialized.
-		std::unique_ptr<dh_key_exchange> m_dh_key_exchange;
-
-		// used during an encrypted handshake then moved
-		// into m_enc_handler if rc4 encryption is negotiated
-		// otherwise it is destroyed when the handshake completes
-		std::shared_ptr<rc4_handler> m_rc4;
+		// state that's only needed while negotiating an encrypted
+		// connection. It's allocated by write_pe1_2_dhkey() and freed once
+		// the encrypted handshake completes, to not carry it around for the
+		// lifetime of the connection
+		struct pe_handshake
+		{
+			// destroyed on creation of m_enc_handler. Cannot reinitialize
+			// once initialized.
+			std::unique_ptr<dh_key_exchange> dh_key;
+
+			// used during an encrypted handshake then moved
+			// into m_enc_handler if rc4 encryption is negotiated
+			// otherwise it is destroyed when the handshake completes
+			std::shared_ptr<rc4_handler> rc4;
+
+			// (outgoing only) synchronize verification constant with
+			// remote peer, this will hold rc4_decrypt(vc). Destroyed
+			// after the sync step.
+			std::unique_ptr<char[]> sync_vc;
+
+			// (incoming only) synchronize hash with remote peer, holds
+			// the sync hash (hash("req1",secret)). Destroyed after the
+			// sync step.
+			std::unique_ptr<sha1_hash> sync_hash;
+
+			// used to disconnect peer if sync points are not found within
+			// the maximum number of bytes
+			int sync_bytes_read = 0;
+		};
+		std::unique_ptr<pe_handshake> m_pe;
 
 		// if encryption is negotiated, this is used for
 		// encryption/decryption during the entire session.
 		encryption_handler m_enc_handler;
-
-		// (outgoing only) synchronize verification constant with
-		// remote peer, this will hold rc4_decrypt(vc). Destroyed
-		// after the sync step.
-		std::unique_ptr<char[]> m_sync_vc;
-
-		// (incoming only) synchronize hash with remote peer, holds
-		// the sync hash (hash("req1",secret)). Destroyed after the
-		// sync step.
-		std::unique_ptr<sha1_hash> m_sync_hash;
-
-		// used to disconnect peer if sync points are not found within
-		// the maximum number of bytes
-		int m_sync_bytes_read = 0;
 #endif
 
 		// the message ID for upload only message
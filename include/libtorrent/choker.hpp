@@ -37,13 +37,49 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/config.hpp"
 #include "libtorrent/time.hpp" // for time_duration
 #include <vector>
+#include <functional>
+#include <cstdint>
+#include <limits>
 
 namespace libtorrent {
 
+	struct peer_connection;
+
 namespace aux {
 	struct session_settings;
+
+	// the state of a peer that its unchoke order is based on. This is
+	// captured once per peer per unchoke round
+	struct unchoke_peer
+	{
+		peer_connection* peer = nullptr;
+
+		// the rank assigned by plugins. Lower ranks are unchoked first
+		std::uint64_t ext_rank = (std::numeric_limits<std::uint64_t>::max)();
+
+		// the peer's upload priority, higher priorities are unchoked first
+		int priority = 1;
+
+		std::int64_t downloaded_in_last_round = 0;
+		std::int64_t uploaded_in_last_round = 0;
+		std::int64_t uploaded_since_unchoked = 0;
+		std::int64_t total_payload_upload = 0;
+		int num_have_pieces = 0;
+		bool choked = true;
+		time_point last_unchoke;
+
+		// the size of the peer's torrent
+		std::int64_t torrent_size = 0;
+		int piece_length = 0;
+	};
+
+	// the implementation of unchoke_sort(), ordering the captured state of
+	// peers rather than the peer connections themselves
+	TORRENT_EXTRA_EXPORT int unchoke_sort(std::vector<unchoke_peer>& peers
+		, time_duration unchoke_interval
+		, aux::session_settings const& sett
+		, time_point now);
 }
-	struct peer_connection;
 
 	// sorts the vector of peers in-place. When returning, the top unchoke slots
 	// elements are the peers we should unchoke. This is similar to a partial
@@ -51,9 +87,12 @@ namespace aux {
 	// the return value are the number of peers that should be unchoked. This
 	// is also the number of elements that are valid at the beginning of the
 	// peer list. Peers beyond this initial range are not sorted.
+	// If ext_rank is set, it's called once per peer and peers with a lower
+	// rank are unchoked before any of the built-in criteria are considered.
 	TORRENT_EXTRA_EXPORT int unchoke_sort(std::vector<peer_connection*>& peers
 		, time_duration unchoke_interval
-		, aux::session_settings const& sett);
+		, aux::session_settings const& sett
+		, std::function<std::uint64_t(peer_connection&)> const& ext_rank = {});
 
 }
 
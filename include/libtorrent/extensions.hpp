@@ -215,6 +215,11 @@ TORRENT_VERSION_NAMESPACE_3
 		// called even if there is no active torrent in the session
 		static constexpr feature_flags_t unknown_torrent_feature = 5_bit;
 
+		// include this bit if your plugin needs to alter the order in which
+		// peers are picked for the regular unchoke slots, i.e. have
+		// get_unchoke_rank() called.
+		static constexpr feature_flags_t unchoke_feature = 6_bit;
+
 		// This function is expected to return a bitmask indicating which features
 		// this plugin implements. Some callbacks on this object may not be called
 		// unless the corresponding feature flag is returned here. Note that
@@ -276,6 +281,21 @@ TORRENT_VERSION_NAMESPACE_3
 		virtual uint64_t get_unchoke_priority(peer_connection_handle const& /* peer */)
 		{ return (std::numeric_limits<uint64_t>::max)(); }
 
+		// called once per unchoke interval for every peer that is a candidate
+		// for a regular unchoke slot. Peers are unchoked in order of increasing
+		// rank, and the built-in choking algorithm (see
+		// settings_pack::seed_choking_algorithm) only orders peers of equal
+		// rank. Return 2^64-1 for peers your plugin has no opinion on. This
+		// makes it possible to implement custom choking algorithms, such as
+		// giving some peers a larger share of the upload slots. The number of
+		// slots is still determined by settings_pack::choking_algorithm.
+		// If your plugin expects this to be called, make sure to include the
+		// flag ``unchoke_feature`` in the return value from
+		// implemented_features(). If multiple plugins implement this function
+		// the lowest return value is used.
+		virtual uint64_t get_unchoke_rank(peer_connection_handle const& /* peer */)
+		{ return (std::numeric_limits<uint64_t>::max)(); }
+
 #if TORRENT_ABI_VERSION <= 2
 		// called when saving settings state
 		virtual void save_state(entry&) {}
@@ -335,6 +355,11 @@ TORRENT_VERSION_NAMESPACE_3_END
 		// easy for plugins to do timed events, for sending messages or whatever.
 		virtual void tick() {}
 
+		// returns an estimate of the number of bytes of memory this plugin
+		// uses for its per-torrent state. This is reported in
+		// torrent_status and the ``ses.torrent_memory_extensions`` counter.
+		virtual std::int64_t memory_usage() const { return 0; }
+
 		// These hooks are called when the torrent is paused and resumed respectively.
 		// The return value indicates if the event was handled. A return value of
 		// ``true`` indicates that it was handled, and no other plugin after this one
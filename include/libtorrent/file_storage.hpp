@@ -650,6 +650,11 @@ namespace aux {
 		// internal
 		void canonicalize_impl(bool backwards_compatible);
 
+		// internal
+		// returns an estimate of the number of bytes of heap memory used by
+		// the file list
+		std::int64_t memory_usage() const;
+
 	private:
 
 		std::string internal_file_path(file_index_t index) const;
@@ -166,6 +166,10 @@ namespace libtorrent
 
 		int piece_layer() const { return m_piece_layer; }
 
+		// an estimate of the number of bytes of heap memory used for
+		// outstanding hash requests. The merkle trees are not included
+		std::int64_t memory_usage() const;
+
 	private:
 		// returns the number of proof layers needed to verify the node's hash
 		int layers_to_verify(node_index idx) const;
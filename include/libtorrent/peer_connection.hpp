@@ -80,6 +80,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <tuple> // for make_tuple
 #include <array>
 #include <cstdint>
+#include <limits>
 
 namespace libtorrent {
 
@@ -411,6 +412,9 @@ namespace aux {
 			return m_superseed_piece[0] == index
 				|| m_superseed_piece[1] == index;
 		}
+		// the pieces this peer is allowed to download from us, or -1
+		std::array<piece_index_t, 2> const& super_seeded_pieces() const
+		{ return m_superseed_piece; }
 #endif
 
 		// tells if this connection has data it want to send
@@ -462,6 +466,11 @@ namespace aux {
 
 		void update_interest();
 
+		// makes the count of pieces we want from this peer start over. To be
+		// called when the piece picker is replaced
+		void reset_wanted_count()
+		{ m_wanted_seq = std::numeric_limits<std::uint64_t>::max(); }
+
 		void get_peer_info(peer_info& p) const override;
 
 		// returns the torrent this connection is a part of
@@ -786,10 +795,20 @@ namespace aux {
 			, std::size_t bytes_transferred);
 		void on_receive_data(error_code const& error
 			, std::size_t bytes_transferred);
+		void on_receive_ready(error_code const& error);
 
 		void account_received_bytes(int bytes_transferred);
 
 		void do_update_interest();
+
+		// the number of pieces this peer has that are in the piece picker's
+		// wanted_pieces(). This catches up on the changes to them since the
+		// last call, which usually makes it constant time
+		int num_wanted_pieces(piece_picker const& p);
+
+		// to be called right before the peer gains or loses a single piece
+		void update_wanted_count(piece_index_t index, bool has);
+
 		void fill_send_buffer();
 		void on_disk_read_complete(disk_buffer_holder buffer
 			, storage_error const& error, peer_request const&, time_point issue_time);
@@ -835,6 +854,12 @@ namespace aux {
 		// m_have_piece.end(), true)
 		int m_num_pieces;
 
+		// the number of pieces in m_have_piece that are also in the piece
+		// picker's wanted_pieces(), as of its change number m_wanted_seq.
+		// See num_wanted_pieces()
+		int m_num_wanted_pieces;
+		std::uint64_t m_wanted_seq;
+
 	public:
 		// upload and download channel state
 		// enum from peer_info::bw_state
@@ -1202,6 +1227,11 @@ namespace aux {
 		// outstanding requests need to increase at the same pace to keep up.
 		bool m_slow_start:1;
 
+		// set when the socket reported being readable while we were waiting
+		// for an idle connection to receive something. The next call to
+		// setup_receive() will issue a real read, with a receive buffer
+		bool m_socket_readable:1;
+
 #if TORRENT_USE_ASSERTS
 	public:
 		bool m_in_constructor = true;
@@ -161,6 +161,14 @@ namespace libtorrent {
 		int num_peers() const { return int(m_peers.size()); }
 		int num_candidate_cache() const { return int(m_candidate_cache.size()); }
 
+		// an estimate of the number of bytes of memory used by the peer list
+		std::int64_t memory_usage() const;
+
+		// erase peers we're not connected to until there are at most
+		// ``target`` entries left (or no more peers can be erased). This is
+		// used to reduce memory usage. Returns the number of erased peers
+		int shed_peers(int target, torrent_state* state);
+
 		using peers_t = aux::deque<torrent_peer*>;
 		using iterator = peers_t::iterator;
 		using const_iterator = peers_t::const_iterator;
@@ -459,6 +459,15 @@ namespace libtorrent {
 
 			num_queued_tracker_announces,
 
+			// the estimated memory used by torrents, broken down by
+			// subsystem. These must be defined in the same order as the
+			// fields of torrent_memory_usage
+			torrent_memory_metadata,
+			torrent_memory_piece_picker,
+			torrent_memory_peer_list,
+			torrent_memory_hash_trees,
+			torrent_memory_extensions,
+
 			num_counters,
 			num_gauges_counters = num_counters - num_stats_counters
 		};
@@ -62,6 +62,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/flags.hpp"
 #include "libtorrent/units.hpp"
 #include "libtorrent/index_range.hpp"
+#include "libtorrent/bitfield.hpp"
 
 namespace libtorrent {
 
@@ -459,6 +460,33 @@ namespace libtorrent {
 		// been flushed to disk yet)
 		int num_passed() const { return m_num_passed; }
 
+		// the pieces we still want, i.e. pieces that aren't filtered and
+		// haven't passed the hash check. This is kept up to date as pieces
+		// pass and priorities change, so checking whether a peer has
+		// anything we want can be done a word at a time
+		typed_bitfield<piece_index_t> const& wanted_pieces() const
+		{ return m_wanted; }
+
+		// every change to wanted_pieces() is numbered. This is the number the
+		// next change will get
+		std::uint64_t wanted_sequence() const { return m_wanted_seq; }
+
+		// calls f(piece, wanted) for every change to wanted_pieces() since
+		// sequence number seq, in order. Only the most recent changes are
+		// remembered. If some of them have been forgotten, nothing is called
+		// and false is returned. Anything derived from wanted_pieces() then
+		// has to be computed from scratch
+		template <typename Fun>
+		bool wanted_changes_since(std::uint64_t const seq, Fun f) const
+		{
+			if (seq > m_wanted_seq) return false;
+			std::uint64_t const n = m_wanted_seq - seq;
+			if (n > m_wanted_log.size()) return false;
+			for (auto i = m_wanted_log.end() - std::ptrdiff_t(n); i != m_wanted_log.end(); ++i)
+				f(i->piece, i->wanted);
+			return true;
+		}
+
 		// return true if all the pieces we want have passed the hash check (but
 		// may not have been written to disk yet)
 		bool is_finished() const
@@ -510,6 +538,10 @@ namespace libtorrent {
 
 		std::pair<int, int> distributed_copies() const;
 
+		// an estimate of the number of bytes of heap memory used by the
+		// piece picker
+		std::int64_t memory_usage() const;
+
 		// return the array of block_info objects for a given downloading_piece.
 		// this array has blocks_per_piece elements in it
 		span<block_info const> blocks_for_piece(downloading_piece const& dp) const;
@@ -754,6 +786,13 @@ namespace libtorrent {
 
 		void update_pieces() const;
 
+		// updates the piece's bit in m_wanted, given whether it has passed
+		// the hash check or not
+		void update_wanted(piece_index_t index, bool passed);
+
+		// forgets all changes to m_wanted, for when all of it is rewritten
+		void reset_wanted_log();
+
 		prio_index_t priority_begin(int prio) const;
 		prio_index_t priority_end(int prio) const;
 
@@ -833,6 +872,21 @@ namespace libtorrent {
 		// the number of pieces that have passed the hash check
 		int m_num_passed = 0;
 
+		// one bit per piece, set for pieces that are neither filtered nor
+		// passed the hash check. See wanted_pieces()
+		typed_bitfield<piece_index_t> m_wanted;
+
+		struct wanted_change
+		{
+			piece_index_t piece;
+			bool wanted;
+		};
+
+		// the most recent changes to m_wanted. The last one has sequence
+		// number m_wanted_seq - 1
+		std::vector<wanted_change> m_wanted_log;
+		std::uint64_t m_wanted_seq = 0;
+
 		// this vector contains all piece indices that are pickable
 		// sorted by priority. Pieces are in random random order
 		// among pieces with the same priority
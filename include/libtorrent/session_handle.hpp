@@ -221,7 +221,8 @@ namespace libtorrent {
 		// included. This flag is on by default. See add_torrent_params.
 		// the ``flags`` argument is the same as for torrent_handle::status().
 		// see status_flags_t in torrent_handle.
-		void post_torrent_updates(status_flags_t flags = status_flags_t::all());
+		void post_torrent_updates(status_flags_t flags
+			= status_flags_t::all() & ~torrent_handle::query_memory_usage);
 
 		// This function will post a session_stats_alert object, containing a
 		// snapshot of the performance counters from the internals of libtorrent.
@@ -256,6 +257,39 @@ namespace libtorrent {
 		torrent_handle find_torrent(sha1_hash const& info_hash) const;
 		std::vector<torrent_handle> get_torrents() const;
 
+		// These are non-blocking versions of find_torrent(), get_torrents(),
+		// get_torrent_status() and refresh_torrent_status(). Instead of
+		// waiting for the libtorrent network thread, they return immediately
+		// and ``handler`` is called with the result once the network thread
+		// has processed the request. A client running a thread pool can
+		// complete a promise from the handler to get a future.
+		//
+		// ``handler`` is always called exactly once, with an error_code and
+		// the result. If the error_code is set, the result is default
+		// constructed. This happens if the call fails on the network thread,
+		// or if the session shuts down before the call was run
+		// (operation_aborted). If the session is already gone, ``handler``
+		// is called right away, on the calling thread, with
+		// errors::invalid_session_handle. Otherwise it is invoked on the
+		// network thread. It must not block, and in particular it must not
+		// call any of the synchronous functions on session_handle or
+		// torrent_handle.
+		//
+		// ``async_refresh_torrent_status()`` takes the vector by value and
+		// passes it back, refreshed, to the handler. This allows a single
+		// round-trip to update the status of a whole batch of torrents.
+		void async_find_torrent(sha1_hash const& info_hash
+			, std::function<void(error_code const&, torrent_handle)> handler) const;
+		void async_get_torrents(
+			std::function<void(error_code const&, std::vector<torrent_handle>)> handler) const;
+		void async_get_torrent_status(
+			std::function<bool(torrent_status const&)> pred
+			, status_flags_t flags
+			, std::function<void(error_code const&, std::vector<torrent_status>)> handler) const;
+		void async_refresh_torrent_status(std::vector<torrent_status> status
+			, status_flags_t flags
+			, std::function<void(error_code const&, std::vector<torrent_status>)> handler) const;
+
 		// You add torrents through the add_torrent() function where you give an
 		// object with all the parameters. The add_torrent() overloads will block
 		// until the torrent has been added (or failed to be added) and returns
@@ -1118,6 +1152,10 @@ namespace libtorrent {
 		template <typename Ret, typename Fun, typename... Args>
 		Ret sync_call_ret(Fun f, Args&&... a) const;
 
+		template <typename Ret, typename Fun>
+		void async_call_handler(std::function<void(error_code const&, Ret)> handler
+			, Fun f) const;
+
 		explicit session_handle(std::weak_ptr<aux::session_impl> impl)
 			: m_impl(std::move(impl))
 		{}
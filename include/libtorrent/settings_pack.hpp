@@ -1014,6 +1014,18 @@ namespace aux {
 			// protocol may not be valid from the proxy's point of view.
 			socks5_udp_send_local_ep,
 
+			// when enabled, SSL torrents created after this is set hand the
+			// encryption of outgoing TLS 1.3 records (AES-GCM) on TCP
+			// connections to the kernel, if it supports kTLS. This saves
+			// copying every payload byte through OpenSSL. Connections where
+			// kTLS can't be used keep encrypting in userspace. This is only
+			// available on Linux. Enabling it also disables TLS session
+			// tickets for SSL torrents.
+			// Once the kernel encrypts for a connection, OpenSSL can't send
+			// any more records on it. If it needs to, for instance to answer
+			// a peer's KeyUpdate request, the connection is closed instead.
+			enable_ktls,
+
 			max_bool_setting_internal
 		};
 
@@ -2068,6 +2080,43 @@ namespace aux {
 			i2p_inbound_length,
 			i2p_outbound_length,
 
+			// the max number of web seed connections to have open to any single
+			// host (and port), across all torrents. When many torrents share the
+			// same web seed server, this avoids opening one connection per
+			// torrent to it. Torrents that hit the limit retry connecting on
+			// their next tick (see ``tick_interval``), once the number of
+			// connections to the host has dropped below the limit. 0 means
+			// unlimited.
+			max_web_seed_connections_per_host,
+
+			// the max number of bytes of info-dictionaries to keep in the
+			// session's metadata cache. When a torrent receives its metadata
+			// from the swarm (e.g. when added as a magnet link), the
+			// info-dictionary is stored in this cache. If the same torrent is
+			// added again later, without metadata, it's picked up from the cache
+			// instead of being downloaded again. 0 disables the cache.
+			metadata_cache_size,
+
+			// the memory budget, in kiB, for the state of all torrents in the
+			// session, as reported by the ``ses.torrent_memory_*`` counters.
+			// When the estimated usage exceeds this budget, the peer lists of
+			// torrents are trimmed, starting with the largest, until the usage
+			// is 1/8 below the budget. Paused torrents drop their entire peer
+			// lists, active torrents drop half of the peers they are not
+			// connected to. If the budget can't be reached this way, peer
+			// lists are not trimmed again until the usage has grown by another
+			// 1/8 of the budget. 0 means no limit.
+			torrent_memory_budget,
+
+			// the number of seconds a paused, auto-managed and finished torrent
+			// needs to stay idle before it sheds its peer list. It keeps only
+			// a compact list of the peers it would save in its resume data.
+			// The peer list is restored transparently when the torrent is
+			// resumed, when a peer connects to it or when the peer list is
+			// needed by any other operation. The torrent_info, extensions and
+			// piece picker stay loaded. 0 disables shedding.
+			shed_peer_list_timeout,
+
 			max_int_setting_internal
 		};
 
@@ -80,9 +80,28 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <array>
 #include <functional>
 #include <exception>
 
+// kernel TLS offload needs TLS 1.3 key logging from OpenSSL and the
+// TCP_ULP "tls" socket option from Linux
+#if defined TORRENT_USE_OPENSSL && defined TORRENT_LINUX \
+	&& !defined TORRENT_BUILD_SIMULATOR \
+	&& OPENSSL_VERSION_NUMBER >= 0x10101000L
+#define TORRENT_USE_KTLS 1
+#else
+#define TORRENT_USE_KTLS 0
+#endif
+
+// resuming sessions relies on the session API of OpenSSL 1.1.1
+#if defined TORRENT_USE_OPENSSL && OPENSSL_VERSION_NUMBER >= 0x10101000L
+#define TORRENT_USE_SSL_SESSION_CACHE 1
+#else
+#define TORRENT_USE_SSL_SESSION_CACHE 0
+#endif
+
 namespace libtorrent {
 namespace ssl {
 
@@ -174,10 +193,78 @@ TORRENT_EXTRA_EXPORT void set_trust_certificate(native_context_type nc, string_v
 TORRENT_EXTRA_EXPORT void set_server_name_callback(context_handle_type c, server_name_callback_type cb, void* arg, error_code& ec);
 TORRENT_EXTRA_EXPORT void set_host_name(stream_handle_type s, std::string const& name, error_code& ec);
 
-TORRENT_EXTRA_EXPORT void set_context(stream_handle_type s, context_handle_type c);
+// switches a server stream over to c. Returns false if the stream is
+// resuming a session that wasn't established on a context with the same
+// session ID context, in which case the connection must be refused
+TORRENT_EXTRA_EXPORT bool set_context(stream_handle_type s, context_handle_type c);
 TORRENT_EXTRA_EXPORT bool has_context(stream_handle_type s, context_handle_type c);
 TORRENT_EXTRA_EXPORT context_handle_type get_context(stream_handle_type s);
 
+// sessions can only be resumed into a context with the same session ID
+// context. Servers verifying peer certificates must set one. This includes
+// contexts a server stream is switched to with set_context()
+TORRENT_EXTRA_EXPORT void set_session_id_context(context_handle_type c, string_view id);
+
+// keeps the sessions that client connections using this context establish,
+// so that reconnecting to the same endpoint can skip the full handshake.
+// The cache belongs to the context and is freed with it
+TORRENT_EXTRA_EXPORT void enable_session_cache(context_handle_type c);
+TORRENT_EXTRA_EXPORT void clear_session_cache(context_handle_type c);
+TORRENT_EXTRA_EXPORT int session_cache_size(context_handle_type c);
+
+// to be called on a client stream before the handshake. key identifies the
+// endpoint we're connecting to, the server name is added to it. If the
+// cache has a session for it, we offer to resume it. Sessions established
+// by this stream are stored under the same key
+TORRENT_EXTRA_EXPORT void resume_session(stream_handle_type s, string_view key);
+
+// drops the session cached for a client stream, for instance because the
+// handshake failed
+TORRENT_EXTRA_EXPORT void forget_session(stream_handle_type s);
+
+#if TORRENT_USE_KTLS
+// the key and IV protecting the records we send on a TLS 1.3 connection,
+// in the form the kernel wants them
+struct ktls_tx_key
+{
+	// 16 for AES-128-GCM, 32 for AES-256-GCM
+	int key_size = 0;
+	std::array<std::uint8_t, 32> key{};
+	std::array<std::uint8_t, 12> iv{};
+};
+
+// returns true if the kernel has the "tls" upper layer protocol. The
+// result of the first probe is cached
+TORRENT_EXTRA_EXPORT bool ktls_supported();
+
+// makes connections using this context capture their transmit traffic
+// secret during the handshake, so it can be handed to the kernel
+// afterwards. This also stops the server side from issuing session
+// tickets, since those would be encrypted with the same key in
+// userspace, leaving the kernel's record sequence number behind
+TORRENT_EXTRA_EXPORT void enable_ktls(context_handle_type c);
+TORRENT_EXTRA_EXPORT bool ktls_enabled(context_handle_type c);
+
+// derives the transmit key of a completed TLS 1.3 handshake. Returns false
+// if no secret was captured or the cipher suite isn't one the kernel
+// supports
+TORRENT_EXTRA_EXPORT bool get_ktls_tx_key(stream_handle_type s, ktls_tx_key& k);
+
+// installs the transmit key of s on the TCP socket fd, so that anything
+// written to fd from now on is sent as TLS application data records.
+// Must be called right after the handshake completed, before any
+// application data has been sent. Returns false if that isn't possible,
+// in which case OpenSSL keeps encrypting
+TORRENT_EXTRA_EXPORT bool enable_ktls_tx(stream_handle_type s, int fd);
+
+// makes every record OpenSSL tries to send on s fail. This is called once
+// the kernel encrypts for s. OpenSSL may still want to send
+// post-handshake messages, like the KeyUpdate a peer can ask for, or an
+// alert. Those would be encrypted twice and corrupt the stream. Instead,
+// the SSL_read() that triggered them fails, and the connection is closed
+TORRENT_EXTRA_EXPORT void disable_userspace_tx(stream_handle_type s);
+#endif
+
 } // ssl
 } // libtorrent
 
@@ -42,6 +42,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #if TORRENT_USE_SSL
 
 #include "libtorrent/socket.hpp"
+#include "libtorrent/socket_io.hpp" // for print_endpoint
 #include "libtorrent/error_code.hpp"
 #include "libtorrent/io_context.hpp"
 #include "libtorrent/ssl.hpp"
@@ -111,6 +112,10 @@ struct ssl_stream
 		// 1. connect to peer
 		// 2. perform SSL client handshake
 
+		// if we've been connected to this endpoint before, try to resume
+		// that session instead of doing a full handshake
+		ssl::resume_session(handle(), print_endpoint(endpoint));
+
 		m_sock->next_layer().async_connect(endpoint, wrap_allocator(
 			[this](error_code const& ec, Handler hn) {
 				connected(ec, std::move(hn));
@@ -131,6 +136,9 @@ struct ssl_stream
 	{
 		// this is used for accepting SSL connections
 		m_sock->handshake(ssl::stream_base::server, ec);
+#if TORRENT_USE_KTLS
+		if (!ec) enable_ktls_tx(m_sock->next_layer());
+#endif
 	}
 
 	template <class Handler>
@@ -138,11 +146,24 @@ struct ssl_stream
 	{
 		error_code ec;
 		m_sock->next_layer().cancel(ec);
+#if TORRENT_USE_KTLS
+		// OpenSSL no longer knows the record sequence number of the
+		// connection, so it can't send close_notify. Just close the socket
+		if (m_ktls_tx)
+		{
+			post(m_sock->get_executor(), [h = std::move(handler)]() mutable
+				{ h(error_code()); });
+			return;
+		}
+#endif
 		m_sock->async_shutdown(std::move(handler));
 	}
 
 	void shutdown(error_code& ec)
 	{
+#if TORRENT_USE_KTLS
+		if (m_ktls_tx) return;
+#endif
 		m_sock->shutdown(ec);
 	}
 
@@ -216,12 +237,23 @@ struct ssl_stream
 	template <class Const_Buffers, class Handler>
 	void async_write_some(Const_Buffers const& buffers, Handler handler)
 	{
+#if TORRENT_USE_KTLS
+		// the kernel encrypts what we send
+		if (m_ktls_tx)
+		{
+			m_sock->next_layer().async_write_some(buffers, std::move(handler));
+			return;
+		}
+#endif
 		m_sock->async_write_some(buffers, std::move(handler));
 	}
 
 	template <class Const_Buffers>
 	std::size_t write_some(Const_Buffers const& buffers, error_code& ec)
 	{
+#if TORRENT_USE_KTLS
+		if (m_ktls_tx) return m_sock->next_layer().write_some(buffers, ec);
+#endif
 		return m_sock->write_some(buffers, ec);
 	}
 
@@ -341,11 +373,34 @@ private:
 	template <typename Handler>
 	void handshake(error_code const& e, Handler h)
 	{
+		// don't offer a session the server didn't accept again
+		if (e) ssl::forget_session(handle());
+#if TORRENT_USE_KTLS
+		if (!e) enable_ktls_tx(m_sock->next_layer());
+#endif
 		h(e);
 	}
 
+#if TORRENT_USE_KTLS
+	// once the handshake is done, hand encryption of outgoing records over
+	// to the kernel, if the context asked for it. This only works when
+	// we're talking TLS directly over a TCP socket
+	template <typename S>
+	void enable_ktls_tx(S&) {}
+
+	void enable_ktls_tx(tcp::socket& s)
+	{
+		if (!ssl::ktls_enabled(context_handle())) return;
+		m_ktls_tx = ssl::enable_ktls_tx(handle(), s.native_handle());
+	}
+#endif
+
 	// to make us movable
 	std::unique_ptr<ssl::stream<Stream>> m_sock;
+
+#if TORRENT_USE_KTLS
+	bool m_ktls_tx = false;
+#endif
 };
 
 }
@@ -51,6 +51,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <deque>
 #include <limits> // for numeric_limits
 #include <memory> // for unique_ptr
+#include <mutex>
+#include <atomic>
 
 #include "libtorrent/aux_/disable_warnings_push.hpp"
 #include <boost/logic/tribool.hpp>
@@ -84,6 +86,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/piece_block.hpp"
 #include "libtorrent/disk_interface.hpp"
 #include "libtorrent/aux_/file_progress.hpp"
+#include "libtorrent/aux_/availability_index.hpp"
+#include "libtorrent/aux_/indexed_queue.hpp"
 #include "libtorrent/aux_/suggest_piece.hpp"
 #include "libtorrent/units.hpp"
 #include "libtorrent/aux_/vector.hpp"
@@ -132,6 +136,21 @@ namespace libtorrent {
 
 	TORRENT_EXTRA_EXPORT std::int64_t calc_bytes(file_storage const& fs, piece_count const& pc);
 
+	// internal
+	// the estimated number of bytes of memory used by a torrent, per
+	// subsystem. These correspond to the torrent_memory_* counters
+	struct torrent_memory_usage
+	{
+		std::int64_t metadata = 0;
+		std::int64_t piece_picker = 0;
+		std::int64_t peer_list = 0;
+		std::int64_t hash_trees = 0;
+		std::int64_t extensions = 0;
+
+		std::int64_t total() const
+		{ return metadata + piece_picker + peer_list + hash_trees + extensions; }
+	};
+
 #ifndef TORRENT_DISABLE_STREAMING
 	struct time_critical_piece
 	{
@@ -275,6 +294,13 @@ namespace libtorrent {
 		// the case there is no piece picker, see m_have_all.
 		std::unique_ptr<piece_picker> m_picker;
 
+		// the number of peers that have each piece, ordered by rarity. This
+		// is only maintained while super seeding or in share mode, where we
+		// need the rarest pieces whether or not we have a piece picker. It's
+		// allocated on-demand in torrent::need_availability() and released
+		// when neither mode is enabled anymore.
+		std::unique_ptr<aux::availability_index> m_availability;
+
 		std::unique_ptr<hash_picker> m_hash_picker;
 
 		// TODO: make this a raw pointer. perhaps keep the shared_ptr
@@ -516,14 +542,13 @@ namespace libtorrent {
 		void queue_up();
 		void queue_down();
 		void set_queue_position(queue_position_t p);
-		queue_position_t queue_position() const { return m_sequence_number; }
-		// used internally
-		void set_queue_position_impl(queue_position_t const p)
+		queue_position_t queue_position() const
 		{
-			if (m_sequence_number == p) return;
-			m_sequence_number = p;
-			state_updated();
+			if (!m_queue_node.in_queue()) return no_pos;
+			return queue_position_t{aux::indexed_queue<torrent>::position(m_queue_node)};
 		}
+		// used internally, by the session's download queue
+		aux::queue_node<torrent>& queue_entry() { return m_queue_node; }
 
 		void second_tick(int tick_interval_ms);
 
@@ -654,6 +679,29 @@ namespace libtorrent {
 		// it, add it to the m_state_updates list in session_impl
 		void state_updated();
 
+		// returns the most recently published status snapshot, or nullptr if
+		// none has been published yet. This may be called from any thread
+		std::shared_ptr<torrent_status const> status_snapshot() const;
+
+		// builds a new status snapshot and makes it visible to
+		// status_snapshot(). Once called, the torrent is subscribed to
+		// snapshot updates and will be re-published by the session whenever
+		// state_updated() is called
+		void publish_status_snapshot();
+
+		// estimates the memory used by this torrent
+		torrent_memory_usage memory_usage();
+
+		// updates the session's torrent_memory_* counters with the current
+		// memory usage of this torrent
+		void update_memory_counters();
+
+		// erases peers we're not connected to from the peer list, to reduce
+		// memory usage. Paused torrents drop their entire peer list, others
+		// drop half of the unconnected peers. Returns the estimated number
+		// of bytes freed
+		std::int64_t shed_peer_list();
+
 		void file_progress(aux::vector<std::int64_t, file_index_t>& fp, file_progress_flags_t flags);
 		void post_file_progress(file_progress_flags_t flags);
 
@@ -739,14 +787,33 @@ namespace libtorrent {
 		void update_want_tick();
 		void update_state_list();
 
+		// keeps this torrent's entry in the session's order of queued seeds
+		// up to date. This needs to be called whenever anything its seed
+		// rank depends on may have changed while it's paused
+		void update_seed_order();
+
 		bool want_peers() const;
 		bool want_peers_download() const;
 		bool want_peers_finished() const;
 
 		void update_want_peers();
 		void update_want_scrape();
+		void update_want_shed_peer_list();
 		void update_gauge();
 
+		// releases the peer list of this idle torrent, keeping a compact copy
+		// of the peers worth saving. Returns false if the torrent still has
+		// connections and can't shed its peer list yet
+		bool shed_idle_peer_list();
+
+		// restores the peer list released by shed_idle_peer_list(). This is called
+		// implicitly whenever the peer list is needed
+		void restore_peer_list();
+
+		bool is_peer_list_shed() const { return m_peer_list_shed; }
+		time_point32 shed_candidate_since() const
+		{ return m_shed_candidate_since; }
+
 		bool try_connect_peer();
 		torrent_peer* add_peer(tcp::endpoint const& adr
 			, peer_source_flags_t source, pex_flags_t flags = {});
@@ -756,6 +823,10 @@ namespace libtorrent {
 		void clear_failcount(torrent_peer* p);
 		std::pair<peer_list::iterator, peer_list::iterator> find_peers(address const& a);
 
+		// returns true if p is the torrent_peer of one of this torrent's web
+		// seeds. Those are not part of the peer list
+		bool is_web_seed_peer(torrent_peer const* p) const;
+
 		// the number of peers that belong to this torrent
 		int num_peers() const { return int(m_connections.size() - m_peers_to_disconnect.size()); }
 		int num_seeds() const;
@@ -976,6 +1047,12 @@ namespace libtorrent {
 
 		void connect_web_seed(std::list<web_seed_t>::iterator web, tcp::endpoint a);
 
+		// returns true if the session already has as many web seed
+		// connections to this host and port as
+		// settings_pack::max_web_seed_connections_per_host allows
+		bool web_seed_host_limit_reached(web_seed_t const& web
+			, std::string const& host, int port) const;
+
 		// this is the asio callback that is called when a name
 		// lookup for a proxy for a web seed is completed.
 		void on_proxy_name_lookup(error_code const& e
@@ -1066,6 +1143,8 @@ namespace libtorrent {
 			return *m_picker;
 		}
 		void need_picker();
+		void need_availability();
+		void release_availability();
 		bool has_picker() const
 		{
 			return m_picker.get() != nullptr;
@@ -1185,7 +1264,7 @@ namespace libtorrent {
 		// a return value of false indicates an error
 		bool set_metadata(span<char const> metadata);
 
-		queue_position_t sequence_number() const { return m_sequence_number; }
+		queue_position_t sequence_number() const { return queue_position(); }
 
 		bool seed_mode() const { return m_seed_mode; }
 
@@ -1230,6 +1309,12 @@ namespace libtorrent {
 			m_links[aux::session_interface::torrent_state_updates].clear();
 		}
 
+		void clear_in_snapshot_update()
+		{
+			TORRENT_ASSERT(m_links[aux::session_interface::torrent_snapshot_updates].in_list());
+			m_links[aux::session_interface::torrent_snapshot_updates].clear();
+		}
+
 		void inc_num_connecting(torrent_peer* pp)
 		{
 			++m_num_connecting;
@@ -1341,6 +1426,10 @@ namespace libtorrent {
 
 		void need_peer_list();
 
+		// fills in the peers worth saving in the resume data
+		void collect_resume_peers(std::vector<tcp::endpoint>& peers
+			, std::vector<tcp::endpoint>& banned) const;
+
 		std::shared_ptr<const ip_filter> m_ip_filter;
 
 		// all time totals of uploaded and downloaded payload
@@ -1541,9 +1630,9 @@ namespace libtorrent {
 		std::int64_t m_total_failed_bytes = 0;
 		std::int64_t m_total_redundant_bytes = 0;
 
-		// the sequence number for this torrent, this is a
-		// monotonically increasing number for each added torrent
-		queue_position_t m_sequence_number;
+		// this torrent's entry in the session's download queue. Its position
+		// in the queue is the torrent's queue position
+		aux::queue_node<torrent> m_queue_node;
 
 		// used to post a message to defer disconnecting peers
 		std::vector<std::shared_ptr<peer_connection>> m_peers_to_disconnect;
@@ -1814,6 +1903,44 @@ namespace libtorrent {
 		// prevent us from sending it again to anyone
 		bool m_complete_sent:1;
 
+// ----
+
+		// this is set the first time a client asks for a status snapshot.
+		// From then on, state changes put the torrent on the
+		// torrent_snapshot_updates list in the session
+		std::atomic<bool> m_snapshot_subscription{false};
+
+		// the last status snapshot published by the network thread. It's read
+		// by client threads via status_snapshot(). The mutex only protects
+		// swapping the pointer, the torrent_status itself is immutable once
+		// published
+		mutable std::mutex m_snapshot_mutex;
+		std::shared_ptr<torrent_status const> m_status_snapshot;
+
+		// the memory usage last added to the session's counters
+		torrent_memory_usage m_memory_accounted;
+
+		// computing the size of the torrent_info is proportional to the number
+		// of files, so it's only done when m_torrent_file changes
+		torrent_info const* m_memory_ti = nullptr;
+		std::int64_t m_memory_ti_size = 0;
+
+		// while the peer list is shed, these are the peers from the peer list that
+		// would be saved in the resume data. Each entry is a flags byte
+		// (shed_peer_v6, shed_peer_banned), the address and the
+		// port
+		std::vector<char> m_shed_peers;
+
+		// the time this torrent was added to the torrent_want_shed_peer_list list
+		time_point32 m_shed_candidate_since;
+
+		// true while the peer list is released, see shed_idle_peer_list()
+		bool m_peer_list_shed = false;
+
+		// the seed rank this torrent has in the session's order of queued
+		// seeds, or -1 if it's not a paused, auto-managed seed
+		int m_queued_seed_rank = -1;
+
 #if TORRENT_USE_ASSERTS
 		// set to true when torrent is start()ed. It may only be started once
 		bool m_was_started = false;
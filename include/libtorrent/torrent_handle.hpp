@@ -362,6 +362,12 @@ namespace aux {
 		// includes ``save_path``, the path to the directory the files of the
 		// torrent are saved to.
 		static constexpr status_flags_t query_save_path = 7_bit;
+		// includes the ``memory_*`` fields, the estimated memory usage of
+		// the torrent. Since this walks the file list and merkle trees of
+		// the torrent, the default flags of ``status()``, ``post_status()``
+		// and session_handle::post_torrent_updates() leave it out. It is
+		// part of ``status_flags_t::all()``.
+		static constexpr status_flags_t query_memory_usage = 8_bit;
 
 		// ``status()`` will return a structure with information about the status
 		// of this torrent. If the torrent_handle is invalid, it will throw
@@ -380,10 +386,65 @@ namespace aux {
 		// In order to get regular updates for torrents whose status changes,
 		// consider calling session::post_torrent_updates()`` instead.
 		//
-		// By default everything is included. The flags you can use to decide
-		// what to *include* are defined in this class.
-		torrent_status status(status_flags_t flags = status_flags_t::all()) const;
-		void post_status(status_flags_t flags = status_flags_t::all()) const;
+		// By default everything except ``query_memory_usage`` is included.
+		// The flags you can use to decide what to *include* are defined in
+		// this class.
+		torrent_status status(status_flags_t flags
+			= status_flags_t::all() & ~query_memory_usage) const;
+		void post_status(status_flags_t flags
+			= status_flags_t::all() & ~query_memory_usage) const;
+
+		// ``status_snapshot()`` returns the most recent torrent_status the
+		// libtorrent network thread has published for this torrent, without
+		// waiting for it. This makes it suitable for polling the state of
+		// many torrents at a high rate, from any thread.
+		//
+		// The first call for a torrent blocks, just like ``status()``, to
+		// publish the initial snapshot. After that, any change that would
+		// make the torrent appear in a state_update_alert causes the snapshot
+		// to be re-published on the next session tick. A snapshot is
+		// therefore never more than one ``settings_pack::tick_interval``
+		// behind the torrent's actual state. All fields are included, as
+		// with ``status_flags_t::all()``, except the ones requiring
+		// ``query_accurate_download_counters`` or ``query_memory_usage``,
+		// which are too expensive to compute on every update.
+		//
+		// The returned object is immutable and may be held on to for as long
+		// as needed. It is not updated in-place, call ``status_snapshot()``
+		// again to get a more recent one.
+		std::shared_ptr<torrent_status const> status_snapshot() const;
+
+		// These are non-blocking versions of ``status()``,
+		// ``get_peer_info()``, ``get_download_queue()``, ``file_progress()``,
+		// ``get_piece_priorities()``, ``get_file_priorities()`` and
+		// ``trackers()``. They return immediately and ``handler`` is called
+		// with the result once the libtorrent network thread has processed
+		// the request.
+		//
+		// ``handler`` is always called exactly once, with an error_code and
+		// the result. If the error_code is set, the result is default
+		// constructed. This happens if the call fails on the network thread,
+		// or if the session shuts down before the call was run
+		// (operation_aborted). If the handle is invalid, ``handler`` is
+		// called right away, on the calling thread, with
+		// errors::invalid_torrent_handle. Otherwise it is invoked on the
+		// network thread. It must not block, and in particular it must not
+		// call any of the synchronous functions on session_handle or
+		// torrent_handle.
+		void async_status(status_flags_t flags
+			, std::function<void(error_code const&, torrent_status)> handler) const;
+		void async_get_peer_info(
+			std::function<void(error_code const&, std::vector<peer_info>)> handler) const;
+		void async_get_download_queue(
+			std::function<void(error_code const&, std::vector<partial_piece_info>)> handler) const;
+		void async_file_progress(file_progress_flags_t flags
+			, std::function<void(error_code const&, std::vector<std::int64_t>)> handler) const;
+		void async_get_piece_priorities(
+			std::function<void(error_code const&, std::vector<download_priority_t>)> handler) const;
+		void async_get_file_priorities(
+			std::function<void(error_code const&, std::vector<download_priority_t>)> handler) const;
+		void async_trackers(
+			std::function<void(error_code const&, std::vector<announce_entry>)> handler) const;
 
 		// ``post_download_queue()`` triggers a download_queue_alert to be
 		// posted.
@@ -1409,6 +1470,10 @@ namespace aux {
 		template<typename Ret, typename Fun, typename... Args>
 		Ret sync_call_ret(Ret def, Fun f, Args&&... a) const;
 
+		template<typename Ret, typename Fun>
+		void async_call_handler(std::function<void(error_code const&, Ret)> handler
+			, Fun f) const;
+
 		explicit torrent_handle(std::weak_ptr<torrent> const& t)
 		{ if (!t.expired()) m_torrent = t; }
 
@@ -596,6 +596,8 @@ TORRENT_VERSION_NAMESPACE_3
 		// This function looks up keys from the info-dictionary of the loaded
 		// torrent file. It can be used to access extension values put in the
 		// .torrent file. If the specified key cannot be found, it returns nullptr.
+		// Only the value of the key is decoded, and the returned node is only
+		// valid as long as this torrent_info object.
 		bdecode_node info(char const* key) const;
 
 		// returns a the raw info section of the torrent file.
@@ -638,6 +640,11 @@ TORRENT_VERSION_NAMESPACE_3
 		void internal_set_creation_date(std::time_t);
 		void internal_set_comment(string_view);
 
+		// internal
+		// returns an estimate of the number of bytes of memory used by this
+		// object, including the file list and the info section
+		std::int64_t memory_usage() const;
+
 #if TORRENT_ABI_VERSION <= 2
 		// support for BEP 30 merkle torrents has been removed
 
@@ -739,10 +746,6 @@ TORRENT_VERSION_NAMESPACE_3
 		// to create the torrent file
 		std::string m_created_by;
 
-		// the info section parsed. points into m_info_section
-		// parsed lazily
-		mutable bdecode_node m_info_dict;
-
 		// if a creation date is found in the torrent file
 		// this will be set to that, otherwise it'll be
 		// 1970, Jan 1
@@ -542,6 +542,10 @@ TORRENT_VERSION_NAMESPACE_3
 		// if a large file ends up being copied from one drive to another.
 		bool moving_storage = false;
 
+		// true if this torrent is idle and has released its peer list. See
+		// settings_pack::shed_peer_list_timeout.
+		bool peer_list_shed = false;
+
 #if TORRENT_ABI_VERSION == 1
 		// true if this torrent is loaded into RAM. A torrent can be started
 		// and still not loaded into RAM, in case it has not had any peers interested in it
@@ -591,6 +595,20 @@ TORRENT_VERSION_NAMESPACE_3
 		// reflects several of the torrent's flags. For more
 		// information, see ``torrent_handle::flags()``.
 		torrent_flags_t flags{};
+
+		// the estimated number of bytes of memory used by this torrent, per
+		// subsystem. ``memory_metadata`` is the torrent_info (including the
+		// file list and info section), ``memory_piece_picker`` is the
+		// download state, ``memory_peer_list`` is the list of known peers,
+		// ``memory_hash_trees`` is the v2 merkle trees and
+		// ``memory_extensions`` is the state reported by torrent plugins.
+		// These are only set if ``query_memory_usage`` is passed to
+		// ``status()``, which the default flags don't include.
+		std::int64_t memory_metadata = 0;
+		std::int64_t memory_piece_picker = 0;
+		std::int64_t memory_peer_list = 0;
+		std::int64_t memory_hash_trees = 0;
+		std::int64_t memory_extensions = 0;
 	};
 
 TORRENT_VERSION_NAMESPACE_3_END
@@ -46,6 +46,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/piece_block_progress.hpp"
 #include "libtorrent/operations.hpp" // for operation_t enum
 #include "libtorrent/aux_/vector.hpp"
+#include "libtorrent/aux_/web_request_queue.hpp"
 
 namespace libtorrent {
 
@@ -78,12 +79,15 @@ namespace libtorrent {
 			, operation_t op, disconnect_severity_t error = peer_connection_interface::normal) override;
 
 		void write_request(peer_request const& r) override;
+		void write_cancel(peer_request const& r) override;
 
 		bool received_invalid_data(piece_index_t index, bool single_peer) override;
 
 	private:
 
-		void on_receive_padfile();
+		// sends all HTTP requests queued up in m_pending_requests,
+		// merging adjacent byte ranges
+		void on_send_pending_requests();
 		void incoming_payload(char const* buf, int len);
 		void incoming_zeroes(int len);
 		void handle_redirect(int bytes_left);
@@ -102,13 +106,12 @@ namespace libtorrent {
 
 		// this has one entry per http-request
 		// (might be more than the bt requests)
-		struct file_request_t
-		{
-			file_index_t file_index;
-			int length;
-			std::int64_t start;
-		};
-		std::deque<file_request_t> m_file_requests;
+		std::deque<aux::web_file_request> m_file_requests;
+
+		// requests that have been issued by the bittorrent engine but not
+		// yet sent to the web server. They are sent as a batch by
+		// on_send_pending_requests()
+		aux::web_request_queue m_pending_requests;
 
 		std::string m_url;
 
@@ -141,6 +144,9 @@ namespace libtorrent {
 		// the number of responses we've received so far on
 		// this connection
 		int m_num_responses;
+
+		// true if on_send_pending_requests() has been posted, but not run yet
+		bool m_send_scheduled;
 	};
 }
 
@@ -0,0 +1,167 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "libtorrent/aux_/availability_index.hpp"
+#include "libtorrent/aux_/invariant_check.hpp"
+#include "libtorrent/assert.hpp"
+
+namespace libtorrent {
+namespace aux {
+
+	availability_index::availability_index(int const num_pieces)
+		: m_count(std::size_t(num_pieces), 0)
+		, m_pos(std::size_t(num_pieces))
+		, m_order(std::size_t(num_pieces))
+		, m_level_start{0, num_pieces}
+	{
+		for (piece_index_t i(0); i < m_pos.end_index(); ++i)
+		{
+			m_pos[i] = static_cast<int>(i);
+			m_order[std::size_t(static_cast<int>(i))] = i;
+		}
+	}
+
+	void availability_index::move_to(piece_index_t const index, int const pos)
+	{
+		int const old_pos = m_pos[index];
+		piece_index_t const other = m_order[std::size_t(pos)];
+		m_order[std::size_t(old_pos)] = other;
+		m_pos[other] = old_pos;
+		m_order[std::size_t(pos)] = index;
+		m_pos[index] = pos;
+	}
+
+	void availability_index::inc(piece_index_t const index)
+	{
+#ifdef TORRENT_EXPENSIVE_INVARIANT_CHECKS
+		INVARIANT_CHECK;
+#endif
+		std::size_t const level = std::size_t(m_count[index]);
+		if (int(level) + 1 == num_levels())
+			m_level_start.push_back(num_pieces());
+
+		// move the piece to the end of its level and make that slot the
+		// start of the next level
+		move_to(index, m_level_start[level + 1] - 1);
+		--m_level_start[level + 1];
+		++m_count[index];
+	}
+
+	void availability_index::dec(piece_index_t const index)
+	{
+#ifdef TORRENT_EXPENSIVE_INVARIANT_CHECKS
+		INVARIANT_CHECK;
+#endif
+		if (m_count[index] == 0) break_one_seed();
+
+		// move the piece to the start of its level and make that slot the
+		// end of the previous level
+		std::size_t const level = std::size_t(m_count[index]);
+		move_to(index, m_level_start[level]);
+		++m_level_start[level];
+		--m_count[index];
+
+		while (num_levels() > 1
+			&& m_level_start[std::size_t(num_levels()) - 1] == num_pieces())
+		{
+			m_level_start.pop_back();
+		}
+	}
+
+	void availability_index::inc(typed_bitfield<piece_index_t> const& bits)
+	{
+		TORRENT_ASSERT(bits.size() == num_pieces());
+		bits.for_each_set([this](piece_index_t const i) { inc(i); });
+	}
+
+	void availability_index::dec(typed_bitfield<piece_index_t> const& bits)
+	{
+		TORRENT_ASSERT(bits.size() == num_pieces());
+		bits.for_each_set([this](piece_index_t const i) { dec(i); });
+	}
+
+	void availability_index::inc_all()
+	{
+		++m_seeds;
+	}
+
+	void availability_index::dec_all()
+	{
+#ifdef TORRENT_EXPENSIVE_INVARIANT_CHECKS
+		INVARIANT_CHECK;
+#endif
+		if (m_seeds > 0)
+		{
+			--m_seeds;
+			return;
+		}
+
+		// every piece has at least one peer, so there are no pieces with a
+		// count of 0 and every level moves down by one
+		TORRENT_ASSERT(m_level_start[1] == 0);
+		for (auto& c : m_count)
+		{
+			TORRENT_ASSERT(c > 0);
+			--c;
+		}
+		m_level_start.erase(m_level_start.begin());
+	}
+
+	void availability_index::break_one_seed()
+	{
+		TORRENT_ASSERT(m_seeds > 0);
+		--m_seeds;
+		for (auto& c : m_count) ++c;
+		m_level_start.insert(m_level_start.begin(), 0);
+	}
+
+#if TORRENT_USE_INVARIANT_CHECKS
+	void availability_index::check_invariant() const
+	{
+		TORRENT_ASSERT(m_seeds >= 0);
+		TORRENT_ASSERT(m_level_start.size() >= 2);
+		TORRENT_ASSERT(m_level_start.front() == 0);
+		TORRENT_ASSERT(m_level_start.back() == num_pieces());
+		for (int level = 0; level < num_levels(); ++level)
+		{
+			int const begin = m_level_start[std::size_t(level)];
+			int const end = m_level_start[std::size_t(level) + 1];
+			TORRENT_ASSERT(begin <= end);
+			for (int i = begin; i < end; ++i)
+			{
+				piece_index_t const p = m_order[std::size_t(i)];
+				TORRENT_ASSERT(m_pos[p] == i);
+				TORRENT_ASSERT(m_count[p] == level);
+			}
+		}
+	}
+#endif
+} }
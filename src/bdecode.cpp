@@ -82,31 +82,19 @@ namespace {
 			}
 		}
 
-		int digits = 0;
-		do
-		{
-			if (!numeric(*start))
-			{
-				e = bdecode_errors::expected_digit;
-				break;
-			}
-			++start;
-			++digits;
+		char const* const digits_end = aux::find_non_digit(start, end);
 
-			if (start == end)
-			{
-				e = bdecode_errors::unexpected_eof;
-				break;
-			}
-		}
-		while (*start != 'e');
+		if (digits_end == start)
+			e = bdecode_errors::expected_digit;
+		else if (digits_end == end)
+			e = bdecode_errors::unexpected_eof;
+		else if (*digits_end != 'e')
+			e = bdecode_errors::expected_digit;
 
-		if (digits > 20)
-		{
+		if (digits_end - start > 20)
 			e = bdecode_errors::overflow;
-		}
 
-		return start;
+		return digits_end;
 	}
 
 	struct stack_frame
@@ -127,9 +115,159 @@ namespace {
 		return (&t)[1].offset - t.offset;
 	}
 
+	// parses the length prefix of the string starting at ``start``. Returns a
+	// pointer to the first byte of the string itself and sets ``len`` to its
+	// length. The whole string is verified to fit in the buffer
+	char const* parse_string_header(char const* start, char const* end
+		, std::int64_t& len, bdecode_errors::error_code_enum& e)
+	{
+		TORRENT_ASSERT(start != end && numeric(*start));
+		len = *start - '0';
+		++start;
+		if (start >= end)
+		{
+			e = bdecode_errors::unexpected_eof;
+			return start;
+		}
+		start = parse_int(start, end, ':', len, e);
+		if (e) return start;
+		if (start == end)
+		{
+			e = bdecode_errors::expected_colon;
+			return start;
+		}
+		// remaining buffer size excluding ':'
+		if (len > end - start - 1)
+		{
+			e = bdecode_errors::unexpected_eof;
+			return start;
+		}
+		if (len < 0)
+		{
+			e = bdecode_errors::overflow;
+			return start;
+		}
+		// skip ':'
+		return start + 1;
+	}
+
+	// validates the bencoded item starting at ``start`` and returns a pointer
+	// one past its end. This enforces the same rules as bdecode(), but does
+	// not produce any tokens, and does not allocate memory.
+	char const* skip_item(char const* start, char const* end, int const depth_limit
+		, bdecode_errors::error_code_enum& e)
+	{
+		// one entry per nested container. Bit 0 is set for dictionaries, bit 1
+		// is set when the next item in the dictionary is a value (as opposed
+		// to a key)
+		TORRENT_ALLOCA(stack, std::uint8_t, depth_limit);
+		int sp = 0;
+
+		do
+		{
+			if (start >= end)
+			{
+				e = bdecode_errors::unexpected_eof;
+				return start;
+			}
+
+			char const t = *start;
+			int const current_frame = sp;
+
+			if (current_frame > 0 && stack[current_frame - 1] == 1)
+			{
+				// the current parent is a dict and we are parsing a key.
+				// only allow a digit (for a string) or 'e' to terminate
+				if (!numeric(t) && t != 'e')
+				{
+					e = bdecode_errors::expected_digit;
+					return start;
+				}
+			}
+
+			switch (t)
+			{
+				case 'd':
+				case 'l':
+					if (sp >= depth_limit)
+					{
+						e = bdecode_errors::depth_exceeded;
+						return start;
+					}
+					stack[sp++] = (t == 'd') ? 1 : 0;
+					++start;
+					break;
+				case 'i':
+					start = check_integer(start + 1, end, e);
+					if (e) return start;
+					TORRENT_ASSERT(*start == 'e');
+					++start;
+					break;
+				case 'e':
+					if (sp == 0)
+					{
+						e = bdecode_errors::unexpected_eof;
+						return start;
+					}
+					if (stack[sp - 1] == 3)
+					{
+						// a dictionary key without a value
+						e = bdecode_errors::expected_value;
+						return start;
+					}
+					--sp;
+					++start;
+					break;
+				default:
+				{
+					if (!numeric(t))
+					{
+						e = bdecode_errors::expected_value;
+						return start;
+					}
+					std::int64_t len;
+					start = parse_string_header(start, end, len, e);
+					if (e) return start;
+					start += len;
+					break;
+				}
+			}
+
+			// flip between key and value in the parent dictionary
+			if (current_frame > 0 && (stack[current_frame - 1] & 1))
+				stack[current_frame - 1] ^= 2;
+		}
+		while (sp > 0);
+
+		return start;
+	}
+
 } // anonymous namespace
 
 namespace aux {
+
+	char const* find_non_digit(char const* start, char const* end)
+	{
+		// check 8 characters at a time. A byte is a digit if its high nibble
+		// is 3 and its low nibble is less than 10, i.e. adding 6 to the low
+		// nibble does not carry into the high nibble. Neither operation can
+		// carry across bytes.
+		while (end - start >= 8)
+		{
+			std::uint64_t w;
+			std::memcpy(&w, start, 8);
+			std::uint64_t const high = (w & 0xf0f0f0f0f0f0f0f0ULL) ^ 0x3030303030303030ULL;
+			std::uint64_t const low = ((w & 0x0f0f0f0f0f0f0f0fULL) + 0x0606060606060606ULL)
+				& 0xf0f0f0f0f0f0f0f0ULL;
+			// at least one of these 8 bytes is not a digit. Find out which one
+			// below
+			if ((high | low) != 0) break;
+			start += 8;
+		}
+		while (start != end && numeric(*start)) ++start;
+		return start;
+	}
+
 	void escape_string(std::string& ret, char const* str, int len)
 	{
 		if (std::any_of(str, str + len, [](char const c) { return c < 32 || c >= 127; } ))
@@ -162,6 +300,21 @@ namespace aux {
 		, std::int64_t& val, bdecode_errors::error_code_enum& ec)
 	{
 		TORRENT_ASSERT(val >= 0);
+		TORRENT_ASSERT(!numeric(delimiter));
+
+		// the common case is a short run of digits followed by the delimiter.
+		// If the value cannot possibly overflow, accumulate it without the
+		// overflow checks. 10 * 10^17 is still well within the range of int64
+		char const* const digits_end = aux::find_non_digit(start, end);
+		if (val < 10 && digits_end - start <= 17)
+		{
+			for (; start != digits_end; ++start)
+				val = val * 10 + (*start - '0');
+			if (start != end && *start != delimiter)
+				ec = bdecode_errors::expected_digit;
+			return start;
+		}
+
 		while (start < end && *start != delimiter)
 		{
 			char const c = *start;
@@ -1029,6 +1182,64 @@ done:
 		return ret;
 	}
 
+	span<char const> bdecode_find_key(span<char const> const buffer
+		, string_view const key, error_code& ec, int const depth_limit)
+	{
+		ec.clear();
+		char const* start = buffer.data();
+		char const* const end = start + buffer.size();
+
+		if (start == end)
+		{
+			ec = bdecode_errors::unexpected_eof;
+			return {};
+		}
+		if (*start != 'd' || depth_limit < 1)
+		{
+			ec = (*start != 'd') ? bdecode_errors::expected_value
+				: bdecode_errors::depth_exceeded;
+			return {};
+		}
+		++start;
+
+		bdecode_errors::error_code_enum e = bdecode_errors::no_error;
+		for (;;)
+		{
+			if (start == end)
+			{
+				ec = bdecode_errors::unexpected_eof;
+				return {};
+			}
+			// end of dictionary. The key was not found
+			if (*start == 'e') return {};
+			if (!numeric(*start))
+			{
+				ec = bdecode_errors::expected_digit;
+				return {};
+			}
+
+			std::int64_t len;
+			char const* const key_start = parse_string_header(start, end, len, e);
+			if (e)
+			{
+				ec = e;
+				return {};
+			}
+			start = key_start + len;
+
+			char const* const value_start = start;
+			start = skip_item(start, end, depth_limit - 1, e);
+			if (e)
+			{
+				ec = e;
+				return {};
+			}
+
+			if (string_view(key_start, std::size_t(len)) == key)
+				return {value_start, start - value_start};
+		}
+	}
+
 	namespace {
 
 	int line_longer_than(bdecode_node const& e, int limit)
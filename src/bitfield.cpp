@@ -36,12 +36,98 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/numeric_cast.hpp"
 #include "libtorrent/aux_/cpuid.hpp"
 
+#include <algorithm> // for min
+
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
 
 namespace libtorrent {
 
+namespace {
+
+	int popcount_sw(std::uint32_t const v)
+	{
+#if defined __GNUC__ || defined __clang__
+		return __builtin_popcount(v);
+#else
+		// from:
+		// http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+		std::uint32_t c = v - ((v >> 1) & 0x55555555);
+		c = ((c >> 2) & 0x33333333) + (c & 0x33333333);
+		c = ((c >> 4) + c) & 0x0F0F0F0F;
+		c = ((c >> 8) + c) & 0x00FF00FF;
+		c = ((c >> 16) + c) & 0x0000FFFF;
+		return int(c);
+#endif
+	}
+
+	// returns the number of bits set in op(lhs[i], rhs[i]) over all words.
+	// The byte order of the words doesn't matter here
+	template <typename Op>
+	int count_words(std::uint32_t const* lhs, std::uint32_t const* rhs
+		, int const words, Op op) noexcept
+	{
+		int ret = 0;
+#if TORRENT_HAS_SSE
+		if (aux::mmx_support)
+		{
+			for (int i = 0; i < words; ++i)
+			{
+#ifdef __GNUC__
+				std::uint32_t cnt = 0;
+				__asm__("popcnt %1, %0"
+					: "=r"(cnt)
+					: "r"(op(lhs[i], rhs[i])));
+				ret += int(cnt);
+#else
+				ret += int(_mm_popcnt_u32(op(lhs[i], rhs[i])));
+#endif
+			}
+			return ret;
+		}
+#endif // TORRENT_HAS_SSE
+
+		for (int i = 0; i < words; ++i)
+			ret += popcount_sw(op(lhs[i], rhs[i]));
+		return ret;
+	}
+
+	// returns true if op(lhs[i], rhs[i]) is non-zero for any word. Blocks
+	// of words are OR:ed together before being tested, to keep the inner
+	// loop free of branches
+	template <typename Op>
+	bool any_words(std::uint32_t const* lhs, std::uint32_t const* rhs
+		, int const words, Op op) noexcept
+	{
+		int constexpr block = 16;
+		int i = 0;
+		for (; i + block <= words; i += block)
+		{
+			std::uint32_t acc = 0;
+			for (int k = i; k < i + block; ++k)
+				acc |= op(lhs[k], rhs[k]);
+			if (acc != 0) return true;
+		}
+		std::uint32_t acc = 0;
+		for (; i < words; ++i)
+			acc |= op(lhs[i], rhs[i]);
+		return acc != 0;
+	}
+
+	struct and_op
+	{
+		std::uint32_t operator()(std::uint32_t const lhs, std::uint32_t const rhs) const
+		{ return lhs & rhs; }
+	};
+
+	struct and_not_op
+	{
+		std::uint32_t operator()(std::uint32_t const lhs, std::uint32_t const rhs) const
+		{ return lhs & ~rhs; }
+	};
+}
+
 	bool bitfield::all_set() const noexcept
 	{
 		if(size() == 0) return false;
@@ -234,6 +320,89 @@ namespace libtorrent {
 			: size - (aux::count_trailing_ones({&m_buf[1], num - 1}) + ext);
 	}
 
+	int bitfield::find_next_set(int const start) const noexcept
+	{
+		TORRENT_ASSERT(start >= 0);
+		TORRENT_ASSERT(start <= size());
+		int const num = num_words();
+		int const word = start / 32;
+		if (word >= num) return -1;
+
+		std::uint32_t const* b = buf();
+		// mask off the bits before start in the first word. The trailing bits
+		// of the last word are always clear, so there's no need to mask the
+		// end
+		std::uint32_t const first = b[word]
+			& aux::host_to_network(0xffffffff >> (start & 31));
+		if (first != 0)
+			return word * 32 + aux::count_leading_zeros({&first, 1});
+
+		int const rest = num - word - 1;
+		if (rest == 0) return -1;
+		int const count = aux::count_leading_zeros({b + word + 1, rest});
+		return count != rest * 32 ? (word + 1) * 32 + count : -1;
+	}
+
+	int bitfield::count_and(bitfield const& rhs) const noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		if (words == 0) return 0;
+		return count_words(buf(), rhs.buf(), words, and_op{});
+	}
+
+	int bitfield::count_and_not(bitfield const& rhs) const noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		if (words == 0) return 0;
+		return count_words(buf(), rhs.buf(), words, and_not_op{});
+	}
+
+	bool bitfield::any_and(bitfield const& rhs) const noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		if (words == 0) return false;
+		return any_words(buf(), rhs.buf(), words, and_op{});
+	}
+
+	bool bitfield::any_and_not(bitfield const& rhs) const noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		if (words == 0) return false;
+		return any_words(buf(), rhs.buf(), words, and_not_op{});
+	}
+
+	void bitfield::bitwise_and(bitfield const& rhs) noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		std::uint32_t* b = words > 0 ? buf() : nullptr;
+		std::uint32_t const* r = words > 0 ? rhs.buf() : nullptr;
+		for (int i = 0; i < words; ++i) b[i] &= r[i];
+	}
+
+	void bitfield::bitwise_or(bitfield const& rhs) noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		std::uint32_t* b = words > 0 ? buf() : nullptr;
+		std::uint32_t const* r = words > 0 ? rhs.buf() : nullptr;
+		for (int i = 0; i < words; ++i) b[i] |= r[i];
+		clear_trailing_bits();
+	}
+
+	void bitfield::bitwise_and_not(bitfield const& rhs) noexcept
+	{
+		TORRENT_ASSERT(size() == rhs.size());
+		int const words = std::min(num_words(), rhs.num_words());
+		std::uint32_t* b = words > 0 ? buf() : nullptr;
+		std::uint32_t const* r = words > 0 ? rhs.buf() : nullptr;
+		for (int i = 0; i < words; ++i) b[i] &= ~r[i];
+	}
+
 	static_assert(std::is_nothrow_move_constructible<bitfield>::value
 		, "should be nothrow move constructible");
 	static_assert(std::is_nothrow_move_assignable<bitfield>::value
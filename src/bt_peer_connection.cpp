@@ -542,7 +542,7 @@ namespace {
 
 		TORRENT_ASSERT(!m_encrypted);
 		TORRENT_ASSERT(!m_rc4_encrypted);
-		TORRENT_ASSERT(!m_dh_key_exchange.get());
+		TORRENT_ASSERT(!m_pe);
 		TORRENT_ASSERT(!m_sent_handshake);
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -550,8 +550,9 @@ namespace {
 			peer_log(peer_log_alert::info, "ENCRYPTION", "initiating encrypted handshake");
 #endif
 
-		m_dh_key_exchange.reset(new (std::nothrow) dh_key_exchange);
-		if (!m_dh_key_exchange)
+		m_pe.reset(new (std::nothrow) pe_handshake);
+		if (m_pe) m_pe->dh_key.reset(new (std::nothrow) dh_key_exchange);
+		if (!m_pe || !m_pe->dh_key)
 		{
 			disconnect(errors::no_memory, operation_t::encryption);
 			return;
@@ -567,7 +568,7 @@ namespace {
 		char* ptr = msg;
 		int const buf_size = int(dh_key_len) + pad_size;
 
-		std::array<char, dh_key_len> const local_key = export_key(m_dh_key_exchange->get_local_key());
+		std::array<char, dh_key_len> const local_key = export_key(m_pe->dh_key->get_local_key());
 		std::memcpy(ptr, local_key.data(), dh_key_len);
 		ptr += dh_key_len;
 
@@ -590,7 +591,7 @@ namespace {
 
 		hasher h;
 		sha1_hash const& info_hash = associated_info_hash();
-		key_t const secret_key = m_dh_key_exchange->get_secret();
+		key_t const secret_key = m_pe->dh_key->get_secret();
 		std::array<char, dh_key_len> const secret = export_key(secret_key);
 
 		int const pad_size = int(random(512));
@@ -633,11 +634,11 @@ namespace {
 		ptr += 20;
 
 		// Discard DH key exchange data, setup RC4 keys
-		m_rc4 = init_pe_rc4_handler(secret_key, info_hash, is_outgoing());
+		m_pe->rc4 = init_pe_rc4_handler(secret_key, info_hash, is_outgoing());
 #ifndef TORRENT_DISABLE_LOGGING
 		peer_log(peer_log_alert::info, "ENCRYPTION", "computed RC4 keys");
 #endif
-		m_dh_key_exchange.reset(); // secret should be invalid at this point
+		m_pe->dh_key.reset(); // secret should be invalid at this point
 
 		// write the verification constant and crypto field
 		int const encrypt_size = int(sizeof(msg)) - 512 + pad_size - 40;
@@ -656,7 +657,7 @@ namespace {
 
 		write_pe_vc_cryptofield({ptr, encrypt_size}, crypto_provide, pad_size);
 		span<char> vec(ptr, encrypt_size);
-		m_rc4->encrypt(vec);
+		m_pe->rc4->encrypt(vec);
 		send_buffer({msg, int(sizeof(msg)) - 512 + pad_size});
 	}
 
@@ -677,7 +678,7 @@ namespace {
 		write_pe_vc_cryptofield(msg, crypto_select, pad_size);
 
 		span<char> vec(msg, buf_size);
-		m_rc4->encrypt(vec);
+		m_pe->rc4->encrypt(vec);
 		send_buffer(vec);
 
 		// encryption method has been negotiated
@@ -726,7 +727,7 @@ namespace {
 
 	void bt_peer_connection::rc4_decrypt(span<char> buf)
 	{
-		m_rc4->decrypt(buf);
+		m_pe->rc4->decrypt(buf);
 	}
 
 #endif // #if !defined TORRENT_DISABLE_ENCRYPTION
@@ -2759,8 +2760,8 @@ namespace {
 		m_encrypted = true;
 		if (m_rc4_encrypted)
 		{
-			switch_send_crypto(m_rc4);
-			switch_recv_crypto(m_rc4);
+			switch_send_crypto(m_pe->rc4);
+			switch_recv_crypto(m_pe->rc4);
 		}
 
 		// decrypt remaining received bytes
@@ -2775,7 +2776,9 @@ namespace {
 				, "decrypted remaining %d bytes", int(remaining.size()));
 #endif
 		}
-		m_rc4.reset();
+
+		// the encrypted handshake is done, we don't need its state anymore
+		m_pe.reset();
 
 		// encrypted portion of handshake completed, toggle
 		// peer_info pe_support flag back to true
@@ -2813,13 +2816,13 @@ namespace {
 
 			if (!m_recv_buffer.packet_finished()) return;
 
-			// write our dh public key. m_dh_key_exchange is
+			// write our dh public key. m_pe is
 			// initialized in write_pe1_2_dhkey()
 			if (!is_outgoing()) write_pe1_2_dhkey();
 			if (is_disconnecting()) return;
 
 			// read dh key, generate shared secret
-			m_dh_key_exchange->compute_secret(
+			m_pe->dh_key->compute_secret(
 				reinterpret_cast<std::uint8_t const*>(recv_buffer.data()));
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -2841,7 +2844,7 @@ namespace {
 				// initial payload is the standard handshake, this is
 				// always rc4 if sent here. m_rc4_encrypted is flagged
 				// again according to peer selection.
-				switch_send_crypto(m_rc4);
+				switch_send_crypto(m_pe->rc4);
 				write_handshake();
 				switch_send_crypto(std::shared_ptr<crypto_plugin>());
 
@@ -2878,29 +2881,29 @@ namespace {
 				return;
 			}
 
-			if (!m_sync_hash)
+			if (!m_pe->sync_hash)
 			{
-				TORRENT_ASSERT(m_sync_bytes_read == 0);
+				TORRENT_ASSERT(m_pe->sync_bytes_read == 0);
 
 				static char const req1[4] = {'r', 'e', 'q', '1'};
 				// compute synchash (hash('req1',S))
-				std::array<char, dh_key_len> const buffer = export_key(m_dh_key_exchange->get_secret());
+				std::array<char, dh_key_len> const buffer = export_key(m_pe->dh_key->get_secret());
 				hasher h(req1);
 				h.update(buffer);
-				m_sync_hash.reset(new sha1_hash(h.final()));
+				m_pe->sync_hash.reset(new sha1_hash(h.final()));
 
 #ifndef TORRENT_DISABLE_LOGGING
 				if (should_log(peer_log_alert::info))
 				{
 					peer_log(peer_log_alert::info, "ENCRYPTION"
 						, "looking for synchash %s secret: %s"
-						, aux::to_hex(*m_sync_hash).c_str()
+						, aux::to_hex(*m_pe->sync_hash).c_str()
 						, aux::to_hex(buffer).c_str());
 				}
 #endif
 			}
 
-			int const syncoffset = search(*m_sync_hash, recv_buffer);
+			int const syncoffset = search(*m_pe->sync_hash, recv_buffer);
 
 			// No sync
 			if (syncoffset == -1)
@@ -2908,15 +2911,15 @@ namespace {
 				received_bytes(0, int(bytes_transferred));
 
 				int const bytes_processed = int(recv_buffer.size()) - 20;
-				m_sync_bytes_read += bytes_processed;
-				if (m_sync_bytes_read >= 512)
+				m_pe->sync_bytes_read += bytes_processed;
+				if (m_pe->sync_bytes_read >= 512)
 				{
 					disconnect(errors::sync_hash_not_found, operation_t::encryption, failure);
 					return;
 				}
 
 				m_recv_buffer.cut(bytes_processed, std::min(m_recv_buffer.packet_size()
-					, (512 + 20) - m_sync_bytes_read));
+					, (512 + 20) - m_pe->sync_bytes_read));
 
 				TORRENT_ASSERT(!m_recv_buffer.packet_finished());
 				return;
@@ -2928,11 +2931,11 @@ namespace {
 #ifndef TORRENT_DISABLE_LOGGING
 				peer_log(peer_log_alert::info, "ENCRYPTION"
 					, "sync point (hash) found at offset %d"
-					, m_sync_bytes_read + bytes_processed - 20);
+					, m_pe->sync_bytes_read + bytes_processed - 20);
 #endif
 				m_state = state_t::read_pe_skey_vc;
 				// skey,vc - 28 bytes
-				m_sync_hash.reset();
+				m_pe->sync_hash.reset();
 				int const transferred_used = bytes_processed
 					- aux::numeric_cast<int>(recv_buffer.size())
 					+ aux::numeric_cast<int>(bytes_transferred);
@@ -2963,7 +2966,9 @@ namespace {
 			TORRENT_ASSERT(!is_disconnecting());
 
 			sha1_hash ih(recv_buffer.data());
-			torrent const* ti = m_ses.find_encrypted_torrent(ih, m_dh_key_exchange->get_hash_xor_mask());
+			protocol_version matched_version = protocol_version::V1;
+			torrent const* ti = m_ses.find_encrypted_torrent(ih
+				, m_pe->dh_key->get_hash_xor_mask(), matched_version);
 
 			if (ti)
 			{
@@ -2977,22 +2982,12 @@ namespace {
 					TORRENT_ASSERT(t);
 				}
 
-				// compute the obfuscated hash of the torrent's valid info hashes
-				// to find the one which matches the received hash
-
-				sha1_hash oih(ih);
-				oih ^= m_dh_key_exchange->get_hash_xor_mask();
+				// the session's index knows which of the torrent's info-hashes
+				// the obfuscated hash was derived from
+				if (t.get() == ti)
+					peer_info_struct()->protocol_v2 = matched_version == protocol_version::V2;
 
-				t->info_hash().for_each([&](sha1_hash const& tih, protocol_version v)
-				{
-					static char const req2[4] = { 'r', 'e', 'q', '2' };
-					hasher h(req2);
-					h.update(tih);
-					if (h.final() == oih)
-						peer_info_struct()->protocol_v2 = v == protocol_version::V2;
-				});
-
-				m_rc4 = init_pe_rc4_handler(m_dh_key_exchange->get_secret()
+				m_pe->rc4 = init_pe_rc4_handler(m_pe->dh_key->get_secret()
 					, associated_info_hash(), is_outgoing());
 #ifndef TORRENT_DISABLE_LOGGING
 				peer_log(peer_log_alert::info, "ENCRYPTION", "computed RC4 keys");
@@ -3000,7 +2995,7 @@ namespace {
 #endif
 			}
 
-			if (!m_rc4)
+			if (!m_pe->rc4)
 			{
 				disconnect(errors::invalid_info_hash, operation_t::bittorrent, failure);
 				return;
@@ -3041,38 +3036,38 @@ namespace {
 			}
 
 			// generate the verification constant
-			if (!m_sync_vc)
+			if (!m_pe->sync_vc)
 			{
-				TORRENT_ASSERT(m_sync_bytes_read == 0);
+				TORRENT_ASSERT(m_pe->sync_bytes_read == 0);
 
-				m_sync_vc.reset(new (std::nothrow) char[8]);
-				if (!m_sync_vc)
+				m_pe->sync_vc.reset(new (std::nothrow) char[8]);
+				if (!m_pe->sync_vc)
 				{
 					disconnect(errors::no_memory, operation_t::encryption);
 					return;
 				}
-				std::fill(m_sync_vc.get(), m_sync_vc.get() + 8, char{0});
-				rc4_decrypt({m_sync_vc.get(), 8});
+				std::fill(m_pe->sync_vc.get(), m_pe->sync_vc.get() + 8, char{0});
+				rc4_decrypt({m_pe->sync_vc.get(), 8});
 			}
 
-			TORRENT_ASSERT(m_sync_vc);
-			int const syncoffset = search({m_sync_vc.get(), 8}, recv_buffer);
+			TORRENT_ASSERT(m_pe->sync_vc);
+			int const syncoffset = search({m_pe->sync_vc.get(), 8}, recv_buffer);
 
 			// No sync
 			if (syncoffset == -1)
 			{
 				int const bytes_processed = int(recv_buffer.size()) - 8;
-				m_sync_bytes_read += bytes_processed;
+				m_pe->sync_bytes_read += bytes_processed;
 				received_bytes(0, int(bytes_transferred));
 
-				if (m_sync_bytes_read >= 512)
+				if (m_pe->sync_bytes_read >= 512)
 				{
 					disconnect(errors::invalid_encryption_constant, operation_t::encryption, peer_error);
 					return;
 				}
 
 				m_recv_buffer.cut(bytes_processed, std::min(m_recv_buffer.packet_size()
-					, (512 + 8) - m_sync_bytes_read));
+					, (512 + 8) - m_pe->sync_bytes_read));
 
 				TORRENT_ASSERT(!m_recv_buffer.packet_finished());
 			}
@@ -3083,7 +3078,7 @@ namespace {
 #ifndef TORRENT_DISABLE_LOGGING
 				peer_log(peer_log_alert::info, "ENCRYPTION"
 					, "sync point (verification constant) found at offset %d"
-					, m_sync_bytes_read + bytes_processed - 8);
+					, m_pe->sync_bytes_read + bytes_processed - 8);
 #endif
 				int const transferred_used = bytes_processed
 					- aux::numeric_cast<int>(recv_buffer.size())
@@ -3096,7 +3091,7 @@ namespace {
 				m_recv_buffer.cut(bytes_processed, 4 + 2);
 
 				// delete verification constant
-				m_sync_vc.reset();
+				m_pe->sync_vc.reset();
 				m_state = state_t::read_pe_cryptofield;
 				// fall through
 			}
@@ -3280,10 +3275,10 @@ namespace {
 			m_encrypted = true;
 			if (m_rc4_encrypted)
 			{
-				switch_send_crypto(m_rc4);
-				switch_recv_crypto(m_rc4);
+				switch_send_crypto(m_pe->rc4);
+				switch_recv_crypto(m_pe->rc4);
 			}
-			m_rc4.reset();
+			m_pe.reset();
 
 			// now that we have decrypted IA length of bytes, we
 			// reinterpret the receive buffer as the very start of a normal
@@ -3805,10 +3800,10 @@ namespace {
 		std::shared_ptr<torrent> t = associated_torrent().lock();
 
 #if !defined TORRENT_DISABLE_ENCRYPTION
-		TORRENT_ASSERT( (bool(m_state != state_t::read_pe_dhkey) || m_dh_key_exchange.get())
+		TORRENT_ASSERT( (bool(m_state != state_t::read_pe_dhkey) || (m_pe && m_pe->dh_key))
 				|| !is_outgoing());
 
-		TORRENT_ASSERT(!m_rc4_encrypted || (!m_encrypted && m_rc4)
+		TORRENT_ASSERT(!m_rc4_encrypted || (!m_encrypted && m_pe && m_pe->rc4)
 			|| (m_encrypted && !m_enc_handler.is_send_plaintext()));
 #endif
 		if (!in_handshake())
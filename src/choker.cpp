@@ -41,66 +41,68 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/torrent.hpp"
 
 #include <functional>
-
-using namespace std::placeholders;
+#include <algorithm>
+#include <limits>
 
 namespace libtorrent {
 
 namespace {
 
-	int compare_peers(peer_connection const* lhs, peer_connection const* rhs)
+	// the unchoke ordering of a peer, computed once per peer per unchoke
+	// round. The comparisons used to compute these (and lock the peers'
+	// torrents) on every call, which made them the dominating cost of sorting
+	// tens of thousands of peers.
+	struct unchoke_candidate
 	{
-		int const prio1 = lhs->get_priority(peer_connection::upload_channel);
-		int const prio2 = rhs->get_priority(peer_connection::upload_channel);
+		// index into the peers being sorted
+		int idx;
 
-		if (prio1 != prio2) return prio1 > prio2 ? 1 : -1;
+		std::uint64_t ext_rank;
+		int priority;
 
-		// compare how many bytes they've sent us
-		std::int64_t const c1 = lhs->downloaded_in_last_round();
-		std::int64_t const c2 = rhs->downloaded_in_last_round();
+		// the number of bytes the peer sent us in the last round
+		std::int64_t downloaded;
 
-		if (c1 != c2) return c1 > c2 ? 1 : -1;
-		return 0;
-	}
+		// the seed choking algorithm's preference. Lower tiers are unchoked
+		// first and, within a tier, higher scores
+		int tier;
+		std::int64_t score;
+
+		// on ties, prefer the peer that has waited the longest to be unchoked.
+		// The round-robin unchoker relies on this
+		time_point last_unchoke;
+	};
 
 	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
-	bool unchoke_compare_rr(peer_connection const* lhs
-		, peer_connection const* rhs, int pieces)
+	bool unchoke_compare(unchoke_candidate const& lhs, unchoke_candidate const& rhs)
 	{
-		int const cmp = compare_peers(lhs, rhs);
-		if (cmp != 0) return cmp > 0;
-
-		// when seeding, rotate which peer is unchoked in a round-robin fashion
-
-		// the amount uploaded since unchoked (not just in the last round)
-		std::int64_t const u1 = lhs->uploaded_since_unchoked();
-		std::int64_t const u2 = rhs->uploaded_since_unchoked();
+		if (lhs.ext_rank != rhs.ext_rank) return lhs.ext_rank < rhs.ext_rank;
+		if (lhs.priority != rhs.priority) return lhs.priority > rhs.priority;
+		// compare how many bytes they've sent us
+		if (lhs.downloaded != rhs.downloaded) return lhs.downloaded > rhs.downloaded;
+		if (lhs.tier != rhs.tier) return lhs.tier < rhs.tier;
+		if (lhs.score != rhs.score) return lhs.score > rhs.score;
+		return lhs.last_unchoke < rhs.last_unchoke;
+	}
 
+	// when seeding, rotate which peer is unchoked in a round-robin fashion
+	void rr_key(unchoke_candidate& c, aux::unchoke_peer const& p, int const pieces
+		, time_point const now)
+	{
 		// the way the round-robin unchoker works is that it,
 		// by default, prioritizes any peer that is already unchoked.
 		// this maintain the status quo across unchoke rounds. However,
 		// peers that are unchoked, but have sent more than one quota
 		// since they were unchoked, they get de-prioritized.
 
-		std::shared_ptr<torrent> const t1 = lhs->associated_torrent().lock();
-		std::shared_ptr<torrent> const t2 = rhs->associated_torrent().lock();
-		TORRENT_ASSERT(t1);
-		TORRENT_ASSERT(t2);
-
 		// if a peer is already unchoked, the number of bytes sent since it was unchoked
-		// is greater than the send quanta, and it has been unchoked for at least one minute
-		// then it's done with its upload slot, and we can de-prioritize it
-		bool const c1_quota_complete = !lhs->is_choked()
-			&& u1 > std::int64_t(t1->torrent_file().piece_length()) * pieces
-			&& aux::time_now() - lhs->time_of_last_unchoke() > minutes(1);
-		bool const c2_quota_complete = !rhs->is_choked()
-			&& u2 > std::int64_t(t2->torrent_file().piece_length()) * pieces
-			&& aux::time_now() - rhs->time_of_last_unchoke() > minutes(1);
-
-		// if c2 has completed a quanta, it should be de-prioritized
-		// and vice versa
-		if (c1_quota_complete != c2_quota_complete)
-			return int(c1_quota_complete) < int(c2_quota_complete);
+		// (not just in the last round) is greater than the send quanta, and it
+		// has been unchoked for at least one minute then it's done with its
+		// upload slot, and we can de-prioritize it
+		bool const quota_complete = !p.choked
+			&& p.uploaded_since_unchoked > std::int64_t(p.piece_length) * pieces
+			&& now - p.last_unchoke > minutes(1);
+		c.tier = quota_complete ? 1 : 0;
 
 		// when seeding, prefer the peer we're uploading the fastest to
 
@@ -109,38 +111,10 @@ namespace {
 		// there may have been a residual transfer which was already
 		// in-flight at the time and we don't want that to cause the peer
 		// to be ranked at the top of the choked peers
-		std::int64_t const c1 = lhs->is_choked() ? 0 : lhs->uploaded_in_last_round();
-		std::int64_t const c2 = rhs->is_choked() ? 0 : rhs->uploaded_in_last_round();
-
-		if (c1 != c2) return c1 > c2;
-
-		// if the peers are still identical (say, they're both waiting to be unchoked)
-		// prioritize the one that has waited the longest to be unchoked
-		// the round-robin unchoker relies on this logic. Don't change it
-		// without moving this into that unchoker logic
-		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
-	}
-
-	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
-	bool unchoke_compare_fastest_upload(peer_connection const* lhs
-		, peer_connection const* rhs)
-	{
-		int const cmp = compare_peers(lhs, rhs);
-		if (cmp != 0) return cmp > 0;
-
-		// when seeding, prefer the peer we're uploading the fastest to
-		std::int64_t const c1 = lhs->uploaded_in_last_round();
-		std::int64_t const c2 = rhs->uploaded_in_last_round();
-
-		if (c1 != c2) return c1 > c2;
-
-		// prioritize the one that has waited the longest to be unchoked
-		// the round-robin unchoker relies on this logic. Don't change it
-		// without moving this into that unchoker logic
-		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
+		c.score = p.choked ? 0 : p.uploaded_in_last_round;
 	}
 
-	int anti_leech_score(peer_connection const* peer)
+	int anti_leech_score(aux::unchoke_peer const& p)
 	{
 		// the anti-leech seeding algorithm is based on the paper "Improving
 		// BitTorrent: A Simple Approach" from Chow et. al. and ranks peers based
@@ -162,62 +136,25 @@ namespace {
 		//   |             V             |
 		//   +---------------------------+
 		//   0%    num have pieces     100%
-		std::shared_ptr<torrent> const t = peer->associated_torrent().lock();
-		TORRENT_ASSERT(t);
-
-		std::int64_t const total_size = t->torrent_file().total_size();
+		std::int64_t const total_size = p.torrent_size;
 		if (total_size == 0) return 0;
 		// Cap the given_size so that it never causes the score to increase
-		std::int64_t const given_size = std::min(peer->statistics().total_payload_upload()
+		std::int64_t const given_size = std::min(p.total_payload_upload
 			, total_size / 2);
 		std::int64_t const have_size = std::max(given_size
-			, std::int64_t(t->torrent_file().piece_length()) * peer->num_have_pieces());
+			, std::int64_t(p.piece_length) * p.num_have_pieces);
 		return int(std::abs((have_size - total_size / 2) * 2000 / total_size));
 	}
 
-	// return true if 'lhs' peer should be preferred to be unchoke over 'rhs'
-	bool unchoke_compare_anti_leech(peer_connection const* lhs
-		, peer_connection const* rhs)
-	{
-		int const cmp = compare_peers(lhs, rhs);
-		if (cmp != 0) return cmp > 0;
-
-		int const score1 = anti_leech_score(lhs);
-		int const score2 = anti_leech_score(rhs);
-		if (score1 != score2) return score1 > score2;
-
-		// prioritize the one that has waited the longest to be unchoked
-		// the round-robin unchoker relies on this logic. Don't change it
-		// without moving this into that unchoker logic
-		return lhs->time_of_last_unchoke() < rhs->time_of_last_unchoke();
-	}
-
-	bool upload_rate_compare(peer_connection const* lhs
-		, peer_connection const* rhs)
-	{
-		// take torrent priority into account
-		std::int64_t const c1 = lhs->uploaded_in_last_round()
-			* lhs->get_priority(peer_connection::upload_channel);
-		std::int64_t const c2 = rhs->uploaded_in_last_round()
-			* rhs->get_priority(peer_connection::upload_channel);
-
-		return c1 > c2;
-	}
-
 	} // anonymous namespace
 
-	int unchoke_sort(std::vector<peer_connection*>& peers
+namespace aux {
+
+	int unchoke_sort(std::vector<unchoke_peer>& peers
 		, time_duration const unchoke_interval
-		, aux::session_settings const& sett)
+		, aux::session_settings const& sett
+		, time_point const now)
 	{
-#if TORRENT_USE_ASSERTS
-		for (auto p : peers)
-		{
-			TORRENT_ASSERT(p->self());
-			TORRENT_ASSERT(p->associated_torrent().lock());
-		}
-#endif
-
 		int upload_slots = sett.get_int(settings_pack::unchoke_slots_limit);
 		if (upload_slots < 0)
 			upload_slots = std::numeric_limits<int>::max();
@@ -241,14 +178,25 @@ namespace {
 
 			int rate_threshold = sett.get_int(settings_pack::rate_choker_initial_threshold);
 
-			std::sort(peers.begin(), peers.end()
-				, [](peer_connection const* lhs, peer_connection const* rhs)
-				{ return upload_rate_compare(lhs, rhs); });
+			// the first element is the upload rate weighted by the torrent
+			// priority, which is the order we visit peers in. Only the peers
+			// visited before the threshold stops us need to be pulled off the
+			// heap, so there's no need to sort all of them
+			std::vector<std::pair<std::int64_t, std::int64_t>> rates;
+			rates.reserve(peers.size());
+			for (auto const& p : peers)
+			{
+				rates.emplace_back(p.uploaded_in_last_round * p.priority
+					, p.uploaded_in_last_round);
+			}
+			std::make_heap(rates.begin(), rates.end());
 
-			for (auto const* p : peers)
+			while (!rates.empty())
 			{
-				int const rate = int(p->uploaded_in_last_round()
+				std::pop_heap(rates.begin(), rates.end());
+				int const rate = int(rates.back().second
 					* 1000 / total_milliseconds(unchoke_interval));
+				rates.pop_back();
 
 				// always have at least 1 unchoke slot
 				if (rate < rate_threshold) break;
@@ -271,42 +219,90 @@ namespace {
 
 		int const slots = std::min(upload_slots, int(peers.size()));
 
-		if (sett.get_int(settings_pack::seed_choking_algorithm)
-			== settings_pack::round_robin)
-		{
-			int const pieces = sett.get_int(settings_pack::seeding_piece_quota);
+		int const algorithm = sett.get_int(settings_pack::seed_choking_algorithm);
+		TORRENT_ASSERT(algorithm == settings_pack::round_robin
+			|| algorithm == settings_pack::fastest_upload
+			|| algorithm == settings_pack::anti_leech);
+		int const pieces = sett.get_int(settings_pack::seeding_piece_quota);
 
-			std::nth_element(peers.begin(), peers.begin()
-				+ slots, peers.end()
-				, [pieces](peer_connection const* lhs, peer_connection const* rhs)
-				{ return unchoke_compare_rr(lhs, rhs, pieces); });
-		}
-		else if (sett.get_int(settings_pack::seed_choking_algorithm)
-			== settings_pack::fastest_upload)
+		std::vector<unchoke_candidate> candidates;
+		candidates.reserve(peers.size());
+		for (int i = 0; i < int(peers.size()); ++i)
 		{
-			std::nth_element(peers.begin(), peers.begin()
-				+ slots, peers.end()
-				, [](peer_connection const* lhs, peer_connection const* rhs)
-				{ return unchoke_compare_fastest_upload(lhs, rhs); });
+			unchoke_peer const& p = peers[std::size_t(i)];
+
+			unchoke_candidate c;
+			c.idx = i;
+			c.ext_rank = p.ext_rank;
+			c.priority = p.priority;
+			c.downloaded = p.downloaded_in_last_round;
+			c.last_unchoke = p.last_unchoke;
+
+			if (algorithm == settings_pack::fastest_upload)
+			{
+				// when seeding, prefer the peer we're uploading the fastest to
+				c.tier = 0;
+				c.score = p.uploaded_in_last_round;
+			}
+			else if (algorithm == settings_pack::anti_leech)
+			{
+				c.tier = 0;
+				c.score = anti_leech_score(p);
+			}
+			else
+			{
+				rr_key(c, p, pieces, now);
+			}
+			candidates.push_back(c);
 		}
-		else if (sett.get_int(settings_pack::seed_choking_algorithm)
-			== settings_pack::anti_leech)
+
+		std::partial_sort(candidates.begin(), candidates.begin() + slots
+			, candidates.end(), &unchoke_compare);
+
+		std::vector<unchoke_peer> sorted;
+		sorted.reserve(peers.size());
+		for (auto const& c : candidates)
+			sorted.push_back(peers[std::size_t(c.idx)]);
+		peers.swap(sorted);
+
+		return upload_slots;
+	}
+}
+
+	int unchoke_sort(std::vector<peer_connection*>& peers
+		, time_duration const unchoke_interval
+		, aux::session_settings const& sett
+		, std::function<std::uint64_t(peer_connection&)> const& ext_rank)
+	{
+		std::vector<aux::unchoke_peer> state;
+		state.reserve(peers.size());
+		for (peer_connection* p : peers)
 		{
-			std::nth_element(peers.begin(), peers.begin()
-				+ slots, peers.end()
-				, [](peer_connection const* lhs, peer_connection const* rhs)
-				{ return unchoke_compare_anti_leech(lhs, rhs); });
+			TORRENT_ASSERT(p->self());
+			std::shared_ptr<torrent> const t = p->associated_torrent().lock();
+			TORRENT_ASSERT(t);
+
+			aux::unchoke_peer s;
+			s.peer = p;
+			if (ext_rank) s.ext_rank = ext_rank(*p);
+			s.priority = p->get_priority(peer_connection::upload_channel);
+			s.downloaded_in_last_round = p->downloaded_in_last_round();
+			s.uploaded_in_last_round = p->uploaded_in_last_round();
+			s.uploaded_since_unchoked = p->uploaded_since_unchoked();
+			s.total_payload_upload = p->statistics().total_payload_upload();
+			s.num_have_pieces = p->num_have_pieces();
+			s.choked = p->is_choked();
+			s.last_unchoke = p->time_of_last_unchoke();
+			s.torrent_size = t->torrent_file().total_size();
+			s.piece_length = t->torrent_file().piece_length();
+			state.push_back(s);
 		}
-		else
-		{
-			int const pieces = sett.get_int(settings_pack::seeding_piece_quota);
-			std::nth_element(peers.begin(), peers.begin()
-				+ slots, peers.end()
-				, [pieces](peer_connection const* lhs, peer_connection const* rhs)
-				{ return unchoke_compare_rr(lhs, rhs, pieces); } );
 
-			TORRENT_ASSERT_FAIL();
-		}
+		int const upload_slots = aux::unchoke_sort(state, unchoke_interval
+			, sett, aux::time_now());
+
+		for (std::size_t i = 0; i < state.size(); ++i)
+			peers[i] = state[i].peer;
 
 		return upload_slots;
 	}
@@ -49,6 +49,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/disable_warnings_pop.hpp"
 
 #include <cstdio>
+#include <cstring> // for strlen
 #include <cinttypes>
 #include <algorithm>
 #include <functional>
@@ -795,6 +796,26 @@ namespace aux {
 		}
 	}
 
+	std::int64_t file_storage::memory_usage() const
+	{
+		std::int64_t ret = std::int64_t(m_files.capacity() * sizeof(aux::file_entry));
+		// borrowed names point into the info section and are accounted for
+		// by the torrent_info
+		for (auto const& fe : m_files)
+		{
+			if (fe.name_len == aux::file_entry::name_is_owned && fe.name != nullptr)
+				ret += std::int64_t(std::strlen(fe.name) + 1);
+		}
+		ret += std::int64_t(m_file_hashes.capacity() * sizeof(char const*));
+		ret += std::int64_t(m_mtime.capacity() * sizeof(std::time_t));
+		ret += std::int64_t(m_symlinks.capacity() * sizeof(std::string));
+		for (auto const& s : m_symlinks) ret += std::int64_t(s.capacity());
+		ret += std::int64_t(m_paths.capacity() * sizeof(std::string));
+		for (auto const& p : m_paths) ret += std::int64_t(p.capacity());
+		ret += std::int64_t(m_name.capacity());
+		return ret;
+	}
+
 	// this is here for backwards compatibility with hybrid torrents created
 	// with libtorrent 2.0.0-2.0.7, which would not add tail-padding
 	void file_storage::remove_tail_padding()
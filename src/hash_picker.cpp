@@ -399,6 +399,16 @@ bool validate_hash_request(hash_request const& hr, file_storage const& fs)
 		return m_merkle_trees[f].blocks_verified(block_offset, blocks_in_piece);
 	}
 
+	std::int64_t hash_picker::memory_usage() const
+	{
+		std::int64_t ret = sizeof(*this);
+		ret += std::int64_t(m_piece_hash_requested.capacity() * sizeof(m_piece_hash_requested[0]));
+		for (auto const& f : m_piece_hash_requested)
+			ret += std::int64_t(f.capacity() * sizeof(piece_hash_request));
+		ret += std::int64_t(m_piece_block_requests.capacity() * sizeof(piece_block_request));
+		return ret;
+	}
+
 	int hash_picker::layers_to_verify(node_index idx) const
 	{
 		// the root layer doesn't have a sibling so it should never
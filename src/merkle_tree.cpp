@@ -550,6 +550,12 @@ namespace {
 		return std::make_tuple(set_block_result::ok, leafs_start, leafs_size);
 	}
 
+	std::int64_t merkle_tree::memory_usage() const
+	{
+		return std::int64_t(m_tree.capacity() * sizeof(sha256_hash))
+			+ std::int64_t(m_block_verified.num_words()) * 4;
+	}
+
 	std::size_t merkle_tree::size() const
 	{
 		return static_cast<std::size_t>(merkle_num_nodes(merkle_num_leafs(m_num_blocks)));
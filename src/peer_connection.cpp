@@ -138,6 +138,9 @@ namespace libtorrent {
 		, m_peer_info(pack.peerinfo)
 		, m_counters(*pack.stats_counters)
 		, m_num_pieces(0)
+		, m_num_wanted_pieces(0)
+		, m_wanted_seq(std::numeric_limits<std::uint64_t>::max())
+		, m_recv_buffer(&m_ses.recv_buffer_pool())
 		, m_max_out_request_queue(aux::clamp_assign<std::uint16_t>(m_settings.get_int(settings_pack::max_out_request_queue)))
 		, m_remote(pack.endp)
 		, m_disk_thread(*pack.disk_thread)
@@ -165,6 +168,7 @@ namespace libtorrent {
 		, m_has_metadata(true)
 		, m_exceeded_limit(false)
 		, m_slow_start(true)
+		, m_socket_readable(false)
 	{
 		m_counters.inc_stats_counter(counters::num_tcp_peers
 			+ static_cast<std::uint8_t>(socket_type_idx(m_socket)));
@@ -536,22 +540,17 @@ namespace libtorrent {
 		if (!t->is_upload_only())
 		{
 			t->need_picker();
-			piece_picker const& p = t->picker();
-			piece_index_t const end_piece(p.num_pieces());
-			for (piece_index_t j(0); j != end_piece; ++j)
-			{
-				if (m_have_piece[j]
-					&& t->piece_priority(j) > dont_download
-					&& !p.has_piece_passed(j))
-				{
-					interested = true;
+			// the peer is interesting if it has any piece we haven't filtered
+			// and that hasn't passed the hash check yet
+			int const num_wanted = num_wanted_pieces(t->picker());
+			interested = num_wanted > 0;
 #ifndef TORRENT_DISABLE_LOGGING
-					peer_log(peer_log_alert::info, "UPDATE_INTEREST", "interesting, piece: %d"
-						, static_cast<int>(j));
-#endif
-					break;
-				}
+			if (interested)
+			{
+				peer_log(peer_log_alert::info, "UPDATE_INTEREST", "interesting, pieces: %d"
+					, num_wanted);
 			}
+#endif
 		}
 
 #ifndef TORRENT_DISABLE_LOGGING
@@ -567,6 +566,39 @@ namespace libtorrent {
 		disconnect_if_redundant();
 	}
 
+	int peer_connection::num_wanted_pieces(piece_picker const& p)
+	{
+		TORRENT_ASSERT(m_have_piece.size() == p.wanted_pieces().size());
+		bool const caught_up = p.wanted_changes_since(m_wanted_seq
+			, [this](piece_index_t const piece, bool const wanted)
+			{
+				if (m_have_piece[piece]) m_num_wanted_pieces += wanted ? 1 : -1;
+			});
+		if (!caught_up)
+			m_num_wanted_pieces = m_have_piece.count_and(p.wanted_pieces());
+		m_wanted_seq = p.wanted_sequence();
+
+		TORRENT_ASSERT(m_num_wanted_pieces >= 0);
+#ifdef TORRENT_EXPENSIVE_INVARIANT_CHECKS
+		TORRENT_ASSERT(m_num_wanted_pieces == m_have_piece.count_and(p.wanted_pieces()));
+#endif
+		return m_num_wanted_pieces;
+	}
+
+	void peer_connection::update_wanted_count(piece_index_t const index, bool const has)
+	{
+		std::shared_ptr<torrent> t = m_torrent.lock();
+		if (!t || !t->has_picker() || m_have_piece.size() != t->picker().num_pieces())
+		{
+			reset_wanted_count();
+			return;
+		}
+		piece_picker const& p = t->picker();
+		// the count has to be up to date with m_have_piece as it is now
+		num_wanted_pieces(p);
+		if (p.wanted_pieces()[index]) m_num_wanted_pieces += has ? 1 : -1;
+	}
+
 #ifndef TORRENT_DISABLE_LOGGING
 	bool peer_connection::should_log(peer_log_alert::direction_t) const
 	{
@@ -743,6 +775,7 @@ namespace libtorrent {
 		std::shared_ptr<torrent> t = associated_torrent().lock();
 		m_have_piece.resize(t->torrent_file().num_pieces(), m_have_all);
 		m_num_pieces = m_have_piece.count();
+		reset_wanted_count();
 
 		piece_index_t const limit(m_num_pieces);
 
@@ -775,6 +808,7 @@ namespace libtorrent {
 		TORRENT_ASSERT(t->ready_for_connections());
 
 		m_have_piece.resize(t->torrent_file().num_pieces(), m_have_all);
+		reset_wanted_count();
 
 		if (m_have_all)
 		{
@@ -825,16 +859,8 @@ namespace libtorrent {
 		{
 			TORRENT_ASSERT(m_have_piece.size() == t->torrent_file().num_pieces());
 			t->peer_has(m_have_piece, this);
-			bool interesting = false;
-			for (auto const i : m_have_piece.range())
-			{
-				if (!m_have_piece[i]) continue;
-				// if the peer has a piece and we don't, the peer is interesting
-				if (!t->have_piece(i)
-					&& t->picker().piece_priority(i) != dont_download)
-					interesting = true;
-			}
-			if (interesting) t->peer_is_interesting(*this);
+			// if the peer has a piece we want, the peer is interesting
+			if (num_wanted_pieces(t->picker()) > 0) t->peer_is_interesting(*this);
 			else send_not_interested();
 		}
 		else
@@ -2041,6 +2067,7 @@ namespace libtorrent {
 			return;
 		}
 
+		update_wanted_count(index, true);
 		m_have_piece.set_bit(index);
 		++m_num_pieces;
 
@@ -2167,6 +2194,7 @@ namespace libtorrent {
 		}
 
 		bool const was_seed = is_seed();
+		update_wanted_count(index, false);
 		m_have_piece.clear_bit(index);
 		TORRENT_ASSERT(m_num_pieces > 0);
 		--m_num_pieces;
@@ -2246,6 +2274,7 @@ namespace libtorrent {
 		}
 
 		m_bitfield_received = true;
+		reset_wanted_count();
 
 		// if we don't have metadata yet
 		// just remember the bitmask
@@ -3366,6 +3395,7 @@ namespace libtorrent {
 			t->peer_lost(m_have_piece, this);
 
 		m_have_all = true;
+		reset_wanted_count();
 
 #ifndef TORRENT_DISABLE_LOGGING
 		peer_log(peer_log_alert::info, "SEED", "this is a seed p: %p"
@@ -3444,6 +3474,7 @@ namespace libtorrent {
 
 		m_have_piece.clear_all();
 		m_num_pieces = 0;
+		reset_wanted_count();
 
 		TORRENT_ASSERT(!is_seed());
 
@@ -5960,6 +5991,42 @@ namespace libtorrent {
 
 		if (m_disconnecting) return;
 
+		// if we don't expect anything from this peer, don't hold on to a
+		// receive buffer while waiting for it. Release it and wait for the
+		// socket to become readable instead. This keeps idle connections
+		// small
+		if (!m_socket_readable
+			&& !(m_channel_state[download_channel] & peer_info::bw_network)
+			&& !m_connecting
+			&& m_recv_buffer.empty()
+			&& m_download_queue.empty()
+			&& m_request_queue.empty()
+			&& m_requests.empty()
+			&& !m_peer_interested
+			&& m_extension_outstanding_bytes == 0
+			&& aux::can_wait_read(m_socket))
+		{
+			m_recv_buffer.release();
+			m_channel_state[download_channel] |= peer_info::bw_network;
+#ifndef TORRENT_DISABLE_LOGGING
+			peer_log(peer_log_alert::incoming, "ASYNC_WAIT_READ", "idle");
+#endif
+
+			ADD_OUTSTANDING_ASYNC("peer_connection::on_receive_ready");
+
+			using wait_handler_type = aux::handler<
+				peer_connection
+				, decltype(&peer_connection::on_receive_ready)
+				, &peer_connection::on_receive_ready
+				, &peer_connection::on_error
+				, &peer_connection::on_exception
+				, decltype(m_read_handler_storage)
+				, &peer_connection::m_read_handler_storage
+				>;
+			aux::async_wait_read(m_socket, wait_handler_type(self()));
+			return;
+		}
+
 		if (m_recv_buffer.capacity() < 100
 			&& m_recv_buffer.max_receive() == 0)
 		{
@@ -6006,6 +6073,8 @@ namespace libtorrent {
 
 		if (max_receive == 0) return;
 
+		m_socket_readable = false;
+
 		span<char> const vec = m_recv_buffer.reserve(max_receive);
 		TORRENT_ASSERT(!(m_channel_state[download_channel] & peer_info::bw_network));
 		m_channel_state[download_channel] |= peer_info::bw_network;
@@ -6090,6 +6159,37 @@ namespace libtorrent {
 #endif
 	}
 
+	void peer_connection::on_receive_ready(error_code const& error)
+	{
+		TORRENT_ASSERT(is_single_thread());
+		COMPLETE_ASYNC("peer_connection::on_receive_ready");
+
+		TORRENT_ASSERT(m_channel_state[download_channel] & peer_info::bw_network);
+		m_channel_state[download_channel] &= ~peer_info::bw_network;
+
+		INVARIANT_CHECK;
+
+		if (error)
+		{
+#ifndef TORRENT_DISABLE_LOGGING
+			if (should_log(peer_log_alert::info))
+			{
+				peer_log(peer_log_alert::info, "ERROR"
+					, "in peer_connection::on_receive_ready %s"
+					, print_error(error).c_str());
+			}
+#endif
+			on_receive(error, 0);
+			disconnect(error, operation_t::sock_read);
+			return;
+		}
+
+		// the next read will allocate a receive buffer for the bytes that
+		// are waiting in the socket
+		m_socket_readable = true;
+		setup_receive();
+	}
+
 	void peer_connection::on_receive_data(error_code const& error
 		, std::size_t bytes_transferred)
 	{
@@ -6248,6 +6348,11 @@ namespace libtorrent {
 #endif
 		}
 
+		// if we're at a message boundary, hand a pooled receive buffer back.
+		// The next read will borrow one again
+		if (m_recv_buffer.pooled() && m_recv_buffer.empty())
+			m_recv_buffer.release();
+
 		TORRENT_ASSERT(m_recv_buffer.pos_at_end());
 		TORRENT_ASSERT(m_recv_buffer.packet_size() > 0);
 
@@ -442,6 +442,40 @@ namespace libtorrent {
 		}
 	}
 
+	int peer_list::shed_peers(int const target, torrent_state* state)
+	{
+		TORRENT_ASSERT(is_single_thread());
+		INVARIANT_CHECK;
+
+		int erased = 0;
+
+		// first erase the peers we would erase anyway (failed and old ones),
+		// then any peer we're not connected to
+		for (bool const force : {false, true})
+		{
+			for (int i = int(m_peers.size()) - 1;
+				i >= 0 && int(m_peers.size()) > target; --i)
+			{
+				torrent_peer const& pe = *m_peers[i];
+				if (force ? !is_force_erase_candidate(pe) : !is_erase_candidate(pe))
+					continue;
+				erase_peer(m_peers.begin() + i, state);
+				++erased;
+			}
+		}
+		return erased;
+	}
+
+	std::int64_t peer_list::memory_usage() const
+	{
+		// the peer entries are allocated by the torrent_peer_allocator. Most
+		// of them are IPv4 peers, use that as the estimate to avoid touching
+		// every entry
+		return std::int64_t(sizeof(*this))
+			+ std::int64_t(m_peers.size()) * std::int64_t(sizeof(torrent_peer*) + sizeof(ipv4_peer))
+			+ std::int64_t(m_candidate_cache.capacity() * sizeof(torrent_peer*));
+	}
+
 	// returns true if the peer was actually banned
 	bool peer_list::ban_peer(torrent_peer* p)
 	{
@@ -199,6 +199,8 @@ namespace libtorrent {
 		m_have_filtered_pad_bytes = 0;
 		m_num_passed = 0;
 		m_dirty = true;
+		m_wanted.resize(num_pieces);
+		reset_wanted_log();
 		for (auto& m : m_piece_map)
 		{
 			m.peer_count = 0;
@@ -208,6 +210,11 @@ namespace libtorrent {
 			m.have_peers.clear();
 #endif
 		}
+		for (auto const i : m_piece_map.range())
+		{
+			if (m_piece_map[i].filtered()) m_wanted.clear_bit(i);
+			else m_wanted.set_bit(i);
+		}
 
 		for (auto i = m_piece_map.begin() + static_cast<int>(m_cursor)
 			, end(m_piece_map.end()); i != end && (i->have() || i->filtered());
@@ -741,6 +748,12 @@ namespace libtorrent {
 		}
 		TORRENT_ASSERT(num_have == m_num_have);
 		TORRENT_ASSERT(num_filtered == m_num_filtered);
+		TORRENT_ASSERT(m_wanted.size() == num_pieces());
+		for (auto const piece : m_piece_map.range())
+		{
+			TORRENT_ASSERT(m_wanted.get_bit(piece)
+				== (!m_piece_map[piece].filtered() && !has_piece_passed(piece)));
+		}
 		TORRENT_ASSERT(num_have_filtered == m_num_have_filtered);
 		TORRENT_ASSERT(num_have_pad_bytes == m_have_pad_bytes);
 		TORRENT_ASSERT(num_filtered_pad_bytes == m_filtered_pad_bytes);
@@ -757,6 +770,23 @@ namespace libtorrent {
 	}
 #endif
 
+	std::int64_t piece_picker::memory_usage() const
+	{
+		std::int64_t ret = sizeof(*this);
+		ret += std::int64_t(m_piece_map.capacity() * sizeof(piece_pos));
+		ret += std::int64_t(m_pieces.capacity() * sizeof(piece_index_t));
+		ret += std::int64_t(m_priority_boundaries.capacity() * sizeof(prio_index_t));
+		ret += std::int64_t(m_block_info.capacity() * sizeof(block_info));
+		ret += std::int64_t(m_free_block_infos.capacity() * sizeof(std::uint16_t));
+		ret += std::int64_t(m_recent_extents.capacity() * sizeof(piece_extent_t));
+		for (auto const& q : m_downloads)
+			ret += std::int64_t(q.capacity() * sizeof(downloading_piece));
+		// each node in the hash table, plus the bucket array
+		ret += std::int64_t(m_pads_in_piece.size() * (sizeof(std::pair<piece_index_t, int>) + sizeof(void*))
+			+ m_pads_in_piece.bucket_count() * sizeof(void*));
+		return ret;
+	}
+
 	std::pair<int, int> piece_picker::distributed_copies() const
 	{
 		TORRENT_ASSERT(m_seeds >= 0);
@@ -1340,14 +1370,12 @@ namespace libtorrent {
 			// and mark the picker as dirty, so we'll rebuild it next time we need it.
 			// this only matters if we're not already dirty, in which case the fasted
 			// thing to do is to just update the counters and be done
-			piece_index_t index = piece_index_t(0);
 			int num_inc = 0;
-			for (auto i = bitmask.begin(), end(bitmask.end()); i != end; ++i, ++index)
+			for (piece_index_t index = bitmask.find_next_set(piece_index_t(0));
+				index >= piece_index_t(0) && num_inc < size;
+				index = bitmask.find_next_set(next(index)))
 			{
-				if (!*i) continue;
-				if (num_inc < size) incremented[num_inc] = index;
-				++num_inc;
-				if (num_inc >= size) break;
+				incremented[num_inc++] = index;
 			}
 
 			if (num_inc < size)
@@ -1376,23 +1404,19 @@ namespace libtorrent {
 			}
 		}
 
-		piece_index_t index = piece_index_t(0);
 		bool updated = false;
-		for (auto i = bitmask.begin(), end(bitmask.end()); i != end; ++i, ++index)
+		bitmask.for_each_set([&](piece_index_t const index)
 		{
-			if (*i)
-			{
 #ifdef TORRENT_DEBUG_REFCOUNTS
-				TORRENT_ASSERT(m_piece_map[index].have_peers.count(peer) == 0);
-				m_piece_map[index].have_peers.insert(peer);
+			TORRENT_ASSERT(m_piece_map[index].have_peers.count(peer) == 0);
+			m_piece_map[index].have_peers.insert(peer);
 #else
-				TORRENT_UNUSED(peer);
+			TORRENT_UNUSED(peer);
 #endif
 
-				++m_piece_map[index].peer_count;
-				updated = true;
-			}
-		}
+			++m_piece_map[index].peer_count;
+			updated = true;
+		});
 
 		// if we're already dirty, no point in doing anything more
 		if (m_dirty) return;
@@ -1436,14 +1460,12 @@ namespace libtorrent {
 			// and mark the picker as dirty, so we'll rebuild it next time we need it.
 			// this only matters if we're not already dirty, in which case the fasted
 			// thing to do is to just update the counters and be done
-			piece_index_t index = piece_index_t(0);
 			int num_dec = 0;
-			for (auto i = bitmask.begin(), end(bitmask.end()); i != end; ++i, ++index)
+			for (piece_index_t index = bitmask.find_next_set(piece_index_t(0));
+				index >= piece_index_t(0) && num_dec < size;
+				index = bitmask.find_next_set(next(index)))
 			{
-				if (!*i) continue;
-				if (num_dec < size) decremented[num_dec] = index;
-				++num_dec;
-				if (num_dec >= size) break;
+				decremented[num_dec++] = index;
 			}
 
 			if (num_dec < size)
@@ -1481,35 +1503,31 @@ namespace libtorrent {
 			}
 		}
 
-		piece_index_t index = piece_index_t(0);
 		bool updated = false;
-		for (auto i = bitmask.begin(), end(bitmask.end()); i != end; ++i, ++index)
+		bitmask.for_each_set([&](piece_index_t const index)
 		{
-			if (*i)
+			piece_pos& p = m_piece_map[index];
+			if (p.peer_count == 0)
 			{
-				piece_pos& p = m_piece_map[index];
-				if (p.peer_count == 0)
-				{
-					TORRENT_ASSERT(m_seeds > 0);
-					// this is the case where we have one or more
-					// seeds, and one of them saying: I don't have this
-					// piece anymore. we need to break up one of the seed
-					// counters into actual peer counters on the pieces
-					break_one_seed();
-				}
+				TORRENT_ASSERT(m_seeds > 0);
+				// this is the case where we have one or more
+				// seeds, and one of them saying: I don't have this
+				// piece anymore. we need to break up one of the seed
+				// counters into actual peer counters on the pieces
+				break_one_seed();
+			}
 
 #ifdef TORRENT_DEBUG_REFCOUNTS
-				TORRENT_ASSERT(p.have_peers.count(peer) == 1);
-				p.have_peers.erase(peer);
+			TORRENT_ASSERT(p.have_peers.count(peer) == 1);
+			p.have_peers.erase(peer);
 #else
-				TORRENT_UNUSED(peer);
+			TORRENT_UNUSED(peer);
 #endif
 
-				TORRENT_ASSERT(p.peer_count > 0);
-				--p.peer_count;
-				updated = true;
-			}
-		}
+			TORRENT_ASSERT(p.peer_count > 0);
+			--p.peer_count;
+			updated = true;
+		});
 
 		// if we're already dirty, no point in doing anything more
 		if (m_dirty) return;
@@ -1598,6 +1616,30 @@ namespace libtorrent {
 #endif
 	}
 
+	void piece_picker::update_wanted(piece_index_t const index, bool const passed)
+	{
+		bool const wanted = !passed && !m_piece_map[index].filtered();
+		if (m_wanted.get_bit(index) == wanted) return;
+		if (wanted) m_wanted.set_bit(index);
+		else m_wanted.clear_bit(index);
+
+		// catching up on a change is a bit test, starting over is a pass over
+		// all of m_wanted. There's no point in remembering many more changes
+		// than there are words in it. When full, forget the older half
+		int const max_log = std::max(64, num_pieces() / 32);
+		if (int(m_wanted_log.size()) >= max_log)
+			m_wanted_log.erase(m_wanted_log.begin(), m_wanted_log.begin() + max_log / 2);
+		m_wanted_log.push_back({index, wanted});
+		++m_wanted_seq;
+	}
+
+	void piece_picker::reset_wanted_log()
+	{
+		m_wanted_log.clear();
+		// skip a number, to make anyone who's caught up start over
+		++m_wanted_seq;
+	}
+
 	void piece_picker::piece_passed(piece_index_t const index)
 	{
 		piece_pos& p = m_piece_map[index];
@@ -1616,6 +1658,7 @@ namespace libtorrent {
 		TORRENT_ASSERT(!i->passed_hash_check);
 		i->passed_hash_check = true;
 		++m_num_passed;
+		update_wanted(index, true);
 
 		if (i->finished < blocks_in_piece(index)) return;
 
@@ -1645,6 +1688,7 @@ namespace libtorrent {
 				i->passed_hash_check = false;
 				TORRENT_ASSERT(m_num_passed > 0);
 				--m_num_passed;
+				update_wanted(index, false);
 			}
 			erase_download_piece(i);
 			return;
@@ -1678,6 +1722,7 @@ namespace libtorrent {
 		m_have_pad_bytes -= pad_bytes_in_piece(index);
 		TORRENT_ASSERT(m_have_pad_bytes >= 0);
 		p.set_not_have();
+		update_wanted(index, false);
 
 		if (m_dirty) return;
 		if (p.priority(this) >= 0) add(index);
@@ -1730,6 +1775,7 @@ namespace libtorrent {
 		m_have_pad_bytes += pad_bytes_in_piece(index);
 		TORRENT_ASSERT(m_have_pad_bytes <= num_pad_bytes());
 		p.set_have();
+		update_wanted(index, true);
 		if (m_cursor == prev(m_reverse_cursor)
 			&& m_cursor == index)
 		{
@@ -1785,6 +1831,8 @@ namespace libtorrent {
 		m_reverse_cursor = piece_index_t{0};
 		m_num_passed = num_pieces();
 		m_num_have = num_pieces();
+		m_wanted.clear_all();
+		reset_wanted_log();
 
 		for (auto& queue : m_downloads) queue.clear();
 		for (auto& p : m_piece_map)
@@ -1889,6 +1937,7 @@ namespace libtorrent {
 
 		p.piece_priority = static_cast<std::uint8_t>(new_piece_priority);
 		int const new_priority = p.priority(this);
+		if (ret) update_wanted(index, has_piece_passed(index));
 
 		if (prev_priority != new_priority && !m_dirty)
 		{
@@ -3476,6 +3525,7 @@ get_out:
 			i->passed_hash_check = false;
 			TORRENT_ASSERT(m_num_passed > 0);
 			--m_num_passed;
+			update_wanted(piece, false);
 		}
 
 		// prevent this piece from being picked until it's restored
@@ -3528,6 +3578,7 @@ get_out:
 			i->passed_hash_check = false;
 			TORRENT_ASSERT(m_num_passed > 0);
 			--m_num_passed;
+			update_wanted(block.piece_index, false);
 		}
 
 		// prevent this hash job from actually completing
@@ -41,6 +41,28 @@ POSSIBILITY OF SUCH DAMAGE.
 namespace libtorrent {
 namespace aux {
 
+buffer receive_buffer_pool::borrow()
+{
+	if (m_free.empty()) return buffer(buffer_size);
+	buffer ret = std::move(m_free.back());
+	m_free.pop_back();
+	return ret;
+}
+
+void receive_buffer_pool::give_back(buffer b)
+{
+	TORRENT_ASSERT(b.size() >= buffer_size);
+	if (int(m_free.size()) >= max_free) return;
+	m_free.push_back(std::move(b));
+}
+
+void receive_buffer::replace_buffer(buffer b)
+{
+	if (m_pooled) m_pool->give_back(std::move(m_recv_buffer));
+	m_recv_buffer = std::move(b);
+	m_pooled = false;
+}
+
 int receive_buffer::max_receive() const
 {
 	return int(m_recv_buffer.size()) - m_recv_end;
@@ -58,8 +80,18 @@ span<char> receive_buffer::reserve(int const size)
 	if (int(m_recv_buffer.size()) < m_recv_end + size)
 	{
 		int const new_size = std::max(m_recv_end + size, m_packet_size);
+		if (m_pool != nullptr
+			&& m_recv_end == 0
+			&& new_size <= receive_buffer_pool::buffer_size)
+		{
+			// a small read into an empty buffer, borrow one from the pool
+			replace_buffer(m_pool->borrow());
+			m_pooled = true;
+			return span<char>(m_recv_buffer).subspan(m_recv_end, size);
+		}
+
 		buffer new_buffer(new_size, {m_recv_buffer.data(), m_recv_end});
-		m_recv_buffer = std::move(new_buffer);
+		replace_buffer(std::move(new_buffer));
 
 		// since we just increased the size of the buffer, reset the watermark to
 		// start at our new size (avoid flapping the buffer size)
@@ -81,13 +113,24 @@ void receive_buffer::grow(int const limit)
 
 	// re-allocate the buffer and copy over the part of it that's used
 	buffer new_buffer(new_size, {m_recv_buffer.data(), m_recv_end});
-	m_recv_buffer = std::move(new_buffer);
+	replace_buffer(std::move(new_buffer));
 
 	// since we just increased the size of the buffer, reset the watermark to
 	// start at our new size (avoid flapping the buffer size)
 	m_watermark = {};
 }
 
+void receive_buffer::release()
+{
+	INVARIANT_CHECK;
+	TORRENT_ASSERT(m_recv_start == 0);
+	TORRENT_ASSERT(m_recv_end == 0);
+	TORRENT_ASSERT(m_recv_pos == 0);
+
+	replace_buffer(buffer());
+	m_watermark = {};
+}
+
 int receive_buffer::advance_pos(int const bytes)
 {
 	INVARIANT_CHECK;
@@ -181,14 +224,16 @@ void receive_buffer::normalize(int const force_shrink)
 	m_watermark.add_sample(std::max(m_recv_end, m_packet_size));
 
 	// if the running average drops below half of the current buffer size,
-	// reallocate a smaller one.
-	bool const shrink_buffer = std::int64_t(m_recv_buffer.size()) / 2 > m_watermark.mean()
+	// reallocate a smaller one. Pooled buffers are already small, and are
+	// handed back rather than shrunk
+	bool const shrink_buffer = !m_pooled
+		&& std::int64_t(m_recv_buffer.size()) / 2 > m_watermark.mean()
 		&& m_watermark.mean() > (m_recv_end - m_recv_start);
 
 	span<char const> bytes_to_shift(m_recv_buffer.data() + m_recv_start
 		, m_recv_end - m_recv_start);
 
-	if (force_shrink)
+	if (force_shrink && !m_pooled)
 	{
 		int const target_size = std::max(std::max(force_shrink
 			, int(bytes_to_shift.size())), m_packet_size);
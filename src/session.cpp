@@ -54,6 +54,7 @@ namespace libtorrent {
 	constexpr feature_flags_t plugin::dht_request_feature;
 	constexpr feature_flags_t plugin::alert_feature;
 	constexpr feature_flags_t plugin::unknown_torrent_feature;
+	constexpr feature_flags_t plugin::unchoke_feature;
 #endif
 
 namespace aux {
@@ -65,6 +66,9 @@ namespace aux {
 	constexpr torrent_list_index_t session_interface::torrent_downloading_auto_managed;
 	constexpr torrent_list_index_t session_interface::torrent_seeding_auto_managed;
 	constexpr torrent_list_index_t session_interface::torrent_checking_auto_managed;
+	constexpr torrent_list_index_t session_interface::torrent_snapshot_updates;
+	constexpr torrent_list_index_t session_interface::torrent_want_shed_peer_list;
+	constexpr torrent_list_index_t session_interface::torrent_started_auto_managed;
 }
 
 #ifndef TORRENT_DISABLE_EXTENSIONS
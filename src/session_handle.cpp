@@ -175,6 +175,23 @@ namespace libtorrent {
 		return r;
 	}
 
+	// calls f(session_impl&) on the network thread and passes the result to
+	// handler, also on the network thread
+	template <typename Ret, typename Fun>
+	void session_handle::async_call_handler(
+		std::function<void(error_code const&, Ret)> handler, Fun f) const
+	{
+		aux::completion_handler<Ret> h(std::move(handler));
+		std::shared_ptr<session_impl> s = m_impl.lock();
+		if (!s)
+		{
+			h.complete(errors::invalid_session_handle, Ret{});
+			return;
+		}
+		dispatch(s->get_context(), [s, f, h = std::move(h)]() mutable
+		{ h.call([&] { return f(*s); }); });
+	}
+
 #if TORRENT_ABI_VERSION <= 2
 	void session_handle::save_state(entry& e, save_state_flags_t const flags) const
 	{
@@ -270,6 +287,46 @@ namespace libtorrent {
 		return sync_call_ret<std::vector<torrent_handle>>(&session_impl::get_torrents);
 	}
 
+	void session_handle::async_find_torrent(sha1_hash const& info_hash
+		, std::function<void(error_code const&, torrent_handle)> handler) const
+	{
+		async_call_handler(std::move(handler), [info_hash](session_impl& ses)
+		{ return ses.find_torrent_handle(info_hash); });
+	}
+
+	void session_handle::async_get_torrents(
+		std::function<void(error_code const&, std::vector<torrent_handle>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](session_impl& ses)
+		{ return ses.get_torrents(); });
+	}
+
+	void session_handle::async_get_torrent_status(
+		std::function<bool(torrent_status const&)> pred
+		, status_flags_t const flags
+		, std::function<void(error_code const&, std::vector<torrent_status>)> handler) const
+	{
+		async_call_handler(std::move(handler)
+			, [p = std::move(pred), flags](session_impl& ses)
+		{
+			std::vector<torrent_status> ret;
+			ses.get_torrent_status(&ret, p, flags);
+			return ret;
+		});
+	}
+
+	void session_handle::async_refresh_torrent_status(std::vector<torrent_status> status
+		, status_flags_t const flags
+		, std::function<void(error_code const&, std::vector<torrent_status>)> handler) const
+	{
+		async_call_handler(std::move(handler)
+			, [st = std::move(status), flags](session_impl& ses) mutable
+		{
+			ses.refresh_torrent_status(&st, flags);
+			return std::move(st);
+		});
+	}
+
 #if TORRENT_ABI_VERSION == 1
 namespace {
 
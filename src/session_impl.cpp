@@ -486,9 +486,9 @@ void apply_deprecated_dht_settings(settings_pack& sett, bdecode_node const& s)
 		auto* torrent_ctx = t->ssl_ctx();
 		if (!torrent_ctx) return false;
 
-		// use this torrent's certificate
-		ssl::set_context(stream_handle, ssl::get_handle(*torrent_ctx));
-		return true;
+		// use this torrent's certificate. This fails if the peer tries to
+		// resume a session it established with another torrent
+		return ssl::set_context(stream_handle, ssl::get_handle(*torrent_ctx));
 	}
 
 #if defined TORRENT_USE_OPENSSL
@@ -651,10 +651,17 @@ bool ssl_server_name_callback(ssl::stream_handle_type stream_handle, std::string
 		ec.clear();
 #endif
 #endif // __APPLE__
+		// trackers and web seeds are connected to over and over, resuming
+		// their TLS sessions saves the full handshake
+		ssl::enable_session_cache(ssl::get_handle(m_ssl_ctx));
 #endif // TORRENT_USE_SSL
 #ifdef TORRENT_SSL_PEERS
 		m_peer_ssl_ctx.set_verify_mode(ssl::context::verify_none, ec);
 		ssl::set_server_name_callback(ssl::get_handle(m_peer_ssl_ctx), ssl_server_name_callback, this, ec);
+		// incoming connections switch to the torrent's context once they've
+		// sent the server name. The session ID context of the torrent's
+		// context then binds the session to that torrent
+		ssl::set_session_id_context(ssl::get_handle(m_peer_ssl_ctx), "libtorrent");
 #endif // TORRENT_SSL_PEERS
 
 #ifndef TORRENT_DISABLE_DHT
@@ -995,6 +1002,8 @@ bool ssl_server_name_callback(ssl::stream_handle_type stream_handle, std::string
 			m_ses_extensions[plugins_dht_request_idx].push_back(ext);
 		if (features & plugin::unknown_torrent_feature)
 			m_ses_extensions[plugins_unknown_torrent_idx].push_back(ext);
+		if (features & plugin::unchoke_feature)
+			m_ses_extensions[plugins_unchoke_idx].push_back(ext);
 		if (features & plugin::alert_feature)
 			m_alerts.add_extension(ext);
 		session_handle h(shared_from_this());
@@ -3315,7 +3324,8 @@ namespace {
 
 	bool session_impl::verify_queue_position(torrent const* t, queue_position_t const pos)
 	{
-		return m_download_queue.end_index() > pos && m_download_queue[pos] == t;
+		return m_download_queue.size() > static_cast<int>(pos)
+			&& m_download_queue[static_cast<int>(pos)] == t;
 	}
 #endif
 
@@ -3467,6 +3477,11 @@ namespace {
 		m_ssl_utp_socket_manager.tick(now);
 #endif
 
+		// torrents whose state changed since the last tick have their status
+		// snapshots re-published. This bounds how stale a snapshot can be to
+		// one tick_interval
+		publish_status_snapshots();
+
 		// only tick the following once per second
 		if (now - m_last_second_tick < seconds(1)) return;
 
@@ -3618,6 +3633,9 @@ namespace {
 			if (!t.want_tick()) --i;
 		}
 
+		enforce_torrent_memory_budget();
+		shed_idle_peer_lists();
+
 		// TODO: this should apply to all bandwidth channels
 		if (m_settings.get_bool(settings_pack::rate_limit_ip_overhead))
 		{
@@ -3763,6 +3781,96 @@ namespace {
 		}
 	}
 
+	int session_impl::num_web_seed_connections(std::string const& host, int const port) const
+	{
+		auto const i = m_web_seed_connections.find(std::make_pair(host, port));
+		return i == m_web_seed_connections.end() ? 0 : i->second;
+	}
+
+	void session_impl::inc_web_seed_connections(std::string const& host
+		, int const port, int const delta)
+	{
+		auto const key = std::make_pair(host, port);
+		int& cnt = m_web_seed_connections[key];
+		cnt += delta;
+		TORRENT_ASSERT(cnt >= 0);
+		if (cnt <= 0) m_web_seed_connections.erase(key);
+	}
+
+	void session_impl::cache_metadata(info_hash_t const& ih
+		, span<char const> const info_section)
+	{
+		std::int64_t const limit = m_settings.get_int(settings_pack::metadata_cache_size);
+		if (info_section.size() > limit) return;
+
+		auto const i = std::find_if(m_metadata_cache.begin(), m_metadata_cache.end()
+			, [&](cached_info_section const& c) { return c.info_hashes == ih; });
+		if (i != m_metadata_cache.end())
+		{
+			m_metadata_cache_bytes -= std::int64_t(i->buf.size());
+			m_metadata_cache.erase(i);
+		}
+
+		m_metadata_cache.push_back({ih
+			, std::vector<char>(info_section.begin(), info_section.end())});
+		m_metadata_cache_bytes += info_section.size();
+		update_metadata_cache_size();
+	}
+
+	std::shared_ptr<torrent_info> session_impl::cached_metadata(info_hash_t const& ih)
+	{
+		// the cached metadata must agree with every info-hash we were given
+		auto const i = std::find_if(m_metadata_cache.rbegin(), m_metadata_cache.rend()
+			, [&](cached_info_section const& c)
+			{
+				return (ih.has_v1() || ih.has_v2())
+					&& (!ih.has_v1() || ih.v1 == c.info_hashes.v1)
+					&& (!ih.has_v2() || ih.v2 == c.info_hashes.v2);
+			});
+		if (i == m_metadata_cache.rend()) return {};
+
+		error_code ec;
+		bdecode_node const info = bdecode(i->buf, ec, nullptr, 200
+			, m_settings.get_int(settings_pack::metadata_token_limit));
+		auto ti = std::make_shared<torrent_info>(i->info_hashes);
+		if (ec || !ti->parse_info_section(info, ec
+			, m_settings.get_int(settings_pack::max_piece_count)))
+			return {};
+
+		// move it to the most recently used end
+		std::rotate(std::prev(i.base()), i.base(), m_metadata_cache.end());
+
+#ifndef TORRENT_DISABLE_LOGGING
+		session_log("found metadata for %s in metadata cache"
+			, aux::to_hex(ti->info_hashes().get_best()).c_str());
+#endif
+		return ti;
+	}
+
+	void session_impl::update_metadata_cache_size()
+	{
+		std::int64_t const limit = m_settings.get_int(settings_pack::metadata_cache_size);
+		auto i = m_metadata_cache.begin();
+		while (m_metadata_cache_bytes > limit && i != m_metadata_cache.end())
+		{
+			m_metadata_cache_bytes -= std::int64_t(i->buf.size());
+			++i;
+		}
+		m_metadata_cache.erase(m_metadata_cache.begin(), i);
+	}
+
+	void session_impl::update_seed_rank_limits()
+	{
+		for (torrent* t : m_torrent_lists[torrent_seeding_auto_managed])
+			t->update_seed_order();
+	}
+
+	void session_impl::update_shed_peer_list_timeout()
+	{
+		for (auto const& t : m_torrents)
+			t->update_want_shed_peer_list();
+	}
+
 	void session_impl::received_buffer(int s)
 	{
 		int index = std::min(aux::log2p1(std::uint32_t(s >> 3)), 17);
@@ -3933,57 +4041,129 @@ namespace {
 		}
 	}
 
-	void session_impl::auto_manage_torrents(std::vector<torrent*>& list
+	void session_impl::auto_manage_torrent(torrent& t
 		, int& dht_limit, int& tracker_limit
-		, int& lsd_limit, int& hard_limit, int type_limit)
+		, int& lsd_limit, int& hard_limit, int& type_limit)
 	{
-		for (auto& t : list)
-		{
-			TORRENT_ASSERT(t->state() != torrent_status::checking_files);
+		TORRENT_ASSERT(t.state() != torrent_status::checking_files);
 
-			// inactive torrents don't count (and if you configured them to do so,
-			// the torrent won't say it's inactive)
-			if (hard_limit > 0 && t->is_inactive())
-			{
-				t->set_announce_to_dht(--dht_limit >= 0);
-				t->set_announce_to_trackers(--tracker_limit >= 0);
-				t->set_announce_to_lsd(--lsd_limit >= 0);
+		// inactive torrents don't count (and if you configured them to do so,
+		// the torrent won't say it's inactive)
+		if (hard_limit > 0 && t.is_inactive())
+		{
+			t.set_announce_to_dht(--dht_limit >= 0);
+			t.set_announce_to_trackers(--tracker_limit >= 0);
+			t.set_announce_to_lsd(--lsd_limit >= 0);
 
-				--hard_limit;
+			--hard_limit;
 #ifndef TORRENT_DISABLE_LOGGING
-				if (t->is_torrent_paused())
-					t->log_to_all_peers("auto manager starting (inactive) torrent");
+			if (t.is_torrent_paused())
+				t.log_to_all_peers("auto manager starting (inactive) torrent");
 #endif
-				t->set_paused(false);
-				continue;
-			}
+			t.set_paused(false);
+			return;
+		}
 
-			if (type_limit > 0 && hard_limit > 0)
-			{
-				t->set_announce_to_dht(--dht_limit >= 0);
-				t->set_announce_to_trackers(--tracker_limit >= 0);
-				t->set_announce_to_lsd(--lsd_limit >= 0);
+		if (type_limit > 0 && hard_limit > 0)
+		{
+			t.set_announce_to_dht(--dht_limit >= 0);
+			t.set_announce_to_trackers(--tracker_limit >= 0);
+			t.set_announce_to_lsd(--lsd_limit >= 0);
 
-				--hard_limit;
-				--type_limit;
+			--hard_limit;
+			--type_limit;
 #ifndef TORRENT_DISABLE_LOGGING
-				if (t->is_torrent_paused())
-					t->log_to_all_peers("auto manager starting torrent");
+			if (t.is_torrent_paused())
+				t.log_to_all_peers("auto manager starting torrent");
 #endif
-				t->set_paused(false);
-				continue;
-			}
+			t.set_paused(false);
+			return;
+		}
 
 #ifndef TORRENT_DISABLE_LOGGING
-			if (!t->is_torrent_paused())
-				t->log_to_all_peers("auto manager pausing torrent");
+		if (!t.is_torrent_paused())
+			t.log_to_all_peers("auto manager pausing torrent");
 #endif
-			// use graceful pause for auto-managed torrents
-			t->set_paused(true, torrent_handle::graceful_pause
-				| torrent_handle::clear_disk_cache);
-			t->set_announce_to_dht(false);
-			t->set_announce_to_trackers(false);
-			t->set_announce_to_lsd(false);
+		// use graceful pause for auto-managed torrents
+		t.set_paused(true, torrent_handle::graceful_pause
+			| torrent_handle::clear_disk_cache);
+		t.set_announce_to_dht(false);
+		t.set_announce_to_trackers(false);
+		t.set_announce_to_lsd(false);
+	}
+
+	// Once the limits are used up, the only torrents that may still be
+	// started are inactive ones, and only started torrents can be inactive
+	// (pausing a torrent clears its inactive state). Torrents that are
+	// already paused would be left as they are, so only the started ones
+	// need to be visited past that point.
+	void session_impl::auto_manage_downloaders(int& dht_limit
+		, int& tracker_limit, int& lsd_limit, int& hard_limit, int type_limit)
+	{
+		// the download queue is ordered by queue position, which is the order
+		// downloading torrents are started in
+		queue_position_t pos{0};
+		for (auto i = m_download_queue.begin(); i != m_download_queue.end()
+			&& type_limit > 0 && hard_limit > 0; ++i, ++pos)
+		{
+			torrent& t = **i;
+			if (!t.m_links[torrent_downloading_auto_managed].in_list()) continue;
+			auto_manage_torrent(t, dht_limit, tracker_limit, lsd_limit
+				, hard_limit, type_limit);
+		}
+
+		std::vector<torrent*> started;
+		for (torrent* t : m_torrent_lists[torrent_started_auto_managed])
+		{
+			if (t->m_links[torrent_downloading_auto_managed].in_list()
+				&& t->queue_position() >= pos)
+				started.push_back(t);
+		}
+		std::sort(started.begin(), started.end()
+			, [](torrent const* lhs, torrent const* rhs)
+			{ return lhs->queue_position() < rhs->queue_position(); });
+
+		for (torrent* t : started)
+		{
+			auto_manage_torrent(*t, dht_limit, tracker_limit, lsd_limit
+				, hard_limit, type_limit);
+		}
+	}
+
+	void session_impl::auto_manage_seeds(int& dht_limit
+		, int& tracker_limit, int& lsd_limit, int& hard_limit, int type_limit)
+	{
+		// the rank of started seeds changes over time, so they are ranked on
+		// every pass. Paused seeds are kept in rank order in m_queued_seeds.
+		// Walk both in rank order until the limits are used up, past that
+		// point only the started seeds may change state (see
+		// auto_manage_downloaders())
+		std::vector<ranked_seed> started;
+		for (torrent* t : m_torrent_lists[torrent_started_auto_managed])
+		{
+			if (t->m_links[torrent_seeding_auto_managed].in_list())
+				started.emplace_back(t->seed_rank(m_settings), t);
+		}
+		std::sort(started.begin(), started.end(), higher_seed_rank());
+
+		auto s = started.begin();
+		auto q = m_queued_seeds.begin();
+		while (type_limit > 0 && hard_limit > 0
+			&& (s != started.end() || q != m_queued_seeds.end()))
+		{
+			// starting a queued seed removes it from m_queued_seeds, so step
+			// past it first
+			torrent* t = (q == m_queued_seeds.end()
+				|| (s != started.end() && s->first >= q->first))
+				? (s++)->second : (q++)->second;
+			auto_manage_torrent(*t, dht_limit, tracker_limit, lsd_limit
+				, hard_limit, type_limit);
+		}
+
+		for (; s != started.end(); ++s)
+		{
+			auto_manage_torrent(*s->second, dht_limit, tracker_limit, lsd_limit
+				, hard_limit, type_limit);
 		}
 	}
 
@@ -4003,14 +4183,11 @@ namespace {
 
 		if (m_paused) return;
 
-		// make copies of the lists of torrents that we want to consider for auto
-		// management. We need copies because they will be sorted.
+		// make a copy of the checking torrents, since it will be sorted.
+		// Downloading and seeding torrents are visited in priority order by
+		// auto_manage_downloaders() and auto_manage_seeds()
 		std::vector<torrent*> checking
 			= torrent_list(session_interface::torrent_checking_auto_managed);
-		std::vector<torrent*> downloaders
-			= torrent_list(session_interface::torrent_downloading_auto_managed);
-		std::vector<torrent*> seeds
-			= torrent_list(session_interface::torrent_seeding_auto_managed);
 
 		// these counters are set to the number of torrents
 		// of each kind we're allowed to have active
@@ -4034,32 +4211,22 @@ namespace {
 				std::min(checking_limit, int(checking.size())), checking.end()
 				, [](torrent const* lhs, torrent const* rhs)
 				{ return lhs->sequence_number() < rhs->sequence_number(); });
-
-			std::partial_sort(downloaders.begin(), downloaders.begin() +
-				std::min(hard_limit, int(downloaders.size())), downloaders.end()
-				, [](torrent const* lhs, torrent const* rhs)
-				{ return lhs->sequence_number() < rhs->sequence_number(); });
-
-			std::partial_sort(seeds.begin(), seeds.begin() +
-				std::min(hard_limit, int(seeds.size())), seeds.end()
-				, [this](torrent const* lhs, torrent const* rhs)
-				{ return lhs->seed_rank(m_settings) > rhs->seed_rank(m_settings); });
 		}
 
 		auto_manage_checking_torrents(checking, checking_limit);
 
 		if (settings().get_bool(settings_pack::auto_manage_prefer_seeds))
 		{
-			auto_manage_torrents(seeds, dht_limit, tracker_limit, lsd_limit
+			auto_manage_seeds(dht_limit, tracker_limit, lsd_limit
 				, hard_limit, seeding_limit);
-			auto_manage_torrents(downloaders, dht_limit, tracker_limit, lsd_limit
+			auto_manage_downloaders(dht_limit, tracker_limit, lsd_limit
 				, hard_limit, downloading_limit);
 		}
 		else
 		{
-			auto_manage_torrents(downloaders, dht_limit, tracker_limit, lsd_limit
+			auto_manage_downloaders(dht_limit, tracker_limit, lsd_limit
 				, hard_limit, downloading_limit);
-			auto_manage_torrents(seeds, dht_limit, tracker_limit, lsd_limit
+			auto_manage_seeds(dht_limit, tracker_limit, lsd_limit
 				, hard_limit, seeding_limit);
 		}
 	}
@@ -4465,8 +4632,23 @@ namespace {
 			peers.push_back(p.get());
 		}
 
+		std::function<std::uint64_t(peer_connection&)> ext_rank;
+#ifndef TORRENT_DISABLE_EXTENSIONS
+		auto const& rank_plugins = m_ses_extensions[plugins_unchoke_idx];
+		if (!rank_plugins.empty())
+		{
+			ext_rank = [&rank_plugins](peer_connection& p)
+			{
+				std::uint64_t rank = std::numeric_limits<std::uint64_t>::max();
+				for (auto& e : rank_plugins)
+					rank = std::min(rank, e->get_unchoke_rank(peer_connection_handle(p.self())));
+				return rank;
+			};
+		}
+#endif
+
 		int const allowed_upload_slots = unchoke_sort(peers
-			, unchoke_interval, m_settings);
+			, unchoke_interval, m_settings, ext_rank);
 
 		if (m_settings.get_int(settings_pack::choking_algorithm) == settings_pack::fixed_slots_choker)
 		{
@@ -4595,81 +4777,62 @@ namespace {
 	void session_impl::update_torrent_info_hash(std::shared_ptr<torrent> const& t
 		, info_hash_t const& old_ih)
 	{
-		m_torrents.erase(old_ih);
-		m_torrents.insert(t->info_hash(), t);
+		bool const updated = m_torrents.update_info_hash(old_ih, t->info_hash());
+		TORRENT_ASSERT(updated);
+		TORRENT_UNUSED(updated);
 	}
 
-	void session_impl::set_queue_position(torrent* me, queue_position_t p)
+	void session_impl::set_queue_position(torrent* me, queue_position_t const p)
 	{
+		aux::queue_node<torrent>& n = me->queue_entry();
 		queue_position_t const current_pos = me->queue_position();
 		if (current_pos == p) return;
 
-		if (p >= queue_position_t{0} && current_pos == no_pos)
-		{
-			// we're inserting the torrent into the download queue
-			queue_position_t const last = m_download_queue.end_index();
-			if (p >= last)
-			{
-				m_download_queue.push_back(me);
-				me->set_queue_position_impl(last);
-			}
-			else
-			{
-				m_download_queue.insert(m_download_queue.begin() + static_cast<int>(p), me);
-				for (queue_position_t i = p; i < m_download_queue.end_index(); ++i)
-				{
-					m_download_queue[i]->set_queue_position_impl(i);
-				}
-			}
-		}
-		else if (p < queue_position_t{})
+		// the positions of the torrents between the old and the new position
+		// change implicitly, only the torrent that moved is updated
+		if (p < queue_position_t{})
 		{
 			// we're removing the torrent from the download queue
 			TORRENT_ASSERT(current_pos >= queue_position_t{0});
 			TORRENT_ASSERT(p == no_pos);
-			TORRENT_ASSERT(m_download_queue[current_pos] == me);
-			m_download_queue.erase(m_download_queue.begin() + static_cast<int>(current_pos));
-			me->set_queue_position_impl(no_pos);
-			for (queue_position_t i = current_pos; i < m_download_queue.end_index(); ++i)
-			{
-				m_download_queue[i]->set_queue_position_impl(i);
-			}
+			m_download_queue.erase(n);
 		}
-		else if (p < current_pos)
+		else if (current_pos == no_pos)
 		{
-			// we're moving the torrent up the queue
-			torrent* tmp = me;
-			for (queue_position_t i = p; i <= current_pos; ++i)
-			{
-				std::swap(m_download_queue[i], tmp);
-				m_download_queue[i]->set_queue_position_impl(i);
-			}
-			TORRENT_ASSERT(tmp == me);
+			// we're inserting the torrent into the download queue
+			m_download_queue.insert(n, static_cast<int>(p));
 		}
-		else if (p > current_pos)
+		else
 		{
-			// we're moving the torrent down the queue
-			p = std::min(p, prev(m_download_queue.end_index()));
-			for (queue_position_t i = current_pos; i < p; ++i)
-			{
-				m_download_queue[i] = m_download_queue[next(i)];
-				m_download_queue[i]->set_queue_position_impl(i);
-			}
-			m_download_queue[p] = me;
-			me->set_queue_position_impl(p);
+			m_download_queue.move(n, static_cast<int>(p));
 		}
 
+		me->state_updated();
 		trigger_auto_manage();
 	}
 
+	void session_impl::insert_queued_seed(torrent* t, int const rank)
+	{
+		bool const inserted = m_queued_seeds.emplace(rank, t).second;
+		TORRENT_ASSERT(inserted);
+		TORRENT_UNUSED(inserted);
+	}
+
+	void session_impl::erase_queued_seed(torrent* t, int const rank)
+	{
+		auto const erased = m_queued_seeds.erase({rank, t});
+		TORRENT_ASSERT(erased == 1);
+		TORRENT_UNUSED(erased);
+	}
+
 #if !defined TORRENT_DISABLE_ENCRYPTION
 	torrent const* session_impl::find_encrypted_torrent(sha1_hash const& info_hash
-		, sha1_hash const& xor_mask)
+		, sha1_hash const& xor_mask, protocol_version& v)
 	{
 		sha1_hash obfuscated = info_hash;
 		obfuscated ^= xor_mask;
 
-		return m_torrents.find_obfuscated(obfuscated);
+		return m_torrents.find_obfuscated(obfuscated, &v);
 	}
 #endif
 
@@ -4807,6 +4970,104 @@ namespace {
 		m_alerts.emplace_alert<state_update_alert>(std::move(status));
 	}
 
+	void session_impl::publish_status_snapshots()
+	{
+		TORRENT_ASSERT(is_single_thread());
+
+		std::vector<torrent*>& snapshot_updates
+			= m_torrent_lists[aux::session_impl::torrent_snapshot_updates];
+
+		for (auto& t : snapshot_updates)
+		{
+			TORRENT_ASSERT(t->m_links[aux::session_impl::torrent_snapshot_updates].in_list());
+			t->publish_status_snapshot();
+			t->clear_in_snapshot_update();
+		}
+		snapshot_updates.clear();
+	}
+
+	void session_impl::enforce_torrent_memory_budget()
+	{
+		TORRENT_ASSERT(is_single_thread());
+
+		std::int64_t const budget
+			= std::int64_t(m_settings.get_int(settings_pack::torrent_memory_budget)) * 1024;
+		if (budget <= 0)
+		{
+			m_memory_budget_retry = 0;
+			return;
+		}
+
+		std::int64_t usage = 0;
+		for (int i = counters::torrent_memory_metadata;
+			i <= counters::torrent_memory_extensions; ++i)
+			usage += m_stats_counters[i];
+		if (usage <= budget)
+		{
+			m_memory_budget_retry = 0;
+			return;
+		}
+
+		// if the last attempt could not get within the budget (e.g. because
+		// the metadata alone exceeds it), don't drain the peer lists again
+		// until they have grown back by a meaningful amount
+		if (usage <= m_memory_budget_retry) return;
+
+		// trim a bit below the budget, to not end up trimming again on the
+		// next tick as soon as a few peers are added
+		std::int64_t const low_water = budget - budget / 8;
+
+		// peer lists are the only state that can be dropped without losing
+		// progress. Start with paused torrents (which drop their entire
+		// list), then the largest peer lists
+		std::vector<torrent*> candidates;
+		for (auto const& t : m_torrents)
+		{
+			if (t->num_known_peers() > t->num_peers())
+				candidates.push_back(t.get());
+		}
+		std::sort(candidates.begin(), candidates.end()
+			, [](torrent const* lhs, torrent const* rhs)
+			{
+				if (lhs->is_paused() != rhs->is_paused()) return lhs->is_paused();
+				return lhs->num_known_peers() > rhs->num_known_peers();
+			});
+
+		for (torrent* t : candidates)
+		{
+			std::int64_t const freed = t->shed_peer_list();
+			if (freed <= 0) break;
+			usage -= freed;
+			if (usage <= low_water) break;
+		}
+
+		m_memory_budget_retry = usage > budget ? usage + budget / 8 : 0;
+	}
+
+	void session_impl::shed_idle_peer_lists()
+	{
+		TORRENT_ASSERT(is_single_thread());
+
+		int const timeout = m_settings.get_int(settings_pack::shed_peer_list_timeout);
+		if (timeout <= 0) return;
+
+		time_point32 const now = aux::time_now32();
+		aux::vector<torrent*>& want_shed
+			= m_torrent_lists[aux::session_impl::torrent_want_shed_peer_list];
+		for (int i = 0; i < int(want_shed.size());)
+		{
+			torrent& t = *want_shed[i];
+			TORRENT_ASSERT(!t.is_aborted());
+
+			// shed_idle_peer_list() removes the torrent from the list on success
+			if (now - t.shed_candidate_since() < seconds(timeout)
+				|| !t.shed_idle_peer_list())
+			{
+				++i;
+			}
+		}
+	}
+
 	void session_impl::post_session_stats()
 	{
 		if (!m_posted_stats_header)
@@ -5028,6 +5289,11 @@ namespace {
 			return ret_t{ptr_t(), params.info_hashes, false};
 		}
 
+		// if we've downloaded the metadata for this torrent before, there's
+		// no need to do it again
+		if (!params.ti && !m_metadata_cache.empty())
+			params.ti = cached_metadata(params.info_hashes);
+
 		if (params.ti && params.ti->is_valid() && params.ti->num_files() == 0)
 		{
 			ec = errors::no_files_in_torrent;
@@ -5103,7 +5369,7 @@ namespace {
 		try
 		{
 			torrent_ptr = std::make_shared<torrent>(*this, m_paused, std::move(params));
-			torrent_ptr->set_queue_position(m_download_queue.end_index());
+			torrent_ptr->set_queue_position(last_pos);
 		}
 		catch (system_error const& e)
 		{
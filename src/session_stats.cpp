@@ -568,6 +568,18 @@ namespace {
 		// this measure the number of tracker announces currently in the
 		// queue
 		METRIC(tracker, num_queued_tracker_announces)
+
+		// an estimate of the number of bytes of memory used by all torrents
+		// in the session, per subsystem. ``metadata`` is the torrent_info
+		// objects (including the file lists), ``piece_picker`` is the
+		// download state, ``peer_list`` is the lists of known peers,
+		// ``hash_trees`` is the v2 merkle trees and hash picker state and
+		// ``extensions`` is the state reported by torrent plugins.
+		METRIC(ses, torrent_memory_metadata)
+		METRIC(ses, torrent_memory_piece_picker)
+		METRIC(ses, torrent_memory_peer_list)
+		METRIC(ses, torrent_memory_hash_trees)
+		METRIC(ses, torrent_memory_extensions)
 		// ... more
 	}});
 #undef METRIC
@@ -239,6 +239,7 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		SET(allow_idna, false, nullptr),
 		SET(enable_set_file_valid_data, false, nullptr),
 		SET(socks5_udp_send_local_ep, false, nullptr),
+		SET(enable_ktls, false, nullptr),
 	}});
 
 	CONSTEXPR_SETTINGS
@@ -294,7 +295,7 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		SET(active_limit, 500, &session_impl::trigger_auto_manage),
 		DEPRECATED_SET(active_loaded_limit, 0, &session_impl::trigger_auto_manage),
 		SET(auto_manage_interval, 30, nullptr),
-		SET(seed_time_limit, 24 * 60 * 60, nullptr),
+		SET(seed_time_limit, 24 * 60 * 60, &session_impl::update_seed_rank_limits),
 		SET(auto_scrape_interval, 1800, nullptr),
 		SET(auto_scrape_min_interval, 300, nullptr),
 		SET(max_peerlist_size, 3000, nullptr),
@@ -354,8 +355,8 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		DEPRECATED_SET(network_threads, 0, nullptr),
 		DEPRECATED_SET(ssl_listen, 0, &session_impl::update_ssl_listen),
 		SET(tracker_backoff, 250, nullptr),
-		SET(share_ratio_limit, 200, nullptr),
-		SET(seed_time_ratio_limit, 700, nullptr),
+		SET(share_ratio_limit, 200, &session_impl::update_seed_rank_limits),
+		SET(seed_time_ratio_limit, 700, &session_impl::update_seed_rank_limits),
 		SET(peer_turnover, 4, nullptr),
 		SET(peer_turnover_cutoff, 90, nullptr),
 		SET(peer_turnover_interval, 300, nullptr),
@@ -401,7 +402,11 @@ constexpr int DISK_WRITE_MODE = settings_pack::enable_os_cache;
 		SET(i2p_inbound_quantity, 3, nullptr),
 		SET(i2p_outbound_quantity, 3, nullptr),
 		SET(i2p_inbound_length, 3, nullptr),
-		SET(i2p_outbound_length, 3, nullptr)
+		SET(i2p_outbound_length, 3, nullptr),
+		SET(max_web_seed_connections_per_host, 0, nullptr),
+		SET(metadata_cache_size, 4 * 1024 * 1024, &session_impl::update_metadata_cache_size),
+		SET(torrent_memory_budget, 0, nullptr),
+		SET(shed_peer_list_timeout, 0, &session_impl::update_shed_peer_list_timeout)
 	}});
 
 #undef SET
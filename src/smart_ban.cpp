@@ -36,7 +36,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef TORRENT_DISABLE_EXTENSIONS
 
 #include <vector>
-#include <map>
+#include <algorithm>
 #include <utility>
 #include <numeric>
 #include <cstdio>
@@ -52,6 +52,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/peer_info.hpp"
 #include "libtorrent/random.hpp"
 #include "libtorrent/operations.hpp" // for operation_t enum
+#include "libtorrent/peer_connection_handle.hpp"
+#include "libtorrent/aux_/suspect_pieces.hpp"
 
 #ifndef TORRENT_DISABLE_LOGGING
 #include "libtorrent/socket_io.hpp"
@@ -66,6 +68,25 @@ struct torrent;
 
 namespace {
 
+	// the max number of block hashes to keep for a single torrent. When
+	// more pieces than this fail, the state for the least recently failed
+	// pieces is evicted. This keeps the memory usage bounded even when
+	// being fed a lot of bad data
+	constexpr int max_block_records = 16384;
+
+	// identifies the peer that sent a block. The address is kept to detect
+	// if the torrent_peer object has been removed from the peer list
+	struct block_origin
+	{
+		torrent_peer* peer;
+		address addr;
+
+		bool operator==(block_origin const& rhs) const
+		{ return peer == rhs.peer && addr == rhs.addr; }
+	};
+
+	using suspect_pieces = aux::suspect_pieces<block_origin>;
+	using block_record = suspect_pieces::block_record;
 
 	struct smart_ban_plugin final
 		: torrent_plugin
@@ -73,79 +94,77 @@ namespace {
 	{
 		explicit smart_ban_plugin(torrent& t)
 			: m_torrent(t)
+			, m_pieces(max_block_records)
 		{}
 
+		std::shared_ptr<peer_plugin> new_connection(peer_connection_handle const& pc) override;
+
 		void on_piece_pass(piece_index_t const p) override
 		{
-			// has this piece failed earlier? If it has, go through the
-			// CRCs from the time it failed and ban the peers that
-			// sent bad blocks
-			auto i = m_block_hashes.lower_bound(piece_block(p, 0));
-			if (i == m_block_hashes.end() || i->first.piece_index != p) return;
+			// has this piece failed earlier? If it has, compare the block
+			// hashes from the time it failed against the hashes of the blocks
+			// that made the piece pass, and ban the peers that sent bad blocks
+			if (!m_pieces.is_suspect(p)) return;
 
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_torrent.should_log())
-				m_torrent.debug_log("PIECE PASS [ p: %d | block_hash_size: %d ]"
-					, static_cast<int>(p), int(m_block_hashes.size()));
+				m_torrent.debug_log("PIECE PASS [ p: %d ]", static_cast<int>(p));
 #endif
 
-			int size = m_torrent.torrent_file().piece_size(p);
-			peer_request r = {p, 0, std::min(16 * 1024, size)};
-			piece_block pb(p, 0);
-			while (size > 0)
+			std::vector<block_record> unresolved = m_pieces.piece_passed(p
+				, [this, p](block_record const& bad, sha1_hash const& ok_digest)
+				{ ban(bad, p, ok_digest); });
+
+			// the blocks that made the piece pass weren't all hashed as they
+			// were received. Read those back from disk (where they're now
+			// known to be good) and compare them to the failed ones
+			std::sort(unresolved.begin(), unresolved.end()
+				, [](block_record const& lhs, block_record const& rhs)
+				{ return lhs.block < rhs.block; });
+			int const size = m_torrent.torrent_file().piece_size(p);
+			for (auto i = unresolved.begin(); i != unresolved.end();)
 			{
-				if (i->first.block_index == pb.block_index)
-				{
-					m_torrent.session().disk_thread().async_read(m_torrent.storage()
-						, r, std::bind(&smart_ban_plugin::on_read_ok_block
-						, shared_from_this(), *i, i->second.peer->address(), _1, r.length, _2));
-					i = m_block_hashes.erase(i);
-				}
-				else
-				{
-					TORRENT_ASSERT(i->first.block_index > pb.block_index);
-				}
-
-				if (i == m_block_hashes.end() || i->first.piece_index != p)
-					break;
-
-				r.start += 16 * 1024;
-				size -= 16 * 1024;
-				r.length = std::min(16 * 1024, size);
-				++pb.block_index;
+				int const block = i->block;
+				auto const end = std::find_if(i, unresolved.end()
+					, [block](block_record const& r) { return r.block != block; });
+				peer_request const r = {p, block * default_block_size
+					, std::min(default_block_size, size - block * default_block_size)};
+				m_torrent.session().disk_thread().async_read(m_torrent.storage(), r
+					, std::bind(&smart_ban_plugin::on_read_ok_block
+					, shared_from_this(), p, std::vector<block_record>(i, end), _1, r.length, _2));
+				i = end;
 			}
 
-#ifndef NDEBUG
-			// make sure we actually removed all the entries for piece 'p'
-			i = m_block_hashes.lower_bound(piece_block(p, 0));
-			TORRENT_ASSERT(i == m_block_hashes.end() || i->first.piece_index != p);
-#endif
-
-			if (m_torrent.is_seed())
-			{
-				std::map<piece_block, block_entry>().swap(m_block_hashes);
-				return;
-			}
+			if (m_torrent.is_seed()) m_pieces.clear();
 		}
 
 		void on_piece_failed(piece_index_t const p) override
 		{
 			// The piece failed the hash check. Record
-			// the CRC and origin peer of every block
+			// the hash and origin peer of every block
 
-			// if the torrent is aborted, no point in starting
-			// a bunch of read operations on it
+			// if the torrent is aborted, there's no point in keeping track of
+			// anything
 			if (m_torrent.is_aborted()) return;
 
+			int size = m_torrent.torrent_file().piece_size(p);
+			int const num_blocks = (size + default_block_size - 1) / default_block_size;
+
+			// if this piece failed before, its blocks were hashed as they were
+			// received. The ones that weren't (the first time it fails, or
+			// blocks that bypassed the peer plugins) are read back from disk
+			std::vector<bool> const read_back = m_pieces.piece_failed(p, num_blocks
+				, [this, p](block_record const& bad, sha1_hash const& other_digest)
+				{ ban(bad, p, other_digest); });
+
 			std::vector<torrent_peer*> const downloaders
 				= m_torrent.picker().get_downloaders(p);
 
-			int size = m_torrent.torrent_file().piece_size(p);
-			peer_request r = {p, 0, std::min(16*1024, size)};
-			piece_block pb(p, 0);
-			for (auto const& i : downloaders)
+			peer_request r = {p, 0, std::min(default_block_size, size)};
+			int block = 0;
+			for (auto const& peer : downloaders)
 			{
-				if (i != nullptr)
+				if (peer != nullptr && read_back[std::size_t(block)])
 				{
 					// for very sad and involved reasons, this read need to force a copy out of the cache
 					// since the piece has failed, this block is very likely to be replaced with a newly
@@ -153,88 +172,55 @@ namespace {
 					// block read will have been deleted by the time it gets back to the network thread
 					m_torrent.session().disk_thread().async_read(m_torrent.storage(), r
 						, std::bind(&smart_ban_plugin::on_read_failed_block
-						, shared_from_this(), pb, i->address(), _1, r.length, _2)
+						, shared_from_this(), p, block, peer, peer->address(), _1, r.length, _2)
 						, disk_interface::force_copy);
 				}
 
-				r.start += 16*1024;
-				size -= 16*1024;
-				r.length = std::min(16*1024, size);
-				++pb.block_index;
+				r.start += default_block_size;
+				size -= default_block_size;
+				r.length = std::min(default_block_size, size);
+				++block;
 			}
 			TORRENT_ASSERT(size <= 0);
 		}
 
-	private:
-
-		// this entry ties a specific block CRC to
-		// a peer.
-		struct block_entry
+		std::int64_t memory_usage() const override
 		{
-			torrent_peer* peer;
-			sha1_hash digest;
-		};
+			return m_pieces.memory_usage();
+		}
 
-		void on_read_failed_block(piece_block const b, address const a
-			, disk_buffer_holder buffer, int const block_size
-			, storage_error const& error)
+		// called from the receive path, before the block is written to disk
+		void on_block_received(peer_request const& r, span<char const> buf
+			, torrent_peer* peer)
 		{
-			TORRENT_ASSERT(m_torrent.session().is_single_thread());
-
-			// ignore read errors
-			if (error) return;
-
-			hasher h;
-			h.update({buffer.data(), block_size});
-
-			auto const range = m_torrent.find_peers(a);
+			if (peer == nullptr) return;
+			if (!m_pieces.is_suspect(r.piece)) return;
 
-			// there is no peer with this address anymore
-			if (range.first == range.second) return;
-
-			torrent_peer* p = (*range.first);
-			block_entry e = {p, h.final()};
+			// the block failed to arrive in time to be part of the previous
+			// attempt, so it belongs to this one
+			m_pieces.block_received(r.piece, {{peer, peer->address()}
+				, hasher(buf).final(), r.start / default_block_size});
+		}
 
-			auto i = m_block_hashes.lower_bound(b);
+	private:
 
-			if (i != m_block_hashes.end() && i->first == b && i->second.peer == p)
+		torrent_peer* find_peer(block_origin const& o)
+		{
+			auto range = m_torrent.find_peers(o.addr);
+			for (; range.first != range.second; ++range.first)
 			{
-				// this peer has sent us this block before
-				// if the peer is already banned, it doesn't matter if it sent
-				// good or bad data. Nothings going to change it
-				if (!p->banned && i->second.digest != e.digest)
-				{
-					// this time the digest of the block is different
-					// from the first time it sent it
-					// at least one of them must be bad
-#ifndef TORRENT_DISABLE_LOGGING
-					if (m_torrent.should_log())
-					{
-						char const* client = "-";
-						peer_info info;
-						if (p->connection)
-						{
-							p->connection->get_peer_info(info);
-							client = info.client.c_str();
-						}
-						m_torrent.debug_log("BANNING PEER [ p: %d | b: %d | c: %s"
-							" | hash1: %s | hash2: %s | ip: %s ]"
-							, static_cast<int>(b.piece_index), b.block_index, client
-							, aux::to_hex(i->second.digest).c_str()
-							, aux::to_hex(e.digest).c_str()
-							, print_endpoint(p->ip()).c_str());
-					}
-#endif
-					m_torrent.ban_peer(p);
-					if (p->connection) p->connection->disconnect(
-						errors::peer_banned, operation_t::bittorrent);
-				}
-				// we already have this exact entry in the map
-				// we don't have to insert it
-				return;
+				if (*range.first == o.peer) return o.peer;
 			}
+			// web seeds aren't in the peer list
+			if (m_torrent.is_web_seed_peer(o.peer)) return o.peer;
+			return nullptr;
+		}
 
-			m_block_hashes.insert(i, std::pair<const piece_block, block_entry>(b, e));
+		void ban(block_record const& bad, piece_index_t const piece
+			, sha1_hash const& ok_digest)
+		{
+			torrent_peer* p = find_peer(bad.peer);
+			if (p == nullptr || p->banned) return;
 
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_torrent.should_log())
@@ -246,17 +232,26 @@ namespace {
 					p->connection->get_peer_info(info);
 					client = info.client.c_str();
 				}
-				m_torrent.debug_log("STORE BLOCK CRC [ p: %d | b: %d | c: %s"
-					" | digest: %s | ip: %s ]"
-					, static_cast<int>(b.piece_index), b.block_index, client
-					, aux::to_hex(e.digest).c_str()
+				m_torrent.debug_log("BANNING PEER [ p: %d | b: %d | c: %s"
+					" | ok_digest: %s | bad_digest: %s | ip: %s ]"
+					, static_cast<int>(piece), bad.block, client
+					, aux::to_hex(ok_digest).c_str()
+					, aux::to_hex(bad.digest).c_str()
 					, print_address(p->ip().address()).c_str());
 			}
+#else
+			TORRENT_UNUSED(piece);
+			TORRENT_UNUSED(ok_digest);
 #endif
+			// web seeds are only banned if settings_pack::ban_web_seeds is set
+			if (!m_torrent.ban_peer(p)) return;
+			if (p->connection) p->connection->disconnect(
+				errors::peer_banned, operation_t::bittorrent);
 		}
 
-		void on_read_ok_block(std::pair<piece_block, block_entry> const b
-			, address const& a, disk_buffer_holder buffer, int const block_size
+		void on_read_failed_block(piece_index_t const piece, int const block
+			, torrent_peer* const peer, address const a
+			, disk_buffer_holder buffer, int const block_size
 			, storage_error const& error)
 		{
 			TORRENT_ASSERT(m_torrent.session().is_single_thread());
@@ -264,57 +259,82 @@ namespace {
 			// ignore read errors
 			if (error) return;
 
-			hasher h;
-			h.update({buffer.data(), block_size});
-			sha1_hash const ok_digest = h.final();
+			// the piece may have been evicted (or passed) while we were reading
+			if (!m_pieces.is_suspect(piece)) return;
 
-			if (b.second.digest == ok_digest) return;
+			block_record const rec{{peer, a}
+				, hasher(buffer.data(), block_size).final(), block};
 
-			// find the peer
-			auto range = m_torrent.find_peers(a);
-			if (range.first == range.second) return;
-			torrent_peer* p = nullptr;
-			for (; range.first != range.second; ++range.first)
-			{
-				if (b.second.peer != *range.first) continue;
-				p = *range.first;
-			}
-			if (p == nullptr) return;
+			// there is no peer with this address anymore
+			if (find_peer(rec.peer) == nullptr) return;
 
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_torrent.should_log())
 			{
-				char const* client = "-";
-				peer_info info;
-				if (p->connection)
-				{
-					p->connection->get_peer_info(info);
-					client = info.client.c_str();
-				}
-				m_torrent.debug_log("BANNING PEER [ p: %d | b: %d | c: %s"
-					" | ok_digest: %s | bad_digest: %s | ip: %s ]"
-					, static_cast<int>(b.first.piece_index), b.first.block_index, client
-					, aux::to_hex(ok_digest).c_str()
-					, aux::to_hex(b.second.digest).c_str()
-					, print_address(p->ip().address()).c_str());
+				m_torrent.debug_log("STORE BLOCK HASH [ p: %d | b: %d"
+					" | digest: %s | ip: %s ]"
+					, static_cast<int>(piece), block
+					, aux::to_hex(rec.digest).c_str()
+					, print_address(a).c_str());
 			}
 #endif
-			m_torrent.ban_peer(p);
-			if (p->connection) p->connection->disconnect(
-				errors::peer_banned, operation_t::bittorrent);
+			m_pieces.failed_block(piece, rec
+				, [this, piece](block_record const& bad, sha1_hash const& other_digest)
+				{ ban(bad, piece, other_digest); });
+		}
+
+		// the data of a block of a piece that passed the hash check, read
+		// back to be compared against the blocks of earlier, failed attempts
+		void on_read_ok_block(piece_index_t const piece
+			, std::vector<block_record> const& failed
+			, disk_buffer_holder buffer, int const block_size
+			, storage_error const& error)
+		{
+			TORRENT_ASSERT(m_torrent.session().is_single_thread());
+
+			// ignore read errors
+			if (error) return;
+
+			sha1_hash const ok_digest = hasher(buffer.data(), block_size).final();
+			for (block_record const& bad : failed)
+			{
+				if (bad.digest == ok_digest) continue;
+				ban(bad, piece, ok_digest);
+			}
 		}
 
 		torrent& m_torrent;
 
-		// This table maps a piece_block (piece and block index
-		// pair) to a peer and the block CRC. The CRC is calculated
-		// from the data in the block + the salt
-		std::map<piece_block, block_entry> m_block_hashes;
+		// pieces that have failed the hash check and haven't passed yet,
+		// with the block hashes recorded for them
+		suspect_pieces m_pieces;
 
 		// explicitly disallow assignment, to silence msvc warning
 		smart_ban_plugin& operator=(smart_ban_plugin const&) = delete;
 	};
 
+	struct smart_ban_peer_plugin final : peer_plugin
+	{
+		smart_ban_peer_plugin(smart_ban_plugin& tp, peer_connection& pc)
+			: m_tp(tp), m_pc(pc) {}
+
+		bool on_piece(peer_request const& r, span<char const> buf) override
+		{
+			m_tp.on_block_received(r, buf, m_pc.peer_info_struct());
+			return false;
+		}
+
+	private:
+		smart_ban_plugin& m_tp;
+		peer_connection& m_pc;
+	};
+
+	std::shared_ptr<peer_plugin> smart_ban_plugin::new_connection(
+		peer_connection_handle const& pc)
+	{
+		return std::make_shared<smart_ban_peer_plugin>(*this, *pc.native_handle());
+	}
+
 } }
 
 namespace libtorrent {
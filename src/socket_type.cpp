@@ -98,6 +98,16 @@ namespace aux {
 	}
 #endif
 
+	bool can_wait_read(socket_type const& s)
+	{
+#if defined TORRENT_BUILD_SIMULATOR
+		TORRENT_UNUSED(s);
+		return false;
+#else
+		return boost::get<tcp::socket>(&s) || boost::get<utp_stream>(&s);
+#endif
+	}
+
 	struct idx_visitor {
 		socket_type_t operator()(tcp::socket const&) const { return socket_type_t::tcp; }
 		socket_type_t operator()(socks5_stream const&) const { return socket_type_t::socks5; }
@@ -40,6 +40,38 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/x509v3.h> // for GENERAL_NAME
 #endif
 
+#include "libtorrent/assert.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#if TORRENT_USE_KTLS
+#include "libtorrent/hex.hpp" // for from_hex
+#include "libtorrent/span.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <linux/tls.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
 #ifdef TORRENT_USE_GNUTLS
 #include <gnutls/x509.h>
 #endif
@@ -141,15 +173,32 @@ void set_host_name(stream_handle_type s, std::string const& name, error_code& ec
 #endif
 }
 
-void set_context(stream_handle_type s, context_handle_type c)
+#if TORRENT_USE_SSL_SESSION_CACHE
+namespace {
+	bool bind_session(SSL* s, SSL_CTX* c);
+}
+#endif
+
+bool set_context(stream_handle_type s, context_handle_type c)
 {
 #if defined TORRENT_USE_OPENSSL
 	SSL_set_SSL_CTX(s, c);
 	SSL_set_verify(s
 		, SSL_CTX_get_verify_mode(c)
 		, SSL_CTX_get_verify_callback(c));
+#if TORRENT_USE_KTLS
+	// the number of session tickets is copied into the SSL object when it's
+	// created, from the context it started out with
+	if (ktls_enabled(c)) SSL_set_num_tickets(s, 0);
+#endif
+#if TORRENT_USE_SSL_SESSION_CACHE
+	return bind_session(s, c);
+#else
+	return true;
+#endif
 #elif defined TORRENT_USE_GNUTLS
 	s->set_context(*c);
+	return true;
 #endif
 }
 
@@ -172,6 +221,467 @@ context_handle_type get_context(stream_handle_type s)
 #endif
 }
 
+#if TORRENT_USE_SSL_SESSION_CACHE
+namespace {
+
+	// client sessions of a context, keyed by endpoint and server name
+	struct session_cache
+	{
+		// the number of sessions to keep per context. When full, the least
+		// recently stored one is evicted
+		static constexpr int max_sessions = 500;
+
+		session_cache() = default;
+		session_cache(session_cache const&) = delete;
+		session_cache& operator=(session_cache const&) = delete;
+		~session_cache() { clear(); }
+
+		void store(std::string const& key, SSL_SESSION* sess)
+		{
+			auto it = m_sessions.find(key);
+			if (it != m_sessions.end())
+			{
+				SSL_SESSION_free(it->second.session);
+				it->second = entry{sess, m_counter++};
+				return;
+			}
+			if (int(m_sessions.size()) >= max_sessions)
+			{
+				auto const oldest = std::min_element(m_sessions.begin(), m_sessions.end()
+					, [](std::pair<std::string const, entry> const& lhs
+						, std::pair<std::string const, entry> const& rhs)
+					{ return lhs.second.stored < rhs.second.stored; });
+				SSL_SESSION_free(oldest->second.session);
+				m_sessions.erase(oldest);
+			}
+			m_sessions.emplace(key, entry{sess, m_counter++});
+		}
+
+		// returns a session to resume the connection for key, or nullptr. The
+		// caller owns the returned reference
+		SSL_SESSION* take(std::string const& key)
+		{
+			auto it = m_sessions.find(key);
+			if (it == m_sessions.end()) return nullptr;
+			SSL_SESSION* const sess = it->second.session;
+			// TLS 1.3 tickets should only be used once (RFC 8446 C.4). The
+			// server sends new ones on the resumed connection. TLS 1.2
+			// session IDs are reused until the server forgets them
+			if (SSL_SESSION_get_protocol_version(sess) == TLS1_3_VERSION)
+			{
+				m_sessions.erase(it);
+				return sess;
+			}
+			// the connection marks its session as not resumable if it's
+			// closed without a close_notify. Hand out a copy to keep ours
+			// intact
+			return SSL_SESSION_dup(sess);
+		}
+
+		void erase(std::string const& key)
+		{
+			auto it = m_sessions.find(key);
+			if (it == m_sessions.end()) return;
+			SSL_SESSION_free(it->second.session);
+			m_sessions.erase(it);
+		}
+
+		void clear()
+		{
+			for (auto& e : m_sessions) SSL_SESSION_free(e.second.session);
+			m_sessions.clear();
+		}
+
+		int size() const { return int(m_sessions.size()); }
+
+	private:
+
+		struct entry
+		{
+			SSL_SESSION* session;
+			std::uint64_t stored;
+		};
+		std::map<std::string, entry> m_sessions;
+		std::uint64_t m_counter = 0;
+	};
+
+	void free_session_cache(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+	{
+		delete static_cast<session_cache*>(ptr);
+	}
+
+	void free_string(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+	{
+		delete static_cast<std::string*>(ptr);
+	}
+
+	int session_cache_index()
+	{
+		static int const idx = SSL_CTX_get_ex_new_index(0, nullptr, nullptr
+			, nullptr, &free_session_cache);
+		return idx;
+	}
+
+	// the ID set by set_session_id_context(), on the context
+	int session_id_index()
+	{
+		static int const idx = SSL_CTX_get_ex_new_index(0, nullptr, nullptr
+			, nullptr, &free_string);
+		return idx;
+	}
+
+	// the key a client stream's session is cached under, on the stream
+	int session_key_index()
+	{
+		static int const idx = SSL_get_ex_new_index(0, nullptr, nullptr
+			, nullptr, &free_string);
+		return idx;
+	}
+
+	session_cache* get_session_cache(SSL_CTX* c)
+	{
+		return static_cast<session_cache*>(SSL_CTX_get_ex_data(c, session_cache_index()));
+	}
+
+	int on_new_session(SSL* s, SSL_SESSION* sess)
+	{
+		auto const* key = static_cast<std::string const*>(
+			SSL_get_ex_data(s, session_key_index()));
+		session_cache* cache = get_session_cache(SSL_get_SSL_CTX(s));
+		if (key == nullptr || cache == nullptr) return 0;
+		if (!SSL_SESSION_is_resumable(sess)) return 0;
+		// sess is still the connection's session, which is marked as not
+		// resumable if the connection is closed without a close_notify.
+		// Store a copy of it
+		SSL_SESSION* const copy = SSL_SESSION_dup(sess);
+		if (copy == nullptr) return 0;
+		cache->store(*key, copy);
+		return 0;
+	}
+
+	// a server looks up the session to resume before the server name
+	// callback has switched the stream to its final context, so OpenSSL
+	// only compares the session ID context of the context the stream
+	// started out on. Sessions carry the ID of the context they were
+	// established on in their ticket data, and may only be resumed on a
+	// context with the same ID
+	bool bind_session(SSL* s, SSL_CTX* c)
+	{
+		SSL_SESSION* const sess = SSL_get_session(s);
+		if (sess == nullptr) return true;
+		auto const* id = static_cast<std::string const*>(
+			SSL_CTX_get_ex_data(c, session_id_index()));
+		if (SSL_session_reused(s))
+		{
+			void* data = nullptr;
+			std::size_t len = 0;
+			SSL_SESSION_get0_ticket_appdata(sess, &data, &len);
+			return id != nullptr && data != nullptr
+				&& string_view(static_cast<char const*>(data), len) == *id;
+		}
+		if (id != nullptr)
+			SSL_SESSION_set1_ticket_appdata(sess, id->data(), id->size());
+		return true;
+	}
+}
+#endif // TORRENT_USE_SSL_SESSION_CACHE
+
+void set_session_id_context(context_handle_type c, string_view const id)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	TORRENT_ASSERT(id.size() <= SSL_MAX_SID_CTX_LENGTH);
+	SSL_CTX_set_session_id_context(c
+		, reinterpret_cast<unsigned char const*>(id.data())
+		, unsigned(std::min(id.size(), std::size_t(SSL_MAX_SID_CTX_LENGTH))));
+	free_string(nullptr, SSL_CTX_get_ex_data(c, session_id_index())
+		, nullptr, session_id_index(), 0, nullptr);
+	SSL_CTX_set_ex_data(c, session_id_index(), new std::string(id));
+#else
+	TORRENT_UNUSED(c);
+	TORRENT_UNUSED(id);
+#endif
+}
+
+void enable_session_cache(context_handle_type c)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	if (get_session_cache(c) == nullptr)
+		SSL_CTX_set_ex_data(c, session_cache_index(), new session_cache);
+	// we keep client sessions ourselves, keyed by where we connect to.
+	// OpenSSL's internal cache is only useful to servers
+	SSL_CTX_set_session_cache_mode(c, SSL_SESS_CACHE_CLIENT
+		| SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(c, &on_new_session);
+#else
+	TORRENT_UNUSED(c);
+#endif
+}
+
+void clear_session_cache(context_handle_type c)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	if (session_cache* cache = get_session_cache(c)) cache->clear();
+#else
+	TORRENT_UNUSED(c);
+#endif
+}
+
+int session_cache_size(context_handle_type c)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	session_cache const* cache = get_session_cache(c);
+	return cache == nullptr ? 0 : cache->size();
+#else
+	TORRENT_UNUSED(c);
+	return 0;
+#endif
+}
+
+void resume_session(stream_handle_type s, string_view const key)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	session_cache* cache = get_session_cache(SSL_get_SSL_CTX(s));
+	if (cache == nullptr) return;
+
+	auto k = std::make_unique<std::string>(key);
+	if (char const* name = SSL_get_servername(s, TLSEXT_NAMETYPE_host_name))
+	{
+		k->push_back(' ');
+		k->append(name);
+	}
+
+	if (SSL_SESSION* sess = cache->take(*k))
+	{
+		SSL_set_session(s, sess);
+		SSL_SESSION_free(sess);
+	}
+
+	free_string(nullptr, SSL_get_ex_data(s, session_key_index())
+		, nullptr, session_key_index(), 0, nullptr);
+	SSL_set_ex_data(s, session_key_index(), k.release());
+#else
+	TORRENT_UNUSED(s);
+	TORRENT_UNUSED(key);
+#endif
+}
+
+void forget_session(stream_handle_type s)
+{
+#if TORRENT_USE_SSL_SESSION_CACHE
+	auto const* key = static_cast<std::string const*>(
+		SSL_get_ex_data(s, session_key_index()));
+	session_cache* cache = get_session_cache(SSL_get_SSL_CTX(s));
+	if (key == nullptr || cache == nullptr) return;
+	cache->erase(*key);
+#else
+	TORRENT_UNUSED(s);
+#endif
+}
+
+#if TORRENT_USE_KTLS
+namespace {
+
+	// the traffic secret of our side of the connection, as captured by the
+	// key log callback during the handshake
+	struct tx_secret
+	{
+		int size = 0;
+		std::array<std::uint8_t, EVP_MAX_MD_SIZE> secret;
+	};
+
+	void free_tx_secret(void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+	{
+		auto* sec = static_cast<tx_secret*>(ptr);
+		if (sec == nullptr) return;
+		OPENSSL_cleanse(sec->secret.data(), sec->secret.size());
+		delete sec;
+	}
+
+	int tx_secret_index()
+	{
+		static int const idx = SSL_get_ex_new_index(0, nullptr, nullptr
+			, nullptr, &free_tx_secret);
+		return idx;
+	}
+
+	void clear_tx_secret(SSL* s)
+	{
+		int const idx = tx_secret_index();
+		free_tx_secret(nullptr, SSL_get_ex_data(s, idx), nullptr, idx, 0, nullptr);
+		SSL_set_ex_data(s, idx, nullptr);
+	}
+
+	void ktls_keylog(SSL const* s, char const* line)
+	{
+		// lines are on the form: <label> <client-random> <secret>
+		string_view const l(line);
+		string_view const label = SSL_is_server(const_cast<SSL*>(s))
+			? "SERVER_TRAFFIC_SECRET_0 " : "CLIENT_TRAFFIC_SECRET_0 ";
+		if (l.substr(0, label.size()) != label) return;
+		string_view const hex = l.substr(l.rfind(' ') + 1);
+
+		auto sec = std::make_unique<tx_secret>();
+		if (hex.size() % 2 != 0 || hex.size() / 2 > sec->secret.size()) return;
+		sec->size = int(hex.size() / 2);
+		if (!aux::from_hex(hex, reinterpret_cast<char*>(sec->secret.data())))
+			return;
+
+		SSL* ssl = const_cast<SSL*>(s);
+		clear_tx_secret(ssl);
+		SSL_set_ex_data(ssl, tx_secret_index(), sec.release());
+	}
+
+	// HKDF-Expand-Label() from RFC 8446 section 7.1, with an empty context.
+	// We never need more output than one hash block, so a single HMAC round
+	// is enough
+	bool expand_label(EVP_MD const* md, tx_secret const& sec
+		, string_view const label, span<std::uint8_t> out)
+	{
+		string_view const prefix = "tls13 ";
+		std::array<std::uint8_t, 32> info;
+		int const label_len = int(prefix.size() + label.size());
+		std::uint8_t* ptr = info.data();
+		*ptr++ = std::uint8_t(out.size() >> 8);
+		*ptr++ = std::uint8_t(out.size() & 0xff);
+		*ptr++ = std::uint8_t(label_len);
+		ptr = std::copy(prefix.begin(), prefix.end(), ptr);
+		ptr = std::copy(label.begin(), label.end(), ptr);
+		// context length
+		*ptr++ = 0;
+		// the HKDF-Expand block counter
+		*ptr++ = 1;
+
+		std::array<std::uint8_t, EVP_MAX_MD_SIZE> block;
+		unsigned int block_len = 0;
+		if (HMAC(md, sec.secret.data(), sec.size, info.data()
+			, std::size_t(ptr - info.data()), block.data(), &block_len) == nullptr)
+			return false;
+		if (int(block_len) < out.size()) return false;
+		std::memcpy(out.data(), block.data(), std::size_t(out.size()));
+		OPENSSL_cleanse(block.data(), block.size());
+		return true;
+	}
+
+	template <typename CryptoInfo>
+	int set_tx_key(int const fd, std::uint16_t const cipher, ktls_tx_key const& k)
+	{
+		CryptoInfo ci{};
+		ci.info.version = TLS_1_3_VERSION;
+		ci.info.cipher_type = cipher;
+		TORRENT_ASSERT(sizeof(ci.key) == std::size_t(k.key_size));
+		TORRENT_ASSERT(sizeof(ci.salt) + sizeof(ci.iv) == k.iv.size());
+		std::memcpy(ci.key, k.key.data(), sizeof(ci.key));
+		std::memcpy(ci.salt, k.iv.data(), sizeof(ci.salt));
+		std::memcpy(ci.iv, k.iv.data() + sizeof(ci.salt), sizeof(ci.iv));
+		// rec_seq stays 0. No application data has been sent yet
+		int const ret = ::setsockopt(fd, SOL_TLS, TLS_TX, &ci, sizeof(ci));
+		OPENSSL_cleanse(&ci, sizeof(ci));
+		return ret;
+	}
+
+	long reject_writes(BIO*, int const oper, char const*, std::size_t, int
+		, long, int const ret, std::size_t*)
+	{
+		// this is called before every operation on the BIO. Returning -1
+		// fails the write without it touching the buffer
+		if (oper == BIO_CB_WRITE) return -1;
+		return ret;
+	}
+}
+
+bool ktls_supported()
+{
+	static bool const supported = []
+	{
+		int const fd = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) return false;
+		// the tls ULP can only be attached to connected sockets. Getting
+		// ENOTCONN back means the kernel has it, ENOENT or ENOPROTOOPT means
+		// it doesn't
+		int const ret = ::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+		int const err = errno;
+		::close(fd);
+		return ret == 0 || err == ENOTCONN;
+	}();
+	return supported;
+}
+
+void enable_ktls(context_handle_type c)
+{
+	SSL_CTX_set_keylog_callback(c, &ktls_keylog);
+	SSL_CTX_set_num_tickets(c, 0);
+}
+
+bool ktls_enabled(context_handle_type c)
+{
+	return SSL_CTX_get_keylog_callback(c) == &ktls_keylog;
+}
+
+bool get_ktls_tx_key(stream_handle_type s, ktls_tx_key& k)
+{
+	if (SSL_version(s) != TLS1_3_VERSION) return false;
+	auto const* sec = static_cast<tx_secret const*>(
+		SSL_get_ex_data(s, tx_secret_index()));
+	if (sec == nullptr) return false;
+	SSL_CIPHER const* cipher = SSL_get_current_cipher(s);
+	if (cipher == nullptr) return false;
+
+	EVP_MD const* md = nullptr;
+	switch (SSL_CIPHER_get_id(cipher))
+	{
+		case TLS1_3_CK_AES_128_GCM_SHA256:
+			k.key_size = 16;
+			md = EVP_sha256();
+			break;
+		case TLS1_3_CK_AES_256_GCM_SHA384:
+			k.key_size = 32;
+			md = EVP_sha384();
+			break;
+		default:
+			return false;
+	}
+	if (sec->size != EVP_MD_size(md)) return false;
+
+	return expand_label(md, *sec, "key", {k.key.data(), k.key_size})
+		&& expand_label(md, *sec, "iv", k.iv);
+}
+
+bool enable_ktls_tx(stream_handle_type s, int const fd)
+{
+	ktls_tx_key k;
+	bool const have_key = get_ktls_tx_key(s, k);
+	// the secret is only needed once, don't keep it around
+	clear_tx_secret(s);
+	if (!have_key) return false;
+
+	int ret = ::setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+	if (ret == 0)
+	{
+		if (k.key_size == 16)
+		{
+			ret = set_tx_key<tls12_crypto_info_aes_gcm_128>(fd
+				, TLS_CIPHER_AES_GCM_128, k);
+		}
+		else
+		{
+			ret = set_tx_key<tls12_crypto_info_aes_gcm_256>(fd
+				, TLS_CIPHER_AES_GCM_256, k);
+		}
+	}
+	OPENSSL_cleanse(&k, sizeof(k));
+	// if only attaching the ULP succeeded, the socket keeps passing writes
+	// through unmodified
+	if (ret != 0) return false;
+	disable_userspace_tx(s);
+	return true;
+}
+
+void disable_userspace_tx(stream_handle_type s)
+{
+	BIO_set_callback_ex(SSL_get_wbio(s), &reject_writes);
+}
+#endif // TORRENT_USE_KTLS
+
 #if defined TORRENT_USE_OPENSSL
 namespace {
 	struct lifecycle
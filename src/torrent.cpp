@@ -147,6 +147,26 @@ bool is_downloading_state(int const st)
 			return false;
 	}
 }
+
+// flags for the entries in torrent::m_shed_peers
+constexpr std::uint8_t shed_peer_v6 = 1;
+constexpr std::uint8_t shed_peer_banned = 2;
+
+template <typename Fun>
+void for_each_shed_peer(std::vector<char> const& buf, Fun f)
+{
+	char const* ptr = buf.data();
+	char const* const end = ptr + buf.size();
+	while (ptr < end)
+	{
+		std::uint8_t const flags = std::uint8_t(*ptr++);
+		tcp::endpoint const ep = (flags & shed_peer_v6)
+			? aux::read_v6_endpoint<tcp::endpoint>(ptr)
+			: aux::read_v4_endpoint<tcp::endpoint>(ptr);
+		f(ep, flags);
+	}
+	TORRENT_ASSERT(ptr == end);
+}
 } // anonymous namespace
 
 	constexpr web_seed_flag_t torrent::ephemeral;
@@ -203,7 +223,7 @@ bool is_downloading_state(int const st)
 		, m_swarm_last_seen_complete(p.last_seen_complete)
 		, m_info_hash(p.info_hashes)
 		, m_error_file(torrent_status::error_file_none)
-		, m_sequence_number(-1)
+		, m_queue_node(this)
 		, m_peer_id(aux::generate_peer_id(settings()))
 		, m_announce_to_trackers(!(p.flags & torrent_flags::paused))
 		, m_announce_to_lsd(!(p.flags & torrent_flags::paused))
@@ -975,6 +995,10 @@ bool is_downloading_state(int const st)
 			// dont_download
 			prioritize_files(aux::vector<download_priority_t, file_index_t>(num_files, dont_download));
 		}
+		else
+		{
+			release_availability();
+		}
 	}
 #endif // TORRENT_DISABLE_SHARE_MODE
 
@@ -1028,6 +1052,12 @@ bool is_downloading_state(int const st)
 	void torrent::need_peer_list()
 	{
 		if (m_peer_list) return;
+		if (m_peer_list_shed)
+		{
+			// this creates the peer list
+			restore_peer_list();
+			return;
+		}
 		m_peer_list = std::make_unique<peer_list>(m_ses.get_peer_allocator());
 	}
 
@@ -1268,10 +1298,42 @@ bool is_downloading_state(int const st)
 		{
 			TORRENT_INCREMENT(m_iterating_connections);
 			if (p->is_disconnecting()) continue;
-			peer_has(p->get_bitfield(), p);
+			p->reset_wanted_count();
+			// the availability index is already counting this peer
+			m_picker->inc_refcount(p->get_bitfield(), p->peer_info_struct());
 		}
 	}
 
+	void torrent::need_availability()
+	{
+		if (m_availability) return;
+
+		TORRENT_ASSERT(valid_metadata());
+		TORRENT_ASSERT(m_connections_initialized);
+
+		m_availability = std::make_unique<aux::availability_index>(
+			m_torrent_file->num_pieces());
+
+		for (auto const p : m_connections)
+		{
+			TORRENT_INCREMENT(m_iterating_connections);
+			if (p->is_disconnecting()) continue;
+			if (p->is_seed()) m_availability->inc_all();
+			else m_availability->inc(p->get_bitfield());
+		}
+	}
+
+	void torrent::release_availability()
+	{
+#ifndef TORRENT_DISABLE_SUPERSEEDING
+		if (m_super_seeding) return;
+#endif
+#ifndef TORRENT_DISABLE_SHARE_MODE
+		if (m_share_mode) return;
+#endif
+		m_availability.reset();
+	}
+
 	void torrent::need_hash_picker()
 	{
 		if (m_hash_picker) return;
@@ -1713,6 +1775,17 @@ bool is_downloading_state(int const st)
 			return;
 		}
 
+#if TORRENT_USE_KTLS
+		if (settings().get_bool(settings_pack::enable_ktls) && ssl::ktls_supported())
+			ssl::enable_ktls(ctx->native_handle());
+#endif
+
+		// reconnecting to peers we've had sessions with skips the full
+		// handshake. Incoming sessions are bound to this torrent
+		ssl::enable_session_cache(ssl::get_handle(*ctx));
+		sha1_hash const ih = m_info_hash.get_best();
+		ssl::set_session_id_context(ssl::get_handle(*ctx), {ih.data(), std::size_t(ih.size())});
+
 #if 0
 		char filename[100];
 		std::snprintf(filename, sizeof(filename), "/tmp/%u.pem", random());
@@ -2001,6 +2074,7 @@ bool is_downloading_state(int const st)
 		maybe_done_flushing();
 
 		m_torrent_initialized = true;
+		update_memory_counters();
 	}
 
 	bt_peer_connection* torrent::find_introducer(tcp::endpoint const& ep) const
@@ -3442,6 +3516,7 @@ namespace {
 			m_downloaded = std::uint32_t(downloaded);
 
 			update_auto_sequential();
+			update_seed_order();
 
 			// these numbers are cached in the resume data
 			set_need_save_resume(torrent_handle::if_counters_changed);
@@ -4761,6 +4836,7 @@ namespace {
 
 	void torrent::peer_has(piece_index_t const index, peer_connection const* peer)
 	{
+		if (m_availability) m_availability->inc(index);
 		if (has_picker())
 		{
 			torrent_peer* pp = peer->peer_info_struct();
@@ -4776,6 +4852,7 @@ namespace {
 	void torrent::peer_has(typed_bitfield<piece_index_t> const& bits
 		, peer_connection const* peer)
 	{
+		if (m_availability) m_availability->inc(bits);
 		if (has_picker())
 		{
 			TORRENT_ASSERT(bits.size() == torrent_file().num_pieces());
@@ -4790,6 +4867,7 @@ namespace {
 
 	void torrent::peer_has_all(peer_connection const* peer)
 	{
+		if (m_availability) m_availability->inc_all();
 		if (has_picker())
 		{
 			torrent_peer* pp = peer->peer_info_struct();
@@ -4804,6 +4882,7 @@ namespace {
 	void torrent::peer_lost(typed_bitfield<piece_index_t> const& bits
 		, peer_connection const* peer)
 	{
+		if (m_availability) m_availability->dec(bits);
 		if (has_picker())
 		{
 			TORRENT_ASSERT(bits.size() == torrent_file().num_pieces());
@@ -4818,6 +4897,7 @@ namespace {
 
 	void torrent::peer_lost(piece_index_t const index, peer_connection const* peer)
 	{
+		if (m_availability) m_availability->dec(index);
 		if (m_picker)
 		{
 			torrent_peer* pp = peer->peer_info_struct();
@@ -4839,7 +4919,9 @@ namespace {
 		update_want_peers();
 		update_want_tick();
 		update_want_scrape();
+		update_want_shed_peer_list();
 		update_gauge();
+		update_memory_counters();
 		stop_announcing();
 
 		// remove from download queue
@@ -4951,6 +5033,7 @@ namespace {
 		{
 			pc->superseed_piece(piece_index_t(-1), piece_index_t(-1));
 		}
+		release_availability();
 	}
 
 	// TODO: 3 this should return optional<>. piece index -1 should not be
@@ -4961,41 +5044,32 @@ namespace {
 		// the bitfield and that is not currently being super
 		// seeded by any peer
 		TORRENT_ASSERT(m_super_seeding);
+		need_availability();
 
-		// do a linear search from the first piece
-		int min_availability = 9999;
-		std::vector<piece_index_t> avail_vec;
-		for (auto const i : m_torrent_file->piece_range())
+		// avoid super-seeding the same piece to more than one peer if we can
+		// avoid it
+		std::vector<piece_index_t> super_seeded;
+		for (auto pc : *this)
 		{
-			if (bits[i]) continue;
+			for (piece_index_t const p : pc->super_seeded_pieces())
+				if (p >= piece_index_t(0)) super_seeded.push_back(p);
+		}
+		std::sort(super_seeded.begin(), super_seeded.end());
 
-			int availability = 0;
-			for (auto pc : *this)
-			{
-				if (pc->super_seeded_piece(i))
-				{
-					// avoid super-seeding the same piece to more than one
-					// peer if we can avoid it. Do this by artificially
-					// increase the availability
-					availability = 999;
-					break;
-				}
-				if (pc->has_piece(i)) ++availability;
-			}
-			if (availability > min_availability) continue;
-			if (availability == min_availability)
+		piece_index_t const ret = m_availability->pick_rarest(0, random(0xffffffff)
+			, [&](piece_index_t const i)
 			{
-				avail_vec.push_back(i);
-				continue;
-			}
-			TORRENT_ASSERT(availability < min_availability);
-			min_availability = availability;
-			avail_vec.clear();
-			avail_vec.push_back(i);
-		}
+				return !bits[i] && !std::binary_search(super_seeded.begin()
+					, super_seeded.end(), i);
+			});
+		if (ret != piece_index_t(-1)) return ret;
 
-		if (avail_vec.empty()) return piece_index_t{-1};
-		return avail_vec[random(std::uint32_t(avail_vec.size() - 1))];
+		// every piece the peer is missing is already being super seeded to
+		// someone else
+		super_seeded.erase(std::remove_if(super_seeded.begin(), super_seeded.end()
+			, [&](piece_index_t const i) { return bits[i]; }), super_seeded.end());
+		if (super_seeded.empty()) return piece_index_t{-1};
+		return super_seeded[random(std::uint32_t(super_seeded.size() - 1))];
 	}
 #endif
 
@@ -5996,6 +6070,10 @@ namespace {
 			return;
 		}
 
+		// sessions established with the previous certificate would keep
+		// presenting it when resumed
+		ssl::clear_session_cache(ssl::get_handle(*m_ssl_ctx));
+
 		error_code ec;
 		m_ssl_ctx->set_password_callback(
 				[passphrase](std::size_t, ssl::context::password_purpose purpose)
@@ -6046,6 +6124,8 @@ namespace {
 	{
 		if (!m_ssl_ctx) return;
 
+		ssl::clear_session_cache(ssl::get_handle(*m_ssl_ctx));
+
 		boost::asio::const_buffer certificate_buf(certificate.c_str(), certificate.size());
 
 		error_code ec;
@@ -6152,6 +6232,12 @@ namespace {
 			TORRENT_ASSERT(p->associated_torrent().lock().get() == nullptr
 				|| p->associated_torrent().lock().get() == this);
 
+			if (m_availability)
+			{
+				if (p->is_seed()) m_availability->dec_all();
+				else m_availability->dec(p->get_bitfield());
+			}
+
 			if (has_picker())
 			{
 				if (p->is_seed())
@@ -6398,6 +6484,12 @@ namespace {
 			return;
 		}
 
+		// other torrents may already have as many connections open to this
+		// host as we allow. In that case we'll try again on the next tick.
+		// This is checked again once the hostname has been resolved, since
+		// other torrents may have connected in the meantime
+		if (web_seed_host_limit_reached(*web, hostname, port)) return;
+
 		if (!web->endpoints.empty())
 		{
 			connect_web_seed(web, web->endpoints.front());
@@ -6445,6 +6537,21 @@ namespace {
 		}
 	}
 
+	bool torrent::web_seed_host_limit_reached(web_seed_t const& web
+		, std::string const& host, int const port) const
+	{
+		int const host_limit = settings().get_int(settings_pack::max_web_seed_connections_per_host);
+		if (host_limit <= 0 || m_ses.num_web_seed_connections(host, port) < host_limit)
+			return false;
+#ifndef TORRENT_DISABLE_LOGGING
+		if (should_log())
+			debug_log("web seed host connection limit reached: %s", web.url.c_str());
+#else
+		TORRENT_UNUSED(web);
+#endif
+		return true;
+	}
+
 	void torrent::on_proxy_name_lookup(error_code const& e
 		, std::vector<address> const& addrs
 		, std::list<web_seed_t>::iterator web, int port) try
@@ -6664,11 +6771,12 @@ namespace {
 			boost::get<http_stream>(s).set_no_connect(true);
 		}
 
+		std::string protocol;
 		std::string hostname;
+		int port;
 		std::string path;
 		error_code ec;
-		using std::ignore;
-		std::tie(ignore, ignore, hostname, ignore, path)
+		std::tie(protocol, std::ignore, hostname, port, path)
 			= parse_url_components(web->url, ec);
 		if (ec)
 		{
@@ -6676,6 +6784,11 @@ namespace {
 				m_ses.alerts().emplace_alert<url_seed_alert>(get_handle(), web->url, ec);
 			return;
 		}
+		if (port == -1) port = protocol == "http" ? 80 : 443;
+
+		// the connection is counted against the host as soon as it's
+		// constructed below, which makes this check and the increment atomic
+		if (web_seed_host_limit_reached(*web, hostname, port)) return;
 
 		if (!settings().get_bool(settings_pack::allow_idna) && is_idna(hostname))
 		{
@@ -7103,59 +7216,7 @@ namespace {
 		}
 
 		// write local peers
-		std::vector<torrent_peer const*> deferred_peers;
-		if (m_peer_list)
-		{
-			for (auto p : *m_peer_list)
-			{
-#if TORRENT_USE_I2P
-				if (p->is_i2p_addr) continue;
-#endif
-				if (p->banned)
-				{
-					ret.banned_peers.push_back(p->ip());
-					continue;
-				}
-
-				// we cannot save remote connection
-				// since we don't know their listen port
-				// unless they gave us their listen port
-				// through the extension handshake
-				// so, if the peer is not connectable (i.e. we
-				// don't know its listen port) or if it has
-				// been banned, don't save it.
-				if (!p->connectable) continue;
-
-				// don't save peers that don't work
-				if (int(p->failcount) > 0) continue;
-
-				// don't save peers that appear to send corrupt data
-				if (int(p->trust_points) < 0) continue;
-
-				if (p->last_connected == 0)
-				{
-					// we haven't connected to this peer. It might still
-					// be useful to save it, but only save it if we
-					// don't have enough peers that we actually did connect to
-					if (int(deferred_peers.size()) < 100)
-						deferred_peers.push_back(p);
-					continue;
-				}
-
-				ret.peers.push_back(p->ip());
-			}
-		}
-
-		// if we didn't save 100 peers, fill in with second choice peers
-		if (int(ret.peers.size()) < 100)
-		{
-			aux::random_shuffle(deferred_peers);
-			for (auto const p : deferred_peers)
-			{
-				ret.peers.push_back(p->ip());
-				if (int(ret.peers.size()) >= 100) break;
-			}
-		}
+		collect_resume_peers(ret.peers, ret.banned_peers);
 
 		ret.upload_limit = upload_limit();
 		ret.download_limit = download_limit();
@@ -7775,6 +7836,8 @@ namespace {
 		m_torrent_file = info;
 		m_info_hash = m_torrent_file->info_hashes();
 
+		m_ses.cache_metadata(m_info_hash, metadata_buf);
+
 		m_size_on_disk = aux::size_on_disk(m_torrent_file->files());
 
 		m_ses.update_torrent_info_hash(shared_from_this(), old_ih);
@@ -8111,7 +8174,14 @@ namespace {
 
 	void torrent::update_want_tick()
 	{
-		update_list(aux::session_interface::torrent_want_tick, want_tick());
+		bool const want = want_tick();
+
+		// torrents that aren't ticked don't update their memory counters.
+		// Record the usage as it is when the torrent stops being ticked
+		if (!want && m_links[aux::session_interface::torrent_want_tick].in_list())
+			update_memory_counters();
+
+		update_list(aux::session_interface::torrent_want_tick, want);
 	}
 
 	// this function adjusts which lists this torrent is part of (checking,
@@ -8149,6 +8219,27 @@ namespace {
 			, is_seeding);
 		update_list(aux::session_interface::torrent_checking_auto_managed
 			, is_checking);
+		update_list(aux::session_interface::torrent_started_auto_managed
+			, (is_downloading || is_seeding) && !m_paused);
+
+		update_want_shed_peer_list();
+		update_seed_order();
+	}
+
+	void torrent::update_seed_order()
+	{
+		// the seeds that are started are ranked by the auto-manager on every
+		// pass, since their rank changes over time
+		bool const queued = m_paused && !m_abort
+			&& m_links[aux::session_interface::torrent_seeding_auto_managed].in_list();
+		int const rank = queued ? seed_rank(settings()) : -1;
+		if (rank == m_queued_seed_rank) return;
+
+		if (m_queued_seed_rank >= 0)
+			m_ses.erase_queued_seed(this, m_queued_seed_rank);
+		m_queued_seed_rank = rank;
+		if (m_queued_seed_rank >= 0)
+			m_ses.insert_queued_seed(this, m_queued_seed_rank);
 	}
 
 	// returns true if this torrent is interested in connecting to more peers
@@ -8202,6 +8293,174 @@ namespace {
 	{
 		update_list(aux::session_interface::torrent_want_peers_download, want_peers_download());
 		update_list(aux::session_interface::torrent_want_peers_finished, want_peers_finished());
+
+		// without scrape data, the seed rank is based on the peer list
+		update_seed_order();
+	}
+
+	void torrent::update_want_shed_peer_list()
+	{
+		bool const want = !m_peer_list_shed
+			&& !m_abort
+			&& is_paused()
+			&& m_auto_managed
+			&& valid_metadata()
+			&& is_finished()
+			&& settings().get_int(settings_pack::shed_peer_list_timeout) > 0;
+
+		if (want && !m_links[aux::session_interface::torrent_want_shed_peer_list].in_list())
+			m_shed_candidate_since = aux::time_now32();
+
+		update_list(aux::session_interface::torrent_want_shed_peer_list, want);
+	}
+
+	bool torrent::shed_idle_peer_list()
+	{
+		TORRENT_ASSERT(is_single_thread());
+		TORRENT_ASSERT(!m_peer_list_shed);
+
+		if (!m_connections.empty())
+		{
+			// peers are still being disconnected, try again later
+			m_shed_candidate_since = aux::time_now32();
+			return false;
+		}
+
+		std::vector<tcp::endpoint> peers;
+		std::vector<tcp::endpoint> banned;
+		collect_resume_peers(peers, banned);
+
+		m_shed_peers.clear();
+		auto out = std::back_inserter(m_shed_peers);
+		auto const pack = [&](tcp::endpoint const& ep, std::uint8_t flags)
+		{
+			if (aux::is_v6(ep)) flags |= shed_peer_v6;
+			m_shed_peers.push_back(char(flags));
+			aux::write_endpoint(ep, out);
+		};
+		for (auto const& ep : peers) pack(ep, 0);
+		for (auto const& ep : banned) pack(ep, shed_peer_banned);
+		m_shed_peers.shrink_to_fit();
+
+		if (m_peer_list)
+		{
+			std::vector<torrent_peer*> const erased(m_peer_list->begin(), m_peer_list->end());
+			peers_erased(erased);
+			m_peer_list.reset();
+		}
+
+		m_peer_list_shed = true;
+
+#ifndef TORRENT_DISABLE_LOGGING
+		debug_log("shedding peer list (kept %d peers, %d banned)"
+			, int(peers.size()), int(banned.size()));
+#endif
+
+		update_want_shed_peer_list();
+		update_want_peers();
+		update_memory_counters();
+		state_updated();
+		return true;
+	}
+
+	void torrent::restore_peer_list()
+	{
+		TORRENT_ASSERT(is_single_thread());
+		if (!m_peer_list_shed) return;
+
+		m_peer_list_shed = false;
+		std::vector<char> const packed = std::move(m_shed_peers);
+		m_shed_peers.clear();
+
+		need_peer_list();
+		int num_peers = 0;
+		for_each_shed_peer(packed
+			, [&](tcp::endpoint const& ep, std::uint8_t const flags)
+			{
+				torrent_peer* const p = add_peer(ep, peer_info::resume_data);
+				if (p == nullptr) return;
+				if (flags & shed_peer_banned) ban_peer(p);
+				++num_peers;
+			});
+
+#ifndef TORRENT_DISABLE_LOGGING
+		debug_log("restoring peer list (%d peers)", num_peers);
+#else
+		TORRENT_UNUSED(num_peers);
+#endif
+
+		update_want_shed_peer_list();
+		update_want_peers();
+		update_memory_counters();
+		state_updated();
+	}
+
+	// the peers worth saving in the resume data. These are also the peers
+	// kept while the peer list is shed
+	void torrent::collect_resume_peers(std::vector<tcp::endpoint>& peers
+		, std::vector<tcp::endpoint>& banned) const
+	{
+		if (m_peer_list_shed)
+		{
+			for_each_shed_peer(m_shed_peers
+				, [&](tcp::endpoint const& ep, std::uint8_t const flags)
+				{ ((flags & shed_peer_banned) ? banned : peers).push_back(ep); });
+			return;
+		}
+
+		std::vector<torrent_peer const*> deferred_peers;
+		if (m_peer_list)
+		{
+			for (auto p : *m_peer_list)
+			{
+#if TORRENT_USE_I2P
+				if (p->is_i2p_addr) continue;
+#endif
+				if (p->banned)
+				{
+					banned.push_back(p->ip());
+					continue;
+				}
+
+				// we cannot save remote connection
+				// since we don't know their listen port
+				// unless they gave us their listen port
+				// through the extension handshake
+				// so, if the peer is not connectable (i.e. we
+				// don't know its listen port) or if it has
+				// been banned, don't save it.
+				if (!p->connectable) continue;
+
+				// don't save peers that don't work
+				if (int(p->failcount) > 0) continue;
+
+				// don't save peers that appear to send corrupt data
+				if (int(p->trust_points) < 0) continue;
+
+				if (p->last_connected == 0)
+				{
+					// we haven't connected to this peer. It might still
+					// be useful to save it, but only save it if we
+					// don't have enough peers that we actually did connect to
+					if (int(deferred_peers.size()) < 100)
+						deferred_peers.push_back(p);
+					continue;
+				}
+
+				peers.push_back(p->ip());
+			}
+		}
+
+		// if we didn't save 100 peers, fill in with second choice peers
+		if (int(peers.size()) < 100)
+		{
+			aux::random_shuffle(deferred_peers);
+			for (auto const p : deferred_peers)
+			{
+				peers.push_back(p->ip());
+				if (int(peers.size()) >= 100) break;
+			}
+		}
 	}
 
 	void torrent::update_want_scrape()
@@ -8226,6 +8485,9 @@ namespace {
 			TORRENT_LIST_NAME(torrent_downloading_auto_managed);
 			TORRENT_LIST_NAME(torrent_seeding_auto_managed);
 			TORRENT_LIST_NAME(torrent_checking_auto_managed);
+			TORRENT_LIST_NAME(torrent_snapshot_updates);
+			TORRENT_LIST_NAME(torrent_want_shed_peer_list);
+			TORRENT_LIST_NAME(torrent_started_auto_managed);
 			default: TORRENT_ASSERT_FAIL_VAL(idx);
 		}
 #undef TORRENT_LIST_NAME
@@ -8789,8 +9051,8 @@ namespace {
 		TORRENT_ASSERT(current_stats_state() == int(m_current_gauge_state + counters::num_checking_torrents)
 			|| m_current_gauge_state == no_gauge_state);
 
-		TORRENT_ASSERT(m_sequence_number == no_pos
-			|| m_ses.verify_queue_position(this, m_sequence_number));
+		TORRENT_ASSERT(queue_position() == no_pos
+			|| m_ses.verify_queue_position(this, queue_position()));
 
 #ifndef TORRENT_DISABLE_STREAMING
 		for (auto const& i : m_time_critical_pieces)
@@ -9076,7 +9338,7 @@ namespace {
 			|| (!m_auto_managed && p == no_pos)
 			|| (m_abort && p == no_pos)
 			|| (!m_added && p == no_pos));
-		if (p == m_sequence_number) return;
+		if (p == queue_position()) return;
 
 		TORRENT_ASSERT(p >= no_pos);
 
@@ -9747,6 +10009,7 @@ namespace {
 		bool const paused_before = is_paused();
 
 		m_paused = b;
+		update_state_list();
 
 		// the session may still be paused, in which case
 		// the effective state of the torrent did not change
@@ -9782,6 +10045,7 @@ namespace {
 	void torrent::do_resume()
 	{
 		TORRENT_ASSERT(is_single_thread());
+		update_state_list();
 		if (is_paused())
 		{
 			update_want_tick();
@@ -9795,6 +10059,8 @@ namespace {
 		}
 #endif
 
+		restore_peer_list();
+
 		if (alerts().should_post<torrent_resumed_alert>())
 			alerts().emplace_alert<torrent_resumed_alert>(get_handle());
 
@@ -10257,6 +10523,8 @@ namespace {
 		if (m_stat.low_pass_upload_rate() > 0 || m_stat.low_pass_download_rate() > 0)
 			state_updated();
 
+		update_memory_counters();
+
 		// this section determines whether the torrent is active or not. When it
 		// changes state, it may also trigger the auto-manage logic to reconsider
 		// which torrents should be queued and started. There is a low pass
@@ -10438,41 +10706,31 @@ namespace {
 		// one more important property is that there are enough pieces
 		// that more than one peer wants to download
 		// make sure that there are enough downloaders for the rarest
-		// piece. Go through all pieces, figure out which one is the rarest
-		// and how many peers that has that piece
+		// piece. Find the rarest piece we don't have and how many peers
+		// have it
 
-		aux::vector<piece_index_t> rarest_pieces;
+		need_availability();
 
-		int const num_pieces = m_torrent_file->num_pieces();
-		int rarest_rarity = INT_MAX;
-		for (piece_index_t i(0); i < piece_index_t(num_pieces); ++i)
-		{
-			piece_picker::piece_stats_t ps = m_picker->piece_stats(i);
-			if (ps.peer_count == 0) continue;
-			if (ps.priority == 0 && (ps.have || ps.downloading))
+		// pieces we already have or are trying to download are skipped
+		piece_index_t const pick = m_availability->pick_rarest(1, random(0xffffffff)
+			, [&](piece_index_t const i)
 			{
-				m_picker->set_piece_priority(i, default_priority);
-				continue;
-			}
-			// don't count pieces we already have or are trying to download
-			if (ps.priority > 0 || ps.have) continue;
-			if (ps.peer_count > rarest_rarity) continue;
-			if (ps.peer_count == rarest_rarity)
-			{
-				rarest_pieces.push_back(i);
-				continue;
-			}
-
-			rarest_pieces.clear();
-			rarest_rarity = ps.peer_count;
-			rarest_pieces.push_back(i);
-		}
+				piece_picker::piece_stats_t const ps = m_picker->piece_stats(i);
+				if (ps.priority == 0 && (ps.have || ps.downloading))
+				{
+					m_picker->set_piece_priority(i, default_priority);
+					return false;
+				}
+				return ps.priority <= 0 && !ps.have;
+			});
 
 		update_gauge();
 		update_want_peers();
 
-		// now, rarest_pieces is a list of all pieces that are the rarest ones.
-		// and rarest_rarity is the number of peers that have the rarest pieces
+		if (pick == piece_index_t(-1)) return;
+
+		// the number of peers that have the rarest piece
+		int const rarest_rarity = m_picker->piece_stats(pick).peer_count;
 
 		// if there's only a single peer that doesn't have the rarest piece
 		// it's impossible for us to download one piece and upload it
@@ -10481,10 +10739,9 @@ namespace {
 			< settings().get_int(settings_pack::share_mode_target))
 			return;
 
-		// now, pick one of the rarest pieces to download
-		int const pick = int(random(aux::numeric_cast<std::uint32_t>(rarest_pieces.end_index() - 1)));
+		// now, download the rarest piece
 		bool const was_finished = is_finished();
-		m_picker->set_piece_priority(rarest_pieces[pick], default_priority);
+		m_picker->set_piece_priority(pick, default_priority);
 		update_gauge();
 		update_peer_interest(was_finished);
 		update_want_peers();
@@ -11288,6 +11545,12 @@ namespace {
 		return m_peer_list->find_peers(a);
 	}
 
+	bool torrent::is_web_seed_peer(torrent_peer const* p) const
+	{
+		return std::any_of(m_web_seeds.begin(), m_web_seeds.end()
+			, [p](web_seed_t const& ws) { return &ws.peer_info == p; });
+	}
+
 	void torrent::update_peer_port(int const port, torrent_peer* p
 		, peer_source_flags_t const src)
 	{
@@ -11706,6 +11969,15 @@ namespace {
 		// is building the status update alert
 		TORRENT_ASSERT(!m_ses.is_posting_torrent_updates());
 
+		// if someone is reading status snapshots of this torrent, make sure
+		// it's re-published on the next tick
+		if (m_snapshot_subscription.load(std::memory_order_relaxed)
+			&& !m_links[aux::session_interface::torrent_snapshot_updates].in_list())
+		{
+			m_links[aux::session_interface::torrent_snapshot_updates].insert(
+				m_ses.torrent_list(aux::session_interface::torrent_snapshot_updates), this);
+		}
+
 		// we're not subscribing to this torrent, don't add it
 		if (!m_state_subscription) return;
 
@@ -11728,6 +12000,108 @@ namespace {
 		m_links[aux::session_interface::torrent_state_updates].insert(list, this);
 	}
 
+	std::shared_ptr<torrent_status const> torrent::status_snapshot() const
+	{
+		std::lock_guard<std::mutex> l(m_snapshot_mutex);
+		return m_status_snapshot;
+	}
+
+	void torrent::publish_status_snapshot()
+	{
+		TORRENT_ASSERT(is_single_thread());
+
+		m_snapshot_subscription.store(true, std::memory_order_relaxed);
+
+		// snapshots are re-published for every changed torrent on each tick,
+		// leave out the fields that walk the download queue or the file list
+		static constexpr status_flags_t snapshot_flags = status_flags_t::all()
+			& ~torrent_handle::query_accurate_download_counters
+			& ~torrent_handle::query_memory_usage;
+
+		auto st = std::make_shared<torrent_status>();
+		status(st.get(), snapshot_flags);
+
+		std::shared_ptr<torrent_status const> old;
+		{
+			std::lock_guard<std::mutex> l(m_snapshot_mutex);
+			old = std::move(m_status_snapshot);
+			m_status_snapshot = std::move(st);
+		}
+		// the previous snapshot (if no client is holding on to it) is
+		// destructed here, outside of the mutex
+	}
+
+	torrent_memory_usage torrent::memory_usage()
+	{
+		TORRENT_ASSERT(is_single_thread());
+
+		torrent_memory_usage ret;
+
+		if (m_torrent_file.get() != m_memory_ti)
+		{
+			m_memory_ti = m_torrent_file.get();
+			m_memory_ti_size = m_torrent_file ? m_torrent_file->memory_usage() : 0;
+		}
+		ret.metadata = m_memory_ti_size;
+
+		if (m_picker) ret.piece_picker = m_picker->memory_usage();
+		if (m_peer_list) ret.peer_list = m_peer_list->memory_usage();
+		ret.peer_list += std::int64_t(m_shed_peers.capacity());
+
+		for (auto const& t : m_merkle_trees)
+			ret.hash_trees += t.memory_usage();
+		ret.hash_trees += std::int64_t(m_merkle_trees.capacity() * sizeof(aux::merkle_tree));
+		if (m_hash_picker) ret.hash_trees += m_hash_picker->memory_usage();
+
+#ifndef TORRENT_DISABLE_EXTENSIONS
+		for (auto const& ext : m_extensions)
+			ret.extensions += ext->memory_usage();
+#endif
+		return ret;
+	}
+
+	void torrent::update_memory_counters()
+	{
+		torrent_memory_usage const cur = m_abort ? torrent_memory_usage{} : memory_usage();
+		counters& cnt = m_ses.stats_counters();
+		cnt.inc_stats_counter(counters::torrent_memory_metadata
+			, cur.metadata - m_memory_accounted.metadata);
+		cnt.inc_stats_counter(counters::torrent_memory_piece_picker
+			, cur.piece_picker - m_memory_accounted.piece_picker);
+		cnt.inc_stats_counter(counters::torrent_memory_peer_list
+			, cur.peer_list - m_memory_accounted.peer_list);
+		cnt.inc_stats_counter(counters::torrent_memory_hash_trees
+			, cur.hash_trees - m_memory_accounted.hash_trees);
+		cnt.inc_stats_counter(counters::torrent_memory_extensions
+			, cur.extensions - m_memory_accounted.extensions);
+		m_memory_accounted = cur;
+	}
+
+	std::int64_t torrent::shed_peer_list()
+	{
+		TORRENT_ASSERT(is_single_thread());
+		if (!m_peer_list || m_abort) return 0;
+
+		int const known = m_peer_list->num_peers();
+		int const connected = int(m_connections.size());
+		int const target = is_paused() ? 0 : connected + (known - connected) / 2;
+		if (known <= target) return 0;
+
+		std::int64_t const before = m_memory_accounted.peer_list;
+		torrent_state st = get_peer_list_state();
+		int const erased = m_peer_list->shed_peers(target, &st);
+		peers_erased(st.erased);
+
+#ifndef TORRENT_DISABLE_LOGGING
+		if (erased > 0)
+			debug_log("shed %d peers from peer list (memory budget exceeded)", erased);
+#endif
+		if (erased == 0) return 0;
+
+		update_memory_counters();
+		return before - m_memory_accounted.peer_list;
+	}
+
 	void torrent::post_status(status_flags_t const flags)
 	{
 		std::vector<torrent_status> s;
@@ -11757,6 +12131,16 @@ namespace {
 		if (flags & torrent_handle::query_save_path)
 			st->save_path = save_path();
 
+		if (flags & torrent_handle::query_memory_usage)
+		{
+			torrent_memory_usage const mem = memory_usage();
+			st->memory_metadata = mem.metadata;
+			st->memory_piece_picker = mem.piece_picker;
+			st->memory_peer_list = mem.peer_list;
+			st->memory_hash_trees = mem.hash_trees;
+			st->memory_extensions = mem.extensions;
+		}
+
 		if (flags & torrent_handle::query_torrent_file)
 			st->torrent_file = m_torrent_file;
 
@@ -11770,6 +12154,7 @@ namespace {
 		st->seed_mode = m_seed_mode;
 #endif
 		st->moving_storage = m_moving_storage;
+		st->peer_list_shed = m_peer_list_shed;
 
 		st->announcing_to_trackers = m_announce_to_trackers;
 		st->announcing_to_lsd = m_announce_to_lsd;
@@ -90,6 +90,7 @@ namespace libtorrent {
 	constexpr status_flags_t torrent_handle::query_torrent_file;
 	constexpr status_flags_t torrent_handle::query_name;
 	constexpr status_flags_t torrent_handle::query_save_path;
+	constexpr status_flags_t torrent_handle::query_memory_usage;
 
 	void block_info::set_peer(tcp::endpoint const& ep)
 	{
@@ -212,6 +213,24 @@ namespace libtorrent {
 		return r;
 	}
 
+	// calls f(torrent&) on the network thread and passes the result to
+	// handler, also on the network thread
+	template<typename Ret, typename Fun>
+	void torrent_handle::async_call_handler(
+		std::function<void(error_code const&, Ret)> handler, Fun f) const
+	{
+		aux::completion_handler<Ret> h(std::move(handler));
+		std::shared_ptr<torrent> t = m_torrent.lock();
+		if (!t)
+		{
+			h.complete(errors::invalid_torrent_handle, Ret{});
+			return;
+		}
+		auto& ses = static_cast<session_impl&>(t->session());
+		dispatch(ses.get_context(), [t, f, h = std::move(h)] () mutable
+		{ h.call([&] { return f(*t); }); });
+	}
+
 	sha1_hash torrent_handle::info_hash() const
 	{
 		std::shared_ptr<torrent> t = m_torrent.lock();
@@ -504,6 +523,96 @@ namespace libtorrent {
 		async_call(&torrent::post_status, flags);
 	}
 
+	std::shared_ptr<torrent_status const> torrent_handle::status_snapshot() const
+	{
+		std::shared_ptr<torrent> t = m_torrent.lock();
+#ifndef BOOST_NO_EXCEPTIONS
+		if (!t) throw_invalid_handle();
+#else
+		if (!t) return {};
+#endif
+		auto ret = t->status_snapshot();
+		if (ret) return ret;
+
+		// this is the first snapshot requested for this torrent. Publishing
+		// it also subscribes the torrent to snapshot updates
+		sync_call(&torrent::publish_status_snapshot);
+		return t->status_snapshot();
+	}
+
+	void torrent_handle::async_status(status_flags_t const flags
+		, std::function<void(error_code const&, torrent_status)> handler) const
+	{
+		async_call_handler(std::move(handler), [flags](torrent& t)
+		{
+			torrent_status st;
+			t.status(&st, flags);
+			return st;
+		});
+	}
+
+	void torrent_handle::async_get_peer_info(
+		std::function<void(error_code const&, std::vector<peer_info>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](torrent& t)
+		{
+			std::vector<peer_info> v;
+			t.get_peer_info(&v);
+			return v;
+		});
+	}
+
+	void torrent_handle::async_get_download_queue(
+		std::function<void(error_code const&, std::vector<partial_piece_info>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](torrent& t)
+		{
+			std::vector<partial_piece_info> queue;
+			t.get_download_queue(&queue);
+			return queue;
+		});
+	}
+
+	void torrent_handle::async_file_progress(file_progress_flags_t const flags
+		, std::function<void(error_code const&, std::vector<std::int64_t>)> handler) const
+	{
+		async_call_handler(std::move(handler), [flags](torrent& t)
+		{
+			aux::vector<std::int64_t, file_index_t> fp;
+			t.file_progress(fp, flags);
+			return std::vector<std::int64_t>(std::move(fp));
+		});
+	}
+
+	void torrent_handle::async_get_piece_priorities(
+		std::function<void(error_code const&, std::vector<download_priority_t>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](torrent& t)
+		{
+			aux::vector<download_priority_t, piece_index_t> ret;
+			t.piece_priorities(&ret);
+			return std::vector<download_priority_t>(std::move(ret));
+		});
+	}
+
+	void torrent_handle::async_get_file_priorities(
+		std::function<void(error_code const&, std::vector<download_priority_t>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](torrent& t)
+		{
+			aux::vector<download_priority_t, file_index_t> ret;
+			t.file_priorities(&ret);
+			return std::vector<download_priority_t>(std::move(ret));
+		});
+	}
+
+	void torrent_handle::async_trackers(
+		std::function<void(error_code const&, std::vector<announce_entry>)> handler) const
+	{
+		async_call_handler(std::move(handler), [](torrent& t)
+		{ return t.trackers(); });
+	}
+
 	void torrent_handle::post_piece_availability() const
 	{
 		async_call(&torrent::post_piece_availability);
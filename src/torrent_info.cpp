@@ -1077,18 +1077,12 @@ namespace {
 	{
 		if (!(m_flags & ssl_torrent)) return "";
 
-		// this is parsed lazily
-		if (!m_info_dict)
-		{
-			error_code ec;
-			bdecode(m_info_section.get(), m_info_section.get()
-				+ m_info_section_size, m_info_dict, ec);
-			TORRENT_ASSERT(!ec);
-			if (ec) return "";
-		}
-		TORRENT_ASSERT(m_info_dict.type() == bdecode_node::dict_t);
-		if (m_info_dict.type() != bdecode_node::dict_t) return "";
-		return m_info_dict.dict_find_string_value("ssl-cert");
+		// the info-dictionary may have millions of tokens, there's no need to
+		// decode all of them just to find the certificate
+		bdecode_node const cert = info("ssl-cert");
+		if (cert.type() != bdecode_node::string_t) return "";
+		// the string points into m_info_section, it outlives the node
+		return cert.string_value();
 	}
 
 #if TORRENT_ABI_VERSION < 3
@@ -1522,16 +1516,41 @@ namespace {
 	void torrent_info::internal_set_comment(string_view const s)
 	{ m_comment = std::string(s); }
 
+	std::int64_t torrent_info::memory_usage() const
+	{
+		std::int64_t ret = sizeof(*this);
+		ret += m_files.memory_usage();
+		if (m_orig_files) ret += std::int64_t(sizeof(file_storage)) + m_orig_files->memory_usage();
+		ret += m_info_section_size;
+		for (auto const& l : m_piece_layers) ret += std::int64_t(l.capacity());
+		ret += std::int64_t(m_piece_layers.capacity() * sizeof(aux::vector<char>));
+		ret += std::int64_t(m_urls.capacity() * sizeof(announce_entry));
+		for (auto const& ae : m_urls) ret += std::int64_t(ae.url.capacity());
+		ret += std::int64_t(m_web_seeds.capacity() * sizeof(web_seed_entry));
+		for (auto const& ws : m_web_seeds) ret += std::int64_t(ws.url.capacity());
+		ret += std::int64_t(m_nodes.capacity() * sizeof(m_nodes[0]));
+		ret += std::int64_t(m_similar_torrents.capacity() * sizeof(std::int32_t));
+		ret += std::int64_t(m_owned_similar_torrents.capacity() * sizeof(sha1_hash));
+		ret += std::int64_t(m_collections.capacity() * sizeof(m_collections[0]));
+		ret += std::int64_t(m_owned_collections.capacity() * sizeof(std::string));
+#if TORRENT_ABI_VERSION <= 2
+		ret += std::int64_t(m_merkle_tree.capacity() * sizeof(sha1_hash));
+#endif
+		ret += std::int64_t(m_comment.capacity() + m_created_by.capacity());
+		return ret;
+	}
+
 	bdecode_node torrent_info::info(char const* key) const
 	{
-		if (m_info_dict.type() == bdecode_node::none_t)
-		{
-			error_code ec;
-			bdecode(m_info_section.get(), m_info_section.get()
-				+ m_info_section_size, m_info_dict, ec);
-			if (ec) return bdecode_node();
-		}
-		return m_info_dict.dict_find(key);
+		// only the value of the key is decoded, the rest of the
+		// info-dictionary is just skipped
+		error_code ec;
+		span<char const> const value = bdecode_find_key(
+			{m_info_section.get(), m_info_section_size}, key, ec);
+		if (ec || value.empty()) return bdecode_node();
+		bdecode_node ret = bdecode(value, ec);
+		if (ec) return bdecode_node();
+		return ret;
 	}
 
 	bool torrent_info::parse_torrent_file(bdecode_node const& torrent_file
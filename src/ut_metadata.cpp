@@ -48,6 +48,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/bt_peer_connection.hpp"
 #include "libtorrent/peer_connection_handle.hpp"
 #include "libtorrent/bencode.hpp"
+#include "libtorrent/aux_/bencode_writer.hpp"
 #include "libtorrent/torrent.hpp"
 #include "libtorrent/torrent_handle.hpp"
 #include "libtorrent/extensions.hpp"
@@ -82,6 +83,19 @@ namespace {
 		// we may hit this case (and the client requesting
 		// doesn't throttle its requests)
 		max_incoming_requests = 1024,
+
+		// the max number of metadata requests we keep outstanding to a
+		// single peer. Different peers are asked for different pieces, so
+		// the metadata is downloaded from several peers in parallel
+		max_outstanding_requests = 4,
+
+		// if a request hasn't been answered within this many seconds, the
+		// same piece may be requested from another peer as well
+		hedge_request_timeout = 3,
+
+		// requests that haven't been answered within this many seconds are
+		// given up on, freeing up the slot to request something else
+		request_timeout = 20,
 	};
 
 	enum class msg_t : std::uint8_t
@@ -96,6 +110,23 @@ namespace {
 
 	struct ut_metadata_peer_plugin;
 
+	// a slice of the info-section owned by a torrent_info. It holds a
+	// reference to the torrent_info, to keep the buffer alive for as long as
+	// the slice sits in a peer's send buffer. This lets every peer send
+	// metadata from the single copy of the info-dictionary, without copying
+	// it (unless the connection is encrypted)
+	struct metadata_holder
+	{
+		metadata_holder(std::shared_ptr<torrent_info const> ti, span<char const> buf)
+			: m_ti(std::move(ti)), m_buf(buf.data()), m_size(int(buf.size())) {}
+		char* data() const { return const_cast<char*>(m_buf); }
+		int size() const { return m_size; }
+	private:
+		std::shared_ptr<torrent_info const> m_ti;
+		char const* m_buf;
+		int m_size;
+	};
+
 	struct ut_metadata_plugin final
 		: torrent_plugin
 	{
@@ -104,9 +135,11 @@ namespace {
 		std::shared_ptr<peer_plugin> new_connection(
 			peer_connection_handle const& pc) override;
 
+		// once we have the metadata, it's always served straight out of the
+		// torrent_info's info-section buffer. m_metadata is only used while
+		// downloading it
 		span<char const> metadata() const
 		{
-			if (!m_metadata.empty()) return m_metadata;
 			if (!m_torrent.valid_metadata()) return {};
 
 			auto const ret = m_torrent.torrent_file().info_section();
@@ -131,17 +164,14 @@ namespace {
 			, span<char const> buf, int piece, int total_size);
 
 		// returns a piece of the metadata that
-		// we should request.
+		// we should request. ``outstanding`` are the pieces already
+		// requested from this peer, which won't be picked again.
 		// returns -1 if we should hold off the request
-		int metadata_request(bool has_metadata);
+		int metadata_request(bool has_metadata, std::vector<int> const& outstanding);
 
-		void on_piece_pass(piece_index_t) override
-		{
-			// if we became a seed, copy the metadata from
-			// the torrent before it is deallocated
-			if (m_torrent.is_seed())
-				metadata();
-		}
+		// the request for ``piece`` was rejected or timed out. Let other
+		// peers request it right away
+		void cancel_request(int piece);
 
 		void metadata_size(int const size)
 		{
@@ -160,7 +190,7 @@ namespace {
 		// this buffer is filled with the info-section of
 		// the metadata file while downloading it from
 		// peers. Once we have metadata, we seed it directly from the
-		// torrent_info of the underlying torrent
+		// torrent_info of the underlying torrent (see metadata_holder)
 		aux::vector<char> m_metadata;
 
 		struct metadata_piece
@@ -240,16 +270,9 @@ namespace {
 			// abort if the peer doesn't support the metadata extension
 			if (m_message_index == 0) return;
 
-			entry e;
-			e["msg_type"] = static_cast<int>(type);
-			e["piece"] = piece;
-
 			char const* metadata = nullptr;
 			int metadata_piece_size = 0;
 
-			if (m_torrent.valid_metadata())
-				e["total_size"] = m_tp.metadata().size();
-
 			if (type == msg_t::piece)
 			{
 				TORRENT_ASSERT(piece >= 0 && piece < (m_tp.metadata().size() + 16 * 1024 - 1) / (16 * 1024));
@@ -265,12 +288,21 @@ namespace {
 				TORRENT_ASSERT(offset + metadata_piece_size <= m_tp.metadata().size());
 			}
 
-			// TODO: 3 use the aux::write_* functions and the span here instead, it
-			// will fit better with send_buffer()
 			char msg[200];
 			char* header = msg;
-			char* p = &msg[6];
-			int const len = bencode(p, e);
+			auto w = aux::make_bencode_writer(&msg[6]);
+			w.begin_dict();
+			w.key("msg_type");
+			w.int_value(static_cast<int>(type));
+			w.key("piece");
+			w.int_value(piece);
+			if (m_torrent.valid_metadata())
+			{
+				w.key("total_size");
+				w.int_value(m_tp.metadata().size());
+			}
+			w.end();
+			int const len = w.size();
 			int const total_size = 2 + len + metadata_piece_size;
 			namespace io = aux;
 			io::write_uint32(total_size, header);
@@ -278,12 +310,14 @@ namespace {
 			io::write_uint8(m_message_index, header);
 
 			m_pc.send_buffer({msg, len + 6});
-			// TODO: we really need to increment the refcounter on the torrent
-			// while this buffer is still in the peer's send buffer
 			if (metadata_piece_size)
 			{
-				m_pc.append_const_send_buffer(
-					span<char>(const_cast<char*>(metadata), metadata_piece_size), metadata_piece_size);
+				auto ti = m_torrent.get_torrent_file();
+				TORRENT_ASSERT(ti);
+				TORRENT_ASSERT(ti->info_section().data() <= metadata);
+				m_pc.append_const_send_buffer(metadata_holder(std::move(ti)
+					, {metadata, metadata_piece_size}), metadata_piece_size);
+				m_pc.setup_send();
 			}
 
 			m_pc.stats_counters().inc_stats_counter(counters::num_outgoing_extended);
@@ -369,8 +403,7 @@ namespace {
 				break;
 				case msg_t::piece:
 				{
-					auto const i = std::find(m_sent_requests.begin()
-						, m_sent_requests.end(), piece);
+					auto const i = find_request(piece);
 
 					// unwanted piece?
 					if (i == m_sent_requests.end())
@@ -392,11 +425,11 @@ namespace {
 				case msg_t::dont_have:
 				{
 					m_request_limit = std::max(aux::time_now() + minutes(1), m_request_limit);
-					auto const i = std::find(m_sent_requests.begin()
-						, m_sent_requests.end(), piece);
+					auto const i = find_request(piece);
 					// unwanted piece?
 					if (i == m_sent_requests.end()) return true;
 					m_sent_requests.erase(i);
+					m_tp.cancel_request(piece);
 				}
 				break;
 			}
@@ -406,8 +439,33 @@ namespace {
 			return true;
 		}
 
+		void on_disconnect(error_code const&) override
+		{
+			// let other peers pick up what we requested from this one
+			for (auto const& r : m_sent_requests)
+				m_tp.cancel_request(r.piece);
+			m_sent_requests.clear();
+		}
+
 		void tick() override
 		{
+			// give up on requests the peer is sitting on
+			time_point const now = aux::time_now();
+			for (auto i = m_sent_requests.begin(); i != m_sent_requests.end();)
+			{
+				if (now - i->sent < seconds(request_timeout))
+				{
+					++i;
+					continue;
+				}
+#ifndef TORRENT_DISABLE_LOGGING
+				m_pc.peer_log(peer_log_alert::info, "UT_METADATA"
+					, "request timed out, piece: %d", i->piece);
+#endif
+				m_tp.cancel_request(i->piece);
+				i = m_sent_requests.erase(i);
+			}
+
 			maybe_send_request();
 			while (!m_incoming_requests.empty()
 				&& m_pc.send_buffer_size() < send_buffer_limit)
@@ -426,15 +484,20 @@ namespace {
 			// supports the request metadata extension
 			// and we aren't currently waiting for a request
 			// reply. Then, send a request for some metadata.
-			if (!m_torrent.valid_metadata()
-				&& m_message_index != 0
-				&& m_sent_requests.size() < 2
-				&& has_metadata())
+			if (m_torrent.valid_metadata()
+				|| m_message_index == 0
+				|| !has_metadata())
+				return;
+
+			std::vector<int> outstanding;
+			while (int(m_sent_requests.size()) < max_outstanding_requests)
 			{
-				int const piece = m_tp.metadata_request(m_pc.has_metadata());
+				outstanding.clear();
+				for (auto const& r : m_sent_requests) outstanding.push_back(r.piece);
+				int const piece = m_tp.metadata_request(m_pc.has_metadata(), outstanding);
 				if (piece == -1) return;
 
-				m_sent_requests.push_back(piece);
+				m_sent_requests.push_back({piece, aux::time_now()});
 				write_metadata_packet(msg_t::request, piece);
 			}
 		}
@@ -464,8 +527,20 @@ namespace {
 		// we receive metadata that fails the info hash check
 		time_point m_request_limit;
 
+		struct sent_request
+		{
+			int piece;
+			time_point sent;
+		};
+
+		std::vector<sent_request>::iterator find_request(int const piece)
+		{
+			return std::find_if(m_sent_requests.begin(), m_sent_requests.end()
+				, [piece](sent_request const& r) { return r.piece == piece; });
+		}
+
 		// request queues
-		std::vector<int> m_sent_requests;
+		std::vector<sent_request> m_sent_requests;
 		std::vector<int> m_incoming_requests;
 
 		torrent& m_torrent;
@@ -485,30 +560,49 @@ namespace {
 	// has_metadata is false if the peer making the request has not announced
 	// that it has metadata. In this case, it shouldn't prevent other peers
 	// from requesting this block by setting a timeout on it.
-	int ut_metadata_plugin::metadata_request(bool const has_metadata)
+	//
+	// pieces are handed out to peers in order of how many outstanding
+	// requests they have, so that different peers download different
+	// pieces in parallel. A piece that's already requested is only handed
+	// out again once the earlier request has gone unanswered for
+	// hedge_request_timeout seconds, to not be held up by slow peers.
+	int ut_metadata_plugin::metadata_request(bool const has_metadata
+		, std::vector<int> const& outstanding)
 	{
-		auto i = std::min_element(
-			m_requested_metadata.begin(), m_requested_metadata.end());
-
 		if (m_requested_metadata.empty())
 		{
 			// if we don't know how many pieces there are
 			// just ask for piece 0
 			m_requested_metadata.resize(1);
-			i = m_requested_metadata.begin();
 		}
 
-		int const piece = int(i - m_requested_metadata.begin());
-
-		// don't request the same block more than once every 3 seconds
-		// unless the source is disconnected
-		auto source = m_requested_metadata[piece].source.lock();
 		time_point const now = aux::time_now();
-		if (m_requested_metadata[piece].last_request != min_time()
-			&& source
-			&& !source->m_pc.is_disconnecting()
-			&& total_seconds(now - m_requested_metadata[piece].last_request) < 3)
-			return -1;
+		int piece = -1;
+		for (int i = 0; i < int(m_requested_metadata.size()); ++i)
+		{
+			metadata_piece const& mp = m_requested_metadata[i];
+
+			// we already have this piece
+			if (mp.num_requests == std::numeric_limits<int>::max()) continue;
+
+			if (piece != -1 && m_requested_metadata[piece].num_requests <= mp.num_requests)
+				continue;
+
+			// we already asked this peer for it
+			if (std::find(outstanding.begin(), outstanding.end(), i) != outstanding.end())
+				continue;
+
+			// don't request the same block more than once every few seconds.
+			// If the peer we requested it from disconnects, rejects the request
+			// or times out, last_request is reset by cancel_request()
+			if (mp.num_requests > 0
+				&& now - mp.last_request < seconds(hedge_request_timeout))
+				continue;
+
+			piece = i;
+		}
+
+		if (piece == -1) return -1;
 
 		++m_requested_metadata[piece].num_requests;
 
@@ -521,6 +615,15 @@ namespace {
 		return piece;
 	}
 
+	void ut_metadata_plugin::cancel_request(int const piece)
+	{
+		if (piece < 0 || piece >= int(m_requested_metadata.size())) return;
+		metadata_piece& mp = m_requested_metadata[piece];
+		if (mp.num_requests == std::numeric_limits<int>::max()) return;
+		if (mp.num_requests > 0) --mp.num_requests;
+		mp.last_request = min_time();
+	}
+
 	bool ut_metadata_plugin::received_metadata(ut_metadata_peer_plugin& source
 		, span<char const> buf, int const piece, int const total_size)
 	{
@@ -565,13 +668,13 @@ namespace {
 #ifndef TORRENT_DISABLE_LOGGING
 			source.m_pc.peer_log(peer_log_alert::info, "UT_METADATA"
 				, "total_size: %d INCONSISTENT WITH: %d"
-				, total_size, int(metadata().size()));
+				, total_size, static_cast<int>(m_metadata.end_index()));
 #endif
 			// they disagree about the size!
 			return false;
 		}
 
-		if (piece * 16 * 1024 + buf.size() > metadata().size())
+		if (piece * 16 * 1024 + buf.size() > m_metadata.end_index())
 		{
 			// this piece is invalid
 			return false;
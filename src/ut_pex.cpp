@@ -48,6 +48,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/extensions/ut_pex.hpp"
 #include "libtorrent/aux_/time.hpp"
 #include "libtorrent/aux_/ip_helpers.hpp" // for is_v4
+#include "libtorrent/aux_/pex_tracker.hpp"
 
 #ifndef TORRENT_DISABLE_EXTENSIONS
 
@@ -57,8 +58,7 @@ namespace libtorrent { namespace {
 
 	enum
 	{
-		extension_index = 1,
-		max_peer_entries = 100
+		extension_index = 1
 	};
 
 	bool send_peer(peer_connection const& p)
@@ -73,36 +73,99 @@ namespace libtorrent { namespace {
 		return true;
 	}
 
+	pex_flags_t pex_flags_for(bt_peer_connection const& p)
+	{
+		// 0x01 - peer supports encryption
+		// 0x02 - peer is a seed
+		// 0x04 - supports uTP. This is only a positive flags
+		//        passing 0 doesn't mean the peer doesn't
+		//        support uTP
+		// 0x08 - supports hole punching protocol. If this
+		//        flag is received from a peer, it can be
+		//        used as a rendezvous point in case direct
+		//        connections to the peer fail
+		pex_flags_t flags = p.is_seed() ? pex_seed : pex_flags_t{};
+#if !defined TORRENT_DISABLE_ENCRYPTION
+		flags |= p.supports_encryption() ? pex_encryption : pex_flags_t{};
+#endif
+		flags |= is_utp(p.get_socket()) ? pex_utp : pex_flags_t{};
+		flags |= p.supports_holepunch() ? pex_holepunch : pex_flags_t{};
+		return flags;
+	}
+
+	// the endpoint to advertise a peer as
+	tcp::endpoint pex_endpoint(bt_peer_connection const& p)
+	{
+		tcp::endpoint remote = p.remote();
+
+		// if the peer has told us which port its listening on,
+		// use that port. But only if we didn't connect to the peer.
+		// if we connected to it, use the port we know works
+		if (!p.is_outgoing())
+		{
+			torrent_peer const* const pi = p.peer_info_struct();
+			if (pi != nullptr && pi->port > 0)
+				remote.port(pi->port);
+		}
+		return remote;
+	}
+
+	using aux::pex_msg_t;
+
+	// peers reference the shared PEX message directly from their send
+	// buffers, this holder keeps it alive until it's been sent
+	struct pex_msg_holder
+	{
+		explicit pex_msg_holder(pex_msg_t m) : m_msg(std::move(m)) {}
+		char* data() const { return const_cast<char*>(m_msg->data()); }
+		std::size_t size() const { return m_msg->size(); }
+	private:
+		pex_msg_t m_msg;
+	};
+
 	struct ut_pex_plugin final
 		: torrent_plugin
 	{
-		// randomize when we rebuild the pex message
-		// to evenly spread it out across all torrents
-		// the more torrents we have, the longer we can
-		// delay the rebuilding
 		explicit ut_pex_plugin(torrent& t)
 			: m_torrent(t)
-			, m_last_msg(min_time())
-			, m_peers_in_message(0) {}
+			, m_last_msg(min_time()) {}
 
 		std::shared_ptr<peer_plugin> new_connection(
 			peer_connection_handle const& pc) override;
 
-		std::vector<char>& get_ut_pex_msg()
+		// the diff since the previous message
+		pex_msg_t const& get_ut_pex_msg() const
 		{
-			return m_ut_pex_msg;
+			return m_tracker.diff_msg();
+		}
+
+		// all the peers we advertised as of the last diff message. This is
+		// what's sent to peers the first time. Subsequent diffs are relative
+		// to this
+		pex_msg_t const& get_full_msg() const
+		{
+			return m_tracker.full_msg();
 		}
 
 		int peers_in_msg() const
 		{
-			return m_peers_in_message;
+			return m_tracker.peers_in_msg();
+		}
+
+		void peer_connected(bt_peer_connection const* p)
+		{
+			m_tracker.peer_connected(p);
+		}
+
+		void peer_disconnected(bt_peer_connection const* p)
+		{
+			m_tracker.peer_disconnected(p);
 		}
 
 		// the second tick of the torrent
 		// each minute the new lists of "added" + "added.f" and "dropped"
 		// are calculated here and the pex message is created
 		// each peer connection will use this message
-		// max_peer_entries limits the packet size
 		void tick() override
 		{
 			if (m_torrent.flags() & torrent_flags::disable_pex) return;
@@ -113,113 +176,23 @@ namespace libtorrent { namespace {
 
 			if (m_torrent.num_peers() == 0) return;
 
-			entry pex;
-			std::string& pla = pex["added"].string();
-			std::string& pld = pex["dropped"].string();
-			std::string& plf = pex["added.f"].string();
-			std::back_insert_iterator<std::string> pla_out(pla);
-			std::back_insert_iterator<std::string> pld_out(pld);
-			std::back_insert_iterator<std::string> plf_out(plf);
-			std::string& pla6 = pex["added6"].string();
-			std::string& pld6 = pex["dropped6"].string();
-			std::string& plf6 = pex["added6.f"].string();
-			std::back_insert_iterator<std::string> pla6_out(pla6);
-			std::back_insert_iterator<std::string> pld6_out(pld6);
-			std::back_insert_iterator<std::string> plf6_out(plf6);
-
-			std::set<tcp::endpoint> dropped;
-			m_old_peers.swap(dropped);
-
-			m_peers_in_message = 0;
-			int num_added = 0;
-			for (auto const peer : m_torrent)
-			{
-				if (!send_peer(*peer)) continue;
-
-				tcp::endpoint remote = peer->remote();
-				m_old_peers.insert(remote);
-
-				auto const di = dropped.find(remote);
-				if (di == dropped.end())
-				{
-					// don't write too big of a package
-					if (num_added >= max_peer_entries) break;
-
-					// only send proper bittorrent peers
-					if (peer->type() != connection_type::bittorrent)
-						continue;
-
-					auto const* const p = static_cast<bt_peer_connection const*>(peer);
-
-					// if the peer has told us which port its listening on,
-					// use that port. But only if we didn't connect to the peer.
-					// if we connected to it, use the port we know works
-					if (!p->is_outgoing())
-					{
-						torrent_peer const* const pi = peer->peer_info_struct();
-						if (pi != nullptr && pi->port > 0)
-							remote.port(pi->port);
-					}
-
-					// no supported flags to set yet
-					// 0x01 - peer supports encryption
-					// 0x02 - peer is a seed
-					// 0x04 - supports uTP. This is only a positive flags
-					//        passing 0 doesn't mean the peer doesn't
-					//        support uTP
-					// 0x08 - supports hole punching protocol. If this
-					//        flag is received from a peer, it can be
-					//        used as a rendezvous point in case direct
-					//        connections to the peer fail
-					pex_flags_t flags = p->is_seed() ? pex_seed : pex_flags_t{};
-#if !defined TORRENT_DISABLE_ENCRYPTION
-					flags |= p->supports_encryption() ? pex_encryption : pex_flags_t{};
-#endif
-					flags |= is_utp(p->get_socket()) ? pex_utp : pex_flags_t{};
-					flags |= p->supports_holepunch() ? pex_holepunch : pex_flags_t{};
-
-					// i->first was added since the last time
-					if (aux::is_v4(remote))
-					{
-						aux::write_endpoint(remote, pla_out);
-						aux::write_uint8(static_cast<std::uint8_t>(flags), plf_out);
-					}
-					else
-					{
-						aux::write_endpoint(remote, pla6_out);
-						aux::write_uint8(static_cast<std::uint8_t>(flags), plf6_out);
-					}
-					++num_added;
-					++m_peers_in_message;
-				}
-				else
-				{
-					// this was in the previous message
-					// so, it wasn't dropped
-					dropped.erase(di);
-				}
-			}
-
-			for (auto const& i : dropped)
+			m_tracker.update([](bt_peer_connection const& p
+				, aux::pex_tracker<bt_peer_connection>::advertised_peer& ap)
 			{
-				if (aux::is_v4(i))
-					aux::write_endpoint(i, pld_out);
-				else
-					aux::write_endpoint(i, pld6_out);
-				++m_peers_in_message;
-			}
-
-			m_ut_pex_msg.clear();
-			bencode(std::back_inserter(m_ut_pex_msg), pex);
+				if (!send_peer(p)) return false;
+				ap.ep = pex_endpoint(p);
+				ap.flags = pex_flags_for(p);
+				return true;
+			});
 		}
 
 	private:
+
 		torrent& m_torrent;
 
-		std::set<tcp::endpoint> m_old_peers;
+		aux::pex_tracker<bt_peer_connection> m_tracker;
+
 		time_point m_last_msg;
-		std::vector<char> m_ut_pex_msg;
-		int m_peers_in_message;
 
 		// explicitly disallow assignment, to silence msvc warning
 		ut_pex_plugin& operator=(ut_pex_plugin const&) = delete;
@@ -228,7 +201,7 @@ namespace libtorrent { namespace {
 	struct ut_pex_peer_plugin final
 		: ut_pex_peer_store, peer_plugin
 	{
-		ut_pex_peer_plugin(torrent& t, peer_connection& pc, ut_pex_plugin& tp)
+		ut_pex_peer_plugin(torrent& t, bt_peer_connection& pc, ut_pex_plugin& tp)
 			: m_torrent(t)
 			, m_pc(pc)
 			, m_tp(tp)
@@ -249,19 +222,27 @@ namespace libtorrent { namespace {
 			messages[extension_name] = extension_index;
 		}
 
+		// this always returns true, even if the peer doesn't support
+		// ut_pex. We still want to advertise it to other peers, which
+		// requires the on_disconnect() notification
 		bool on_extension_handshake(bdecode_node const& h) override
 		{
 			m_message_index = 0;
-			if (h.type() != bdecode_node::dict_t) return false;
+			if (h.type() != bdecode_node::dict_t) return true;
 			bdecode_node const messages = h.dict_find_dict("m");
-			if (!messages) return false;
+			if (!messages) return true;
 
 			int const index = int(messages.dict_find_int_value(extension_name, -1));
-			if (index == -1) return false;
+			if (index == -1) return true;
 			m_message_index = index;
 			return true;
 		}
 
+		void on_disconnect(error_code const&) override
+		{
+			m_tp.peer_disconnected(&m_pc);
+		}
+
 		bool on_extended(int const length, int const msg, span<char const> body) override
 		{
 			if (msg != extension_index) return false;
@@ -439,6 +420,9 @@ namespace libtorrent { namespace {
 			int const num_peers = m_torrent.num_peers();
 			if (num_peers <= 1) return;
 
+			// the torrent hasn't built its first message yet
+			if (m_first_time && !m_tp.get_full_msg()) return;
+
 			m_last_msg = now;
 
 			if (m_first_time)
@@ -452,33 +436,38 @@ namespace libtorrent { namespace {
 			}
 		}
 
-		void send_ut_peer_diff()
+		void send_msg(pex_msg_t const& pex_msg)
 		{
-			if (m_torrent.flags() & torrent_flags::disable_pex) return;
-
-			// if there's no change in out peer set, don't send anything
-			if (m_tp.peers_in_msg() == 0) return;
-
-			std::vector<char> const& pex_msg = m_tp.get_ut_pex_msg();
-
 			char msg[6];
 			char* ptr = msg;
 
-			aux::write_uint32(1 + 1 + int(pex_msg.size()), ptr);
+			aux::write_uint32(1 + 1 + int(pex_msg->size()), ptr);
 			aux::write_uint8(bt_peer_connection::msg_extended, ptr);
 			aux::write_uint8(m_message_index, ptr);
 			m_pc.send_buffer(msg);
-			m_pc.send_buffer(pex_msg);
+			m_pc.append_const_send_buffer(pex_msg_holder(pex_msg), int(pex_msg->size()));
+			m_pc.setup_send();
 
 			m_pc.stats_counters().inc_stats_counter(counters::num_outgoing_extended);
 			m_pc.stats_counters().inc_stats_counter(counters::num_outgoing_pex);
+		}
+
+		void send_ut_peer_diff()
+		{
+			if (m_torrent.flags() & torrent_flags::disable_pex) return;
+
+			// if there's no change in out peer set, don't send anything
+			if (m_tp.peers_in_msg() == 0) return;
+
+			pex_msg_t const& pex_msg = m_tp.get_ut_pex_msg();
+			send_msg(pex_msg);
 
 #ifndef TORRENT_DISABLE_LOGGING
 			if (m_pc.should_log(peer_log_alert::outgoing_message))
 			{
 				bdecode_node m;
 				error_code ec;
-				int const ret = bdecode(&pex_msg[0], &pex_msg[0] + pex_msg.size(), m, ec);
+				int const ret = bdecode(pex_msg->data(), pex_msg->data() + pex_msg->size(), m, ec);
 				TORRENT_ASSERT(ret == 0);
 				TORRENT_ASSERT(!ec);
 				TORRENT_UNUSED(ret);
@@ -493,7 +482,7 @@ namespace libtorrent { namespace {
 				e = m.dict_find_string("dropped6");
 				if (e) num_dropped += e.string_length() / 18;
 				m_pc.peer_log(peer_log_alert::outgoing_message, "PEX_DIFF", "dropped: %d added: %d msg_size: %d"
-					, num_dropped, num_added, int(pex_msg.size()));
+					, num_dropped, num_added, int(pex_msg->size()));
 			}
 #endif
 		}
@@ -502,96 +491,17 @@ namespace libtorrent { namespace {
 		{
 			if (m_torrent.flags() & torrent_flags::disable_pex) return;
 
-			entry pex;
-			// leave the dropped string empty
-			pex["dropped"].string();
-			std::string& pla = pex["added"].string();
-			std::string& plf = pex["added.f"].string();
-			std::back_insert_iterator<std::string> pla_out(pla);
-			std::back_insert_iterator<std::string> plf_out(plf);
-
-			pex["dropped6"].string();
-			std::string& pla6 = pex["added6"].string();
-			std::string& plf6 = pex["added6.f"].string();
-			std::back_insert_iterator<std::string> pla6_out(pla6);
-			std::back_insert_iterator<std::string> plf6_out(plf6);
-
-			int num_added = 0;
-			for (auto const peer : m_torrent)
-			{
-				if (!send_peer(*peer)) continue;
-
-				// don't write too big of a package
-				if (num_added >= max_peer_entries) break;
-
-				// only send proper bittorrent peers
-				if (peer->type() != connection_type::bittorrent)
-					continue;
-
-				auto const* const p = static_cast<bt_peer_connection const*>(peer);
-
-				// no supported flags to set yet
-				// 0x01 - peer supports encryption
-				// 0x02 - peer is a seed
-				// 0x04 - supports uTP. This is only a positive flags
-				//        passing 0 doesn't mean the peer doesn't
-				//        support uTP
-				// 0x08 - supports hole punching protocol. If this
-				//        flag is received from a peer, it can be
-				//        used as a rendezvous point in case direct
-				//        connections to the peer fail
-				int flags = p->is_seed() ? 2 : 0;
-#if !defined TORRENT_DISABLE_ENCRYPTION
-				flags |= p->supports_encryption() ? 1 : 0;
-#endif
-				flags |= is_utp(p->get_socket()) ? 4 :  0;
-				flags |= p->supports_holepunch() ? 8 : 0;
-
-				tcp::endpoint remote = peer->remote();
-
-				if (!p->is_outgoing())
-				{
-					torrent_peer const* const pi = peer->peer_info_struct();
-					if (pi != nullptr && pi->port > 0)
-						remote.port(pi->port);
-				}
-
-				// i->first was added since the last time
-				if (aux::is_v4(remote))
-				{
-					aux::write_endpoint(remote, pla_out);
-					aux::write_uint8(flags, plf_out);
-				}
-				else
-				{
-					aux::write_endpoint(remote, pla6_out);
-					aux::write_uint8(flags, plf6_out);
-				}
-				++num_added;
-			}
-			std::vector<char> pex_msg;
-			bencode(std::back_inserter(pex_msg), pex);
-
-			char msg[6];
-			char* ptr = msg;
-
-			aux::write_uint32(1 + 1 + int(pex_msg.size()), ptr);
-			aux::write_uint8(bt_peer_connection::msg_extended, ptr);
-			aux::write_uint8(m_message_index, ptr);
-			m_pc.send_buffer(msg);
-			m_pc.send_buffer(pex_msg);
-
-			m_pc.stats_counters().inc_stats_counter(counters::num_outgoing_extended);
-			m_pc.stats_counters().inc_stats_counter(counters::num_outgoing_pex);
+			pex_msg_t const& pex_msg = m_tp.get_full_msg();
+			send_msg(pex_msg);
 
 #ifndef TORRENT_DISABLE_LOGGING
 			m_pc.peer_log(peer_log_alert::outgoing_message, "PEX_FULL"
-				, "added: %d msg_size: %d", num_added, int(pex_msg.size()));
+				, "msg_size: %d", int(pex_msg->size()));
 #endif
 		}
 
 		torrent& m_torrent;
-		peer_connection& m_pc;
+		bt_peer_connection& m_pc;
 		ut_pex_plugin& m_tp;
 
 		// the last pex messages we received
@@ -623,6 +533,7 @@ namespace libtorrent { namespace {
 		bt_peer_connection* c = static_cast<bt_peer_connection*>(pc.native_handle().get());
 		auto p = std::make_shared<ut_pex_peer_plugin>(m_torrent, *c, *this);
 		c->set_ut_pex(p);
+		peer_connected(c);
 		return p;
 	}
 } }
@@ -93,6 +93,8 @@ namespace libtorrent {
 
 		m_server_string = m_host;
 		aux::verify_encoding(m_server_string);
+
+		m_ses.inc_web_seed_connections(m_host, m_port, 1);
 	}
 
 	int web_connection_base::timeout() const
@@ -114,7 +116,10 @@ namespace libtorrent {
 		disconnect_if_redundant();
 	}
 
-	web_connection_base::~web_connection_base() = default;
+	web_connection_base::~web_connection_base()
+	{
+		m_ses.inc_web_seed_connections(m_host, m_port, -1);
+	}
 
 	void web_connection_base::on_connected()
 	{
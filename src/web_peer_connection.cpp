@@ -75,6 +75,7 @@ web_peer_connection::web_peer_connection(peer_connection_args& pack
 	, m_chunk_pos(0)
 	, m_partial_chunk_header(0)
 	, m_num_responses(0)
+	, m_send_scheduled(false)
 {
 	INVARIANT_CHECK;
 
@@ -345,12 +346,6 @@ void web_peer_connection::write_request(peer_request const& r)
 
 	TORRENT_ASSERT(t->valid_metadata());
 
-	torrent_info const& info = t->torrent_file();
-	peer_request req = r;
-
-	std::string request;
-	request.reserve(400);
-
 	int size = r.length;
 	const int block_size = t->block_size();
 	const int piece_size = t->torrent_file().piece_length();
@@ -365,6 +360,12 @@ void web_peer_connection::write_request(peer_request const& r)
 		TORRENT_ASSERT(validate_piece_request(pr));
 		m_requests.push_back(pr);
 
+		// the HTTP requests are not sent right away. They are queued up and
+		// flushed from a posted handler, once the bittorrent engine is done
+		// issuing requests for this round. That lets us coalesce requests for
+		// adjacent byte ranges into a single, larger, HTTP request
+		peer_request http_req = pr;
+
 		if (m_web->restart_request == m_requests.front())
 		{
 			TORRENT_ASSERT(int(m_piece.size()) == m_received_in_piece);
@@ -382,8 +383,8 @@ void web_peer_connection::write_request(peer_request const& r)
 			TORRENT_UNUSED(front);
 #endif
 
-			req.start += int(m_piece.size());
-			req.length -= int(m_piece.size());
+			http_req.start += int(m_piece.size());
+			http_req.length -= int(m_piece.size());
 
 			// just to keep the accounting straight for the upper layer.
 			// it doesn't know we just re-wrote the request
@@ -392,6 +393,7 @@ void web_peer_connection::write_request(peer_request const& r)
 
 			TORRENT_ASSERT(int(m_piece.size()) == m_received_in_piece);
 		}
+		m_pending_requests.push_back(http_req);
 
 #if 0
 			std::cerr << this << " REQ: p: " << pr.piece << " " << pr.start << std::endl;
@@ -405,62 +407,77 @@ void web_peer_connection::write_request(peer_request const& r)
 		, static_cast<int>(pr.piece), pr.start + pr.length);
 #endif
 
+	if (m_send_scheduled) return;
+	m_send_scheduled = true;
+	post(get_context(), std::bind(
+		&web_peer_connection::on_send_pending_requests,
+		std::static_pointer_cast<web_peer_connection>(self())));
+}
+
+void web_peer_connection::write_cancel(peer_request const& r)
+{
+	INVARIANT_CHECK;
+
+	// once the HTTP request has been sent, it can't be cancelled. But if it's
+	// still queued up, it's simply never sent. A request whose restart data
+	// we have is not queued as-is, so it's not found here
+	if (!m_pending_requests.cancel(r)) return;
+
+	auto const it = std::find(m_requests.begin(), m_requests.end(), r);
+	TORRENT_ASSERT(it != m_requests.end());
+	if (it != m_requests.end()) m_requests.erase(it);
+
+#ifndef TORRENT_DISABLE_LOGGING
+	peer_log(peer_log_alert::info, "CANCEL_QUEUED", "(piece: %d start: %d)"
+		, static_cast<int>(r.piece), r.start);
+#endif
+
+	// just like a peer without the fast extension, we'll never receive this
+	// block now
+	incoming_reject_request(r);
+}
+
+void web_peer_connection::on_send_pending_requests()
+{
+	m_send_scheduled = false;
+	if (is_disconnecting()) return;
+	if (m_pending_requests.empty()) return;
+
+	std::shared_ptr<torrent> t = associated_torrent().lock();
+	TORRENT_ASSERT(t);
+
+	file_storage const& fs = t->torrent_file().orig_files();
 	bool const single_file_request = t->torrent_file().num_files() == 1;
 	int const proxy_type = m_settings.get_int(settings_pack::proxy_type);
 	bool const using_proxy = (proxy_type == settings_pack::http
 		|| proxy_type == settings_pack::http_pw) && !m_ssl;
 
-	// the number of pad files that have been "requested". In case we _only_
-	// request padfiles, we can't rely on handling them in the on_receive()
-	// callback (because we won't receive anything), instead we have to post a
-	// pretend read callback where we can deliver the zeroes for the partfile
-	int num_pad_files = 0;
+	std::string request;
+	request.reserve(400);
 
-	// TODO: 3 do we really need a special case here? wouldn't the multi-file
-	// case handle single file torrents correctly too?
-	if (single_file_request)
+	// requests for the range immediately following the previous one, in the
+	// same file, are merged into it. The response is delivered to the
+	// bittorrent requests in order, so from the receive side, this is
+	// indistinguishable from receiving the responses back-to-back
+	for (auto const& file_req : m_pending_requests.flush(fs))
 	{
-		file_request_t file_req;
-		file_req.file_index = file_index_t(0);
-		file_req.start = std::int64_t(static_cast<int>(req.piece)) * info.piece_length()
-			+ req.start;
-		file_req.length = req.length;
+		// pad files are never requested from the web server. They are
+		// handled by handle_padfile(), by pretending we received zeroes
+		if (!single_file_request && fs.pad_file_at(file_req.file_index))
+		{
+			m_file_requests.push_back(file_req);
+			continue;
+		}
 
 		request += "GET ";
-		// do not encode single file paths, they are
-		// assumed to be encoded in the torrent file
-		request += using_proxy ? m_url : m_path;
-		request += " HTTP/1.1\r\n";
-		add_headers(request, m_settings, using_proxy);
-		request += "\r\nRange: bytes=";
-		request += to_string(file_req.start).data();
-		request += "-";
-		request += to_string(file_req.start + file_req.length - 1).data();
-		request += "\r\n\r\n";
-		m_first_request = false;
-
-		m_file_requests.push_back(file_req);
-	}
-	else
-	{
-		std::vector<file_slice> files = info.orig_files().map_block(req.piece, req.start
-			, req.length);
-
-		for (auto const &f : files)
+		if (single_file_request)
+		{
+			// do not encode single file paths, they are
+			// assumed to be encoded in the torrent file
+			request += using_proxy ? m_url : m_path;
+		}
+		else
 		{
-			file_request_t file_req;
-			file_req.file_index = f.file_index;
-			file_req.start = f.offset;
-			file_req.length = int(f.size);
-
-			if (info.orig_files().pad_file_at(f.file_index))
-			{
-				m_file_requests.push_back(file_req);
-				++num_pad_files;
-				continue;
-			}
-
-			request += "GET ";
 			if (using_proxy)
 			{
 				// m_url is already a properly escaped URL
@@ -468,7 +485,7 @@ void web_peer_connection::write_request(peer_request const& r)
 				request += m_url;
 			}
 
-			auto redirection = m_web->redirects.find(f.file_index);
+			auto redirection = m_web->redirects.find(file_req.file_index);
 			if (redirection != m_web->redirects.end())
 			{
 				auto const& redirect = redirection->second;
@@ -485,34 +502,36 @@ void web_peer_connection::write_request(peer_request const& r)
 					request += m_path;
 				}
 
-				request += escape_file_path(info.orig_files(), f.file_index);
+				request += escape_file_path(fs, file_req.file_index);
 			}
-			request += " HTTP/1.1\r\n";
-			add_headers(request, m_settings, using_proxy);
-			request += "\r\nRange: bytes=";
-			request += to_string(f.offset).data();
-			request += "-";
-			request += to_string(f.offset + f.size - 1).data();
-			request += "\r\n\r\n";
-			m_first_request = false;
+		}
+		request += " HTTP/1.1\r\n";
+		add_headers(request, m_settings, using_proxy);
+		request += "\r\nRange: bytes=";
+		request += to_string(file_req.start).data();
+		request += "-";
+		request += to_string(file_req.start + file_req.length - 1).data();
+		request += "\r\n\r\n";
+		m_first_request = false;
 
 #if 0
-			std::cerr << this << " SEND-REQUEST: f: " << f.file_index
-				<< " s: " << f.offset
-				<< " e: " << (f.offset + f.size - 1) << std::endl;
+		std::cerr << this << " SEND-REQUEST: f: " << file_req.file_index
+			<< " s: " << file_req.start
+			<< " e: " << (file_req.start + file_req.length - 1) << std::endl;
 #endif
-			// TODO: 3 file_index_t should not allow negative values
-			TORRENT_ASSERT(f.file_index >= file_index_t(0));
-
-			m_file_requests.push_back(file_req);
-		}
+		m_file_requests.push_back(file_req);
 	}
 
-	if (num_pad_files == int(m_file_requests.size()))
+	if (request.empty())
 	{
-		post(get_context(), std::bind(
-			&web_peer_connection::on_receive_padfile,
-			std::static_pointer_cast<web_peer_connection>(self())));
+		// In case we _only_ requested padfiles, and there are no outstanding
+		// HTTP requests, we can't rely on handling them in the on_receive()
+		// callback (because we won't receive anything). Instead we deliver
+		// the zeroes for the pad files right here
+		bool const waiting_for_response = std::any_of(m_file_requests.begin()
+			, m_file_requests.end(), [&](aux::web_file_request const& r)
+			{ return !fs.pad_file_at(r.file_index); });
+		if (!waiting_for_response) handle_padfile();
 		return;
 	}
 
@@ -613,11 +632,6 @@ bool web_peer_connection::received_invalid_data(piece_index_t const index, bool
 	return false;
 }
 
-void web_peer_connection::on_receive_padfile()
-{
-	handle_padfile();
-}
-
 void web_peer_connection::handle_error(int const bytes_left)
 {
 	std::shared_ptr<torrent> t = associated_torrent().lock();
@@ -876,7 +890,7 @@ void web_peer_connection::on_receive(error_code const& error
 			{
 				if (!m_file_requests.empty())
 				{
-					file_request_t const& file_req = m_file_requests.front();
+					aux::web_file_request const& file_req = m_file_requests.front();
 					m_web->have_files.resize(t->torrent_file().num_files(), true);
 					m_web->have_files.clear_bit(file_req.file_index);
 
@@ -925,7 +939,7 @@ void web_peer_connection::on_receive(error_code const& error
 		}
 
 		TORRENT_ASSERT(!m_file_requests.empty());
-		file_request_t const& file_req = m_file_requests.front();
+		aux::web_file_request const& file_req = m_file_requests.front();
 		if (range_start != file_req.start
 			|| range_end != file_req.start + file_req.length)
 		{
@@ -0,0 +1,206 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "test.hpp"
+#include "libtorrent/aux_/availability_index.hpp"
+#include "libtorrent/random.hpp"
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+using namespace lt;
+
+namespace {
+
+using bits = typed_bitfield<piece_index_t>;
+
+bits make_bits(char const* s)
+{
+	bits ret(int(std::strlen(s)));
+	for (int i = 0; s[i] != '\0'; ++i)
+		if (s[i] == '1') ret.set_bit(piece_index_t(i));
+	return ret;
+}
+
+void check_availability(aux::availability_index const& a, std::vector<int> const& expected)
+{
+	TEST_EQUAL(a.num_pieces(), int(expected.size()));
+	for (int i = 0; i < int(expected.size()); ++i)
+		TEST_EQUAL(a.availability(piece_index_t(i)), expected[std::size_t(i)]);
+#if TORRENT_USE_INVARIANT_CHECKS
+	a.check_invariant();
+#endif
+}
+
+auto const any_piece = [](piece_index_t) { return true; };
+
+} // anonymous namespace
+
+TORRENT_TEST(empty)
+{
+	aux::availability_index a(0);
+	TEST_EQUAL(a.num_pieces(), 0);
+	TEST_EQUAL(a.pick_rarest(0, 0, any_piece), piece_index_t(-1));
+}
+
+TORRENT_TEST(inc_dec)
+{
+	aux::availability_index a(4);
+	check_availability(a, {0, 0, 0, 0});
+
+	a.inc(make_bits("1100"));
+	a.inc(make_bits("0110"));
+	a.inc(piece_index_t(1));
+	check_availability(a, {1, 3, 1, 0});
+
+	a.dec(make_bits("0110"));
+	a.dec(piece_index_t(0));
+	check_availability(a, {0, 2, 0, 0});
+
+	a.dec(piece_index_t(1));
+	a.dec(piece_index_t(1));
+	check_availability(a, {0, 0, 0, 0});
+}
+
+TORRENT_TEST(seeds)
+{
+	aux::availability_index a(3);
+	a.inc_all();
+	a.inc_all();
+	a.inc(piece_index_t(2));
+	check_availability(a, {2, 2, 3});
+
+	// losing a piece no regular peer has turns a seed into a regular peer
+	a.dec(piece_index_t(0));
+	check_availability(a, {1, 2, 3});
+
+	a.dec_all();
+	check_availability(a, {0, 1, 2});
+
+	// with no seeds left, a peer having every piece is removed from every
+	// piece
+	a.dec(piece_index_t(2));
+	a.dec(piece_index_t(1));
+	a.dec(piece_index_t(2));
+	check_availability(a, {0, 0, 0});
+}
+
+TORRENT_TEST(dec_all_without_seeds)
+{
+	aux::availability_index a(3);
+	a.inc(make_bits("111"));
+	a.inc(make_bits("011"));
+	a.dec_all();
+	check_availability(a, {0, 1, 1});
+}
+
+TORRENT_TEST(pick_rarest)
+{
+	aux::availability_index a(5);
+	a.inc(make_bits("11111"));
+	a.inc(make_bits("11011"));
+	a.inc(make_bits("01001"));
+
+	// piece 2 is the only piece with availability 1
+	for (std::uint32_t r = 0; r < 10; ++r)
+		TEST_EQUAL(a.pick_rarest(0, r, any_piece), piece_index_t(2));
+
+	// when it's rejected, one of the pieces with availability 2 is picked
+	auto const not_2 = [](piece_index_t const p) { return p != piece_index_t(2); };
+	for (std::uint32_t r = 0; r < 10; ++r)
+	{
+		piece_index_t const p = a.pick_rarest(0, r, not_2);
+		TEST_CHECK(p == piece_index_t(0) || p == piece_index_t(3));
+	}
+
+	// skipping rarer pieces by minimum availability
+	TEST_EQUAL(a.pick_rarest(3, 0, any_piece) == piece_index_t(1)
+		|| a.pick_rarest(3, 0, any_piece) == piece_index_t(4), true);
+	TEST_EQUAL(a.pick_rarest(4, 0, any_piece), piece_index_t(-1));
+
+	auto const none = [](piece_index_t) { return false; };
+	TEST_EQUAL(a.pick_rarest(0, 0, none), piece_index_t(-1));
+
+	// seeds raise the availability of every piece
+	a.inc_all();
+	TEST_EQUAL(a.pick_rarest(2, 0, any_piece), piece_index_t(2));
+	TEST_EQUAL(a.pick_rarest(5, 0, any_piece), piece_index_t(-1));
+}
+
+TORRENT_TEST(pick_rarest_spreads_ties)
+{
+	aux::availability_index a(4);
+	std::vector<int> picked(4, 0);
+	for (std::uint32_t r = 0; r < 40; ++r)
+		++picked[std::size_t(static_cast<int>(a.pick_rarest(0, r, any_piece)))];
+	for (int const n : picked) TEST_EQUAL(n, 10);
+}
+
+TORRENT_TEST(random_operations)
+{
+	int const num_pieces = 50;
+	aux::availability_index a(num_pieces);
+	std::vector<int> expected(num_pieces, 0);
+
+	for (int round = 0; round < 5000; ++round)
+	{
+		piece_index_t const p(int(random(num_pieces - 1)));
+		switch (random(3))
+		{
+			case 0:
+				a.inc(p);
+				++expected[std::size_t(static_cast<int>(p))];
+				break;
+			case 1:
+				if (expected[std::size_t(static_cast<int>(p))] == 0) break;
+				a.dec(p);
+				--expected[std::size_t(static_cast<int>(p))];
+				break;
+			case 2:
+				a.inc_all();
+				for (auto& e : expected) ++e;
+				break;
+			case 3:
+				// every piece must still have the peer we're removing
+				if (*std::min_element(expected.begin(), expected.end()) == 0) break;
+				a.dec_all();
+				for (auto& e : expected) --e;
+				break;
+		}
+	}
+	check_availability(a, expected);
+
+	// the rarest piece is never more common than any other piece
+	piece_index_t const rarest = a.pick_rarest(0, 0, any_piece);
+	for (int const e : expected)
+		TEST_CHECK(a.availability(rarest) <= e);
+}
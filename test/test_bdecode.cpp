@@ -35,6 +35,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/bdecode.hpp"
 #include "libtorrent/entry.hpp"
 
+#include <cstring> // for memset
+
 using namespace lt;
 
 // test integer
@@ -781,6 +783,58 @@ TORRENT_TEST(parse_int_overflow)
 	TEST_EQUAL(e, b + 18);
 }
 
+TORRENT_TEST(parse_int_long_run)
+{
+	// more digits than fit in a single 8 byte word, but no overflow
+	char b[] = "00000000000000001234567:";
+	std::int64_t val = 0;
+	bdecode_errors::error_code_enum ec = bdecode_errors::no_error;
+	char const* e = parse_int(b, b + sizeof(b)-1, ':', val, ec);
+	TEST_EQUAL(ec, bdecode_errors::no_error);
+	TEST_EQUAL(val, 1234567);
+	TEST_EQUAL(e, b + sizeof(b) - 2);
+}
+
+TORRENT_TEST(parse_int_invalid_digit_in_word)
+{
+	char b[] = "1234567890/2345:";
+	std::int64_t val = 0;
+	bdecode_errors::error_code_enum ec = bdecode_errors::no_error;
+	char const* e = parse_int(b, b + sizeof(b)-1, ':', val, ec);
+	TEST_EQUAL(ec, bdecode_errors::expected_digit);
+	TEST_EQUAL(e, b + 10);
+}
+
+TORRENT_TEST(find_non_digit)
+{
+	// every non-digit character must terminate the run, regardless of where
+	// in an 8 byte word it is
+	for (int c = 0; c < 256; ++c)
+	{
+		if (c >= '0' && c <= '9') continue;
+		for (int pos = 0; pos < 20; ++pos)
+		{
+			char b[20];
+			std::memset(b, '5', sizeof(b));
+			b[pos] = char(c);
+			TEST_CHECK(aux::find_non_digit(b, b + sizeof(b)) == b + pos);
+		}
+	}
+
+	char const digits[] = "01234567890123456789";
+	TEST_CHECK(aux::find_non_digit(digits, digits + 20) == digits + 20);
+	TEST_CHECK(aux::find_non_digit(digits, digits) == digits);
+}
+
+TORRENT_TEST(integer_digits_longer_than_word)
+{
+	char b[] = "i-1234567890123456789e";
+	error_code ec;
+	bdecode_node e = bdecode(b, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(e.int_value(), -1234567890123456789LL);
+}
+
 TORRENT_TEST(parse_length_overflow)
 {
 	string_view const b[] = {
@@ -1365,3 +1419,61 @@ TORRENT_TEST(dict_at_node)
 	TEST_EQUAL(e.dict_at_node(1).first.string_offset(), 13);
 	TEST_EQUAL(e.dict_at_node(1).second.string_offset(), 19);
 }
+
+TORRENT_TEST(find_key)
+{
+	char b[] = "d1:ai1e1:bl1:xd1:yi2eee1:cd4:name3:foo6:pieces4:abcde1:di-3ee";
+	error_code ec;
+
+	span<char const> v = bdecode_find_key(b, "a", ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(std::string(v.data(), std::size_t(v.size())), "i1e");
+
+	v = bdecode_find_key(b, "b", ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(std::string(v.data(), std::size_t(v.size())), "l1:xd1:yi2eee");
+
+	v = bdecode_find_key(b, "c", ec);
+	TEST_CHECK(!ec);
+	v = bdecode_find_key(v, "name", ec);
+	TEST_CHECK(!ec);
+	bdecode_node const name = bdecode(v, ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(name.string_value(), "foo");
+
+	v = bdecode_find_key(b, "d", ec);
+	TEST_CHECK(!ec);
+	TEST_EQUAL(std::string(v.data(), std::size_t(v.size())), "i-3e");
+
+	v = bdecode_find_key(b, "missing", ec);
+	TEST_CHECK(!ec);
+	TEST_CHECK(v.empty());
+}
+
+TORRENT_TEST(find_key_errors)
+{
+	error_code ec;
+
+	// not a dictionary
+	bdecode_find_key("li1ee"_sv, "a", ec);
+	TEST_EQUAL(ec, error_code(bdecode_errors::expected_value));
+
+	// truncated
+	bdecode_find_key("d1:ai1e1:b"_sv, "b", ec);
+	TEST_EQUAL(ec, error_code(bdecode_errors::unexpected_eof));
+
+	// invalid item before the key we're looking for
+	bdecode_find_key("d1:ad1:xe1:bi1ee"_sv, "b", ec);
+	TEST_EQUAL(ec, error_code(bdecode_errors::expected_value));
+
+	// non-string dictionary key inside a skipped value
+	bdecode_find_key("d1:adi1ei1ee1:bi1ee"_sv, "b", ec);
+	TEST_EQUAL(ec, error_code(bdecode_errors::expected_digit));
+
+	// depth limit applies to skipped values too
+	bdecode_find_key("d1:alllleeee1:bi1ee"_sv, "b", ec, 3);
+	TEST_EQUAL(ec, error_code(bdecode_errors::depth_exceeded));
+
+	bdecode_find_key(span<char const>(), "b", ec);
+	TEST_EQUAL(ec, error_code(bdecode_errors::unexpected_eof));
+}
@@ -34,6 +34,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include "libtorrent/bencode.hpp"
 #include "libtorrent/bdecode.hpp"
+#include "libtorrent/aux_/bencode_writer.hpp"
 
 #include <iostream>
 #include <cstring>
@@ -272,3 +273,46 @@ TORRENT_TEST(integer_to_str)
 	TEST_CHECK(integer_to_str(buf, std::numeric_limits<std::int64_t>::max()) == "9223372036854775807"_sv);
 	TEST_CHECK(integer_to_str(buf, std::numeric_limits<std::int64_t>::min()) == "-9223372036854775808"_sv);
 }
+
+TORRENT_TEST(bencode_writer)
+{
+	std::string buf;
+	auto w = aux::make_bencode_writer(std::back_inserter(buf));
+	w.begin_dict();
+	w.key("a");
+	w.int_value(-1);
+	w.key("b");
+	w.begin_list();
+	w.string_value("foo");
+	w.int_value(1234567890123LL);
+	w.begin_dict();
+	w.end();
+	w.end();
+	w.key("c");
+	w.preformatted_value(span<char const>("i1e", 3));
+	w.key("d");
+	w.string_value("");
+	w.end();
+
+	entry e(entry::dictionary_t);
+	e["a"] = -1;
+	e["b"].list().push_back(entry("foo"));
+	e["b"].list().push_back(entry(1234567890123LL));
+	e["b"].list().push_back(entry(entry::dictionary_t));
+	e["c"] = 1;
+	e["d"] = std::string();
+
+	TEST_EQUAL(buf, encode(e));
+	TEST_EQUAL(w.size(), int(buf.size()));
+}
+
+TORRENT_TEST(bencode_writer_raw_buffer)
+{
+	char buf[100];
+	auto w = aux::make_bencode_writer(&buf[0]);
+	w.begin_list();
+	w.string_value("spam");
+	w.int_value(0);
+	w.end();
+	TEST_EQUAL(std::string(buf, std::size_t(w.size())), "l4:spami0ee");
+}
@@ -37,6 +37,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/bitfield.hpp"
 #include "libtorrent/aux_/cpuid.hpp"
 #include <cstdlib>
+#include <vector>
 
 using namespace lt;
 
@@ -429,3 +430,96 @@ TORRENT_TEST(bitfield_index_range)
 	TEST_EQUAL(sum, 15 * 16 / 2);
 }
 
+
+TORRENT_TEST(find_next_set)
+{
+	bitfield test1(200, false);
+	TEST_EQUAL(test1.find_next_set(0), -1);
+	TEST_EQUAL(test1.find_next_set(200), -1);
+
+	test1.set_bit(0);
+	test1.set_bit(31);
+	test1.set_bit(32);
+	test1.set_bit(130);
+	test1.set_bit(199);
+
+	std::vector<int> found;
+	for (int i = test1.find_next_set(0); i != -1; i = test1.find_next_set(i + 1))
+		found.push_back(i);
+	TEST_CHECK((found == std::vector<int>{0, 31, 32, 130, 199}));
+
+	TEST_EQUAL(test1.find_next_set(33), 130);
+	TEST_EQUAL(test1.find_next_set(131), 199);
+
+	std::vector<int> visited;
+	test1.for_each_set([&](int const i) { visited.push_back(i); });
+	TEST_CHECK(visited == found);
+}
+
+namespace {
+
+bitfield make_pattern(int const size, int const mod, int const rem)
+{
+	bitfield ret(size, false);
+	for (int i = 0; i < size; ++i)
+		if (i % mod == rem) ret.set_bit(i);
+	return ret;
+}
+
+}
+
+TORRENT_TEST(count_and)
+{
+	for (int const size : {0, 1, 31, 32, 33, 100, 1000, 5000})
+	{
+		bitfield const a = make_pattern(size, 3, 0);
+		bitfield const b = make_pattern(size, 2, 0);
+
+		int expect_and = 0;
+		int expect_and_not = 0;
+		for (int i = 0; i < size; ++i)
+		{
+			if (a.get_bit(i) && b.get_bit(i)) ++expect_and;
+			if (a.get_bit(i) && !b.get_bit(i)) ++expect_and_not;
+		}
+		TEST_EQUAL(a.count_and(b), expect_and);
+		TEST_EQUAL(a.count_and_not(b), expect_and_not);
+		TEST_EQUAL(a.any_and(b), expect_and > 0);
+		TEST_EQUAL(a.any_and_not(b), expect_and_not > 0);
+	}
+}
+
+TORRENT_TEST(any_and_last_bit)
+{
+	// only the very last bit overlaps, past the first block of words
+	bitfield a(4000, false);
+	bitfield b(4000, true);
+	TEST_CHECK(!a.any_and(b));
+	a.set_bit(3999);
+	TEST_CHECK(a.any_and(b));
+	b.clear_bit(3999);
+	TEST_CHECK(!a.any_and(b));
+	TEST_CHECK(a.any_and_not(b));
+}
+
+TORRENT_TEST(bitwise_ops)
+{
+	bitfield const a = make_pattern(70, 3, 0);
+	bitfield const b = make_pattern(70, 2, 0);
+
+	bitfield r_and = a;
+	r_and.bitwise_and(b);
+	bitfield r_or = a;
+	r_or.bitwise_or(b);
+	bitfield r_and_not = a;
+	r_and_not.bitwise_and_not(b);
+
+	for (int i = 0; i < 70; ++i)
+	{
+		TEST_EQUAL(r_and.get_bit(i), a.get_bit(i) && b.get_bit(i));
+		TEST_EQUAL(r_or.get_bit(i), a.get_bit(i) || b.get_bit(i));
+		TEST_EQUAL(r_and_not.get_bit(i), a.get_bit(i) && !b.get_bit(i));
+	}
+	TEST_EQUAL(r_and.count(), a.count_and(b));
+	TEST_EQUAL(r_and_not.count(), a.count_and_not(b));
+}
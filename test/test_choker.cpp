@@ -0,0 +1,219 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/choker.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/aux_/session_settings.hpp"
+#include "libtorrent/time.hpp"
+
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+time_point const now = clock_type::now();
+
+// each peer is identified by its number of pieces, which only the
+// anti-leech algorithm looks at
+aux::unchoke_peer peer(int const id)
+{
+	aux::unchoke_peer p;
+	p.num_have_pieces = id;
+	p.torrent_size = 100 * 0x4000;
+	p.piece_length = 0x4000;
+	p.last_unchoke = now - minutes(10);
+	return p;
+}
+
+aux::session_settings choker_settings(int const seed_algorithm, int const slots)
+{
+	aux::session_settings sett;
+	sett.set_int(settings_pack::choking_algorithm, settings_pack::fixed_slots_choker);
+	sett.set_int(settings_pack::seed_choking_algorithm, seed_algorithm);
+	sett.set_int(settings_pack::unchoke_slots_limit, slots);
+	return sett;
+}
+
+std::vector<int> order(std::vector<aux::unchoke_peer> const& peers, int const slots)
+{
+	std::vector<int> ret;
+	for (int i = 0; i < slots && i < int(peers.size()); ++i)
+		ret.push_back(peers[std::size_t(i)].num_have_pieces);
+	return ret;
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(fastest_upload)
+{
+	std::vector<aux::unchoke_peer> peers;
+	for (int i : {1, 4, 2, 3})
+	{
+		peers.push_back(peer(i));
+		peers.back().choked = false;
+		peers.back().uploaded_in_last_round = i * 1000;
+	}
+
+	auto const sett = choker_settings(settings_pack::fastest_upload, 2);
+	int const slots = aux::unchoke_sort(peers, seconds(15), sett, now);
+	TEST_EQUAL(slots, 2);
+	TEST_CHECK((order(peers, 2) == std::vector<int>{4, 3}));
+	TEST_EQUAL(int(peers.size()), 4);
+}
+
+TORRENT_TEST(round_robin)
+{
+	std::vector<aux::unchoke_peer> peers;
+
+	// unchoked, but it has received its quota and has been unchoked for
+	// more than a minute. It's de-prioritized despite its upload rate
+	peers.push_back(peer(1));
+	peers.back().choked = false;
+	peers.back().uploaded_in_last_round = 2000;
+	peers.back().uploaded_since_unchoked = 21 * 0x4000;
+	peers.back().last_unchoke = now - minutes(2);
+
+	// unchoked, still within its quota
+	peers.push_back(peer(2));
+	peers.back().choked = false;
+	peers.back().uploaded_in_last_round = 1000;
+	peers.back().uploaded_since_unchoked = 0x4000;
+	peers.back().last_unchoke = now - minutes(2);
+
+	// choked peers are ordered by how long they've waited. Their upload
+	// rate is ignored, it may be a residual transfer
+	peers.push_back(peer(3));
+	peers.back().uploaded_in_last_round = 5000;
+	peers.back().last_unchoke = now - minutes(5);
+
+	peers.push_back(peer(4));
+	peers.back().last_unchoke = now - minutes(20);
+
+	auto const sett = choker_settings(settings_pack::round_robin, 4);
+	int const slots = aux::unchoke_sort(peers, seconds(15), sett, now);
+	TEST_EQUAL(slots, 4);
+	TEST_CHECK((order(peers, 4) == std::vector<int>{2, 4, 3, 1}));
+}
+
+TORRENT_TEST(anti_leech)
+{
+	// peers that just started and peers that are about to complete are
+	// preferred over peers half-way through
+	std::vector<aux::unchoke_peer> peers;
+	for (int i : {50, 25, 99, 0})
+		peers.push_back(peer(i));
+
+	auto const sett = choker_settings(settings_pack::anti_leech, 4);
+	int const slots = aux::unchoke_sort(peers, seconds(15), sett, now);
+	TEST_EQUAL(slots, 4);
+	TEST_CHECK((order(peers, 4) == std::vector<int>{0, 99, 25, 50}));
+}
+
+TORRENT_TEST(priority_and_download_rate)
+{
+	std::vector<aux::unchoke_peer> peers;
+
+	peers.push_back(peer(1));
+	peers.back().choked = false;
+	peers.back().uploaded_in_last_round = 10000;
+
+	// peers that upload to us are preferred over the seed choking algorithm
+	peers.push_back(peer(2));
+	peers.back().downloaded_in_last_round = 100;
+
+	// and peers of higher priority over all of them
+	peers.push_back(peer(3));
+	peers.back().priority = 2;
+
+	for (int const algorithm : {settings_pack::round_robin
+		, settings_pack::fastest_upload, settings_pack::anti_leech})
+	{
+		auto const sett = choker_settings(algorithm, 3);
+		aux::unchoke_sort(peers, seconds(15), sett, now);
+		TEST_CHECK((order(peers, 2) == std::vector<int>{3, 2}));
+	}
+}
+
+TORRENT_TEST(plugin_rank)
+{
+	std::vector<aux::unchoke_peer> peers;
+
+	peers.push_back(peer(1));
+	peers.back().priority = 5;
+	peers.back().downloaded_in_last_round = 10000;
+
+	// a plugin's rank overrides the peer priority and all built-in criteria
+	peers.push_back(peer(2));
+	peers.back().ext_rank = 10;
+
+	peers.push_back(peer(3));
+	peers.back().ext_rank = 1;
+
+	auto const sett = choker_settings(settings_pack::fastest_upload, 3);
+	aux::unchoke_sort(peers, seconds(15), sett, now);
+	TEST_CHECK((order(peers, 3) == std::vector<int>{3, 2, 1}));
+}
+
+TORRENT_TEST(rate_based_slots)
+{
+	auto sett = choker_settings(settings_pack::fastest_upload, 8);
+	sett.set_int(settings_pack::choking_algorithm, settings_pack::rate_based_choker);
+	sett.set_int(settings_pack::rate_choker_initial_threshold, 1024);
+
+	// with no peers there's still one slot
+	std::vector<aux::unchoke_peer> peers;
+	TEST_EQUAL(aux::unchoke_sort(peers, seconds(1), sett, now), 1);
+
+	// the threshold starts at 1 kiB/s and grows by 2 kiB/s for every slot.
+	// 10000 B/s and 5000 B/s are above 1024 and 3072, but 3000 B/s is below
+	// 5120, so those two peers get a slot, plus one
+	for (int i : {3000, 10000, 500, 5000})
+	{
+		peers.push_back(peer(i));
+		peers.back().choked = false;
+		peers.back().uploaded_in_last_round = i;
+	}
+	int const slots = aux::unchoke_sort(peers, seconds(1), sett, now);
+	TEST_EQUAL(slots, 3);
+	TEST_CHECK((order(peers, 3) == std::vector<int>{10000, 5000, 3000}));
+
+	// the rate is measured over the unchoke interval
+	TEST_EQUAL(aux::unchoke_sort(peers, seconds(10), sett, now), 1);
+
+	// the upload priority weighs into the order the peers are visited in. The
+	// 500 B/s peer is visited first and stops the search
+	for (auto& p : peers)
+		if (p.uploaded_in_last_round == 500) p.priority = 100;
+	TEST_EQUAL(aux::unchoke_sort(peers, seconds(1), sett, now), 1);
+}
@@ -50,6 +50,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/aux_/path.hpp"
 #include "libtorrent/session.hpp"
 #include "libtorrent/session_params.hpp"
+#include "libtorrent/alert_types.hpp"
 
 #include <cstring>
 #include <functional>
@@ -941,6 +942,70 @@ TORRENT_TEST(dont_have)
 	print_session_log(*ses);
 }
 
+// a peer we have no business with releases its receive buffer and waits for
+// the socket to become readable. Make sure the next message is still read
+// and handled
+TORRENT_TEST(idle_peer_receive)
+{
+	std::cout << "\n === test idle peer receive ===\n" << std::endl;
+
+	info_hash_t ih;
+	torrent_handle th;
+	std::shared_ptr<lt::session> ses;
+	io_context ios;
+	tcp::socket s(ios);
+	setup_peer(s, ios, ih, ses, true, false, false, torrent_flags_t{}, &th);
+
+	char recv_buffer[1000];
+	do_handshake(s, ih, recv_buffer);
+	send_have_none(s);
+
+#ifndef TORRENT_DISABLE_LOGGING
+	// neither side is interested and nothing is outstanding, so the
+	// connection should go idle
+	bool idle = false;
+	time_point const start = clock_type::now();
+	while (!idle && clock_type::now() - start < seconds(10))
+	{
+		ses->wait_for_alert(seconds(1));
+		idle = print_alerts(*ses, "ses", false, false
+			, [](lt::alert const* a)
+			{
+				auto const* pla = alert_cast<peer_log_alert>(a);
+				return pla && std::strcmp(pla->event_type, "ASYNC_WAIT_READ") == 0;
+			});
+	}
+	TEST_CHECK(idle);
+#else
+	std::this_thread::sleep_for(lt::milliseconds(300));
+#endif
+
+	// now that the peer has something we want, we should become interested
+	send_have_all(s);
+
+	for (;;)
+	{
+		print_session_log(*ses);
+		int const len = read_message(s, recv_buffer);
+		if (len == -1) break;
+		auto const buffer = span<char const>(recv_buffer).first(len);
+		print_message(buffer);
+		if (len == 0) continue;
+		if (buffer[0] == 2) break; // interested
+	}
+
+	std::vector<peer_info> pi;
+	th.get_peer_info(pi);
+
+	TEST_EQUAL(pi.size(), 1);
+	if (pi.size() != 1) return;
+
+	TEST_CHECK(pi[0].flags & peer_info::seed);
+	TEST_CHECK(pi[0].flags & peer_info::interesting);
+
+	print_session_log(*ses);
+}
+
 TORRENT_TEST(extension_handshake)
 {
 	using namespace lt::aux;
@@ -0,0 +1,168 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/aux_/indexed_queue.hpp"
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+using namespace lt;
+
+namespace {
+
+struct element
+{
+	explicit element(int v) : value(v), node(this) {}
+	int value;
+	aux::queue_node<element> node;
+};
+
+using queue = aux::indexed_queue<element>;
+
+void check_order(queue const& q, std::vector<element*> const& expected)
+{
+	TEST_EQUAL(q.size(), int(expected.size()));
+	TEST_EQUAL(q.empty(), expected.empty());
+	int idx = 0;
+	for (element* e : q)
+	{
+		TEST_CHECK(e == expected[std::size_t(idx)]);
+		TEST_EQUAL(queue::position(e->node), idx);
+		TEST_CHECK(q[idx] == e);
+		++idx;
+	}
+	TEST_EQUAL(idx, int(expected.size()));
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(empty)
+{
+	queue q;
+	TEST_EQUAL(q.size(), 0);
+	TEST_CHECK(q.empty());
+	TEST_CHECK(q.begin() == q.end());
+}
+
+TORRENT_TEST(insert_erase)
+{
+	element a(0), b(1), c(2), d(3);
+	queue q;
+	q.insert(a.node, 0);
+	q.insert(b.node, 1);
+	// past the end appends
+	q.insert(c.node, 100);
+	check_order(q, {&a, &b, &c});
+
+	q.insert(d.node, 0);
+	check_order(q, {&d, &a, &b, &c});
+
+	q.erase(a.node);
+	TEST_CHECK(!a.node.in_queue());
+	check_order(q, {&d, &b, &c});
+
+	q.erase(d.node);
+	q.erase(c.node);
+	check_order(q, {&b});
+
+	q.erase(b.node);
+	check_order(q, {});
+}
+
+TORRENT_TEST(move)
+{
+	element a(0), b(1), c(2), d(3);
+	queue q;
+	for (element* e : {&a, &b, &c, &d})
+		q.insert(e->node, q.size());
+
+	// to the top
+	q.move(c.node, 0);
+	check_order(q, {&c, &a, &b, &d});
+
+	// past the end moves to the bottom
+	q.move(a.node, 100);
+	check_order(q, {&c, &b, &d, &a});
+
+	q.move(c.node, 2);
+	check_order(q, {&b, &d, &c, &a});
+
+	q.move(a.node, 3);
+	check_order(q, {&b, &d, &c, &a});
+}
+
+TORRENT_TEST(random_operations)
+{
+	std::vector<std::unique_ptr<element>> storage;
+	for (int i = 0; i < 200; ++i)
+		storage.emplace_back(new element(i));
+
+	queue q;
+	std::vector<element*> expected;
+
+	std::uint32_t seed = 1;
+	auto rand = [&]
+	{
+		seed = seed * 1103515245 + 12345;
+		return int((seed >> 8) & 0xffff);
+	};
+
+	for (int i = 0; i < 5000; ++i)
+	{
+		element* e = storage[std::size_t(rand() % int(storage.size()))].get();
+		int const pos = rand() % (int(expected.size()) + 1);
+		if (e->node.in_queue())
+		{
+			expected.erase(std::find(expected.begin(), expected.end(), e));
+			if (rand() % 3 == 0)
+			{
+				q.erase(e->node);
+			}
+			else
+			{
+				int const new_pos = std::min(pos, int(expected.size()));
+				q.move(e->node, new_pos);
+				expected.insert(expected.begin() + new_pos, e);
+			}
+		}
+		else
+		{
+			q.insert(e->node, pos);
+			expected.insert(expected.begin() + pos, e);
+		}
+
+		if ((i % 100) == 0) check_order(q, expected);
+	}
+	check_order(q, expected);
+}
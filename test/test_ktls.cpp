@@ -0,0 +1,304 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/ssl.hpp"
+
+#if TORRENT_USE_KTLS
+
+#include "libtorrent/socket.hpp"
+#include "libtorrent/io_context.hpp"
+#include "libtorrent/aux_/path.hpp"
+
+#include "libtorrent/aux_/disable_warnings_push.hpp"
+#include <boost/asio/write.hpp>
+#include "libtorrent/aux_/disable_warnings_pop.hpp"
+
+#include <openssl/evp.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+std::string const cert_file = combine_path("..", combine_path("ssl", "server.pem"));
+
+struct tls_pair
+{
+	explicit tls_pair(char const* suite, int const version = TLS1_3_VERSION
+		, bool const ktls = true)
+		: client_ctx(ssl::context::tls)
+		, server_ctx(ssl::context::tls)
+	{
+		server_ctx.use_certificate_chain_file(cert_file);
+		server_ctx.use_private_key_file(cert_file, ssl::context::pem);
+		client_ctx.set_verify_mode(ssl::context::verify_none);
+		for (auto* ctx : {client_ctx.native_handle(), server_ctx.native_handle()})
+		{
+			SSL_CTX_set_min_proto_version(ctx, version);
+			SSL_CTX_set_max_proto_version(ctx, version);
+			SSL_CTX_set_ciphersuites(ctx, suite);
+			if (ktls) ssl::enable_ktls(ctx);
+		}
+
+		client = SSL_new(client_ctx.native_handle());
+		server = SSL_new(server_ctx.native_handle());
+		SSL_set_bio(client, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+		SSL_set_bio(server, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+		SSL_set_connect_state(client);
+		SSL_set_accept_state(server);
+	}
+
+	~tls_pair()
+	{
+		SSL_free(client);
+		SSL_free(server);
+	}
+
+	tls_pair(tls_pair const&) = delete;
+	tls_pair& operator=(tls_pair const&) = delete;
+
+	// moves everything s has written to the other side
+	void transfer(SSL* s)
+	{
+		std::vector<char> buf(std::size_t(BIO_ctrl_pending(SSL_get_wbio(s))));
+		if (buf.empty()) return;
+		BIO_read(SSL_get_wbio(s), buf.data(), int(buf.size()));
+		BIO_write(SSL_get_rbio(s == client ? server : client), buf.data(), int(buf.size()));
+	}
+
+	bool handshake()
+	{
+		for (int i = 0; i < 10; ++i)
+		{
+			int const c = SSL_do_handshake(client);
+			transfer(client);
+			int const s = SSL_do_handshake(server);
+			transfer(server);
+			if (c == 1 && s == 1) return true;
+		}
+		return false;
+	}
+
+	ssl::context client_ctx;
+	ssl::context server_ctx;
+	SSL* client = nullptr;
+	SSL* server = nullptr;
+};
+
+// builds the first TLS 1.3 application data record (sequence number 0) the
+// way the kernel would
+std::vector<char> make_record(ssl::ktls_tx_key const& k, std::string const& msg)
+{
+	std::string inner = msg;
+	// the inner content type
+	inner.push_back(23);
+	int const tag_size = 16;
+	int const len = int(inner.size()) + tag_size;
+
+	std::vector<char> ret(5 + std::size_t(len));
+	ret[0] = 23;
+	ret[1] = 3;
+	ret[2] = 3;
+	ret[3] = char(len >> 8);
+	ret[4] = char(len & 0xff);
+
+	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+	EVP_EncryptInit_ex(ctx, k.key_size == 16 ? EVP_aes_128_gcm() : EVP_aes_256_gcm()
+		, nullptr, k.key.data(), k.iv.data());
+	int out_len = 0;
+	EVP_EncryptUpdate(ctx, nullptr, &out_len, reinterpret_cast<unsigned char*>(ret.data()), 5);
+	EVP_EncryptUpdate(ctx, reinterpret_cast<unsigned char*>(ret.data() + 5), &out_len
+		, reinterpret_cast<unsigned char const*>(inner.data()), int(inner.size()));
+	EVP_EncryptFinal_ex(ctx, nullptr, &out_len);
+	EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tag_size, ret.data() + 5 + inner.size());
+	EVP_CIPHER_CTX_free(ctx);
+	return ret;
+}
+
+std::string read_all(SSL* s)
+{
+	std::array<char, 100> buf;
+	int const ret = SSL_read(s, buf.data(), int(buf.size()));
+	if (ret <= 0) return {};
+	return std::string(buf.data(), std::size_t(ret));
+}
+
+void test_tx_key(char const* suite, int const key_size)
+{
+	tls_pair p(suite);
+	TEST_CHECK(p.handshake());
+
+	// both directions. The server must not have sent any session tickets,
+	// or its first application data record wouldn't have sequence number 0
+	for (auto* s : {p.client, p.server})
+	{
+		ssl::ktls_tx_key k;
+		TEST_CHECK(ssl::get_ktls_tx_key(s, k));
+		TEST_EQUAL(k.key_size, key_size);
+
+		std::vector<char> const rec = make_record(k, "hello kernel");
+		SSL* peer = s == p.client ? p.server : p.client;
+		BIO_write(SSL_get_rbio(peer), rec.data(), int(rec.size()));
+		TEST_EQUAL(read_all(peer), "hello kernel");
+	}
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(tx_key_aes_128)
+{
+	test_tx_key("TLS_AES_128_GCM_SHA256", 16);
+}
+
+TORRENT_TEST(tx_key_aes_256)
+{
+	test_tx_key("TLS_AES_256_GCM_SHA384", 32);
+}
+
+TORRENT_TEST(tx_key_unsupported)
+{
+	// ChaCha20-Poly1305 isn't handed to the kernel
+	{
+		tls_pair p("TLS_CHACHA20_POLY1305_SHA256");
+		TEST_CHECK(p.handshake());
+		ssl::ktls_tx_key k;
+		TEST_CHECK(!ssl::get_ktls_tx_key(p.client, k));
+	}
+
+	// nor is TLS 1.2
+	{
+		tls_pair p("TLS_AES_128_GCM_SHA256", TLS1_2_VERSION);
+		TEST_CHECK(p.handshake());
+		ssl::ktls_tx_key k;
+		TEST_CHECK(!ssl::get_ktls_tx_key(p.client, k));
+		TEST_CHECK(!ssl::enable_ktls_tx(p.client, -1));
+	}
+
+	// without enable_ktls() no secret is captured
+	{
+		tls_pair p("TLS_AES_128_GCM_SHA256", TLS1_3_VERSION, false);
+		TEST_CHECK(!ssl::ktls_enabled(p.client_ctx.native_handle()));
+		TEST_CHECK(p.handshake());
+		ssl::ktls_tx_key k;
+		TEST_CHECK(!ssl::get_ktls_tx_key(p.client, k));
+	}
+}
+
+TORRENT_TEST(no_userspace_tx_after_offload)
+{
+	tls_pair p("TLS_AES_128_GCM_SHA256");
+	TEST_CHECK(p.handshake());
+
+	// this is what enable_ktls_tx() does to the client once the kernel
+	// encrypts for it
+	ssl::disable_userspace_tx(p.client);
+
+	// reading doesn't need to send anything
+	std::string const msg = "hello";
+	TEST_EQUAL(SSL_write(p.server, msg.data(), int(msg.size())), int(msg.size()));
+	p.transfer(p.server);
+	TEST_EQUAL(read_all(p.client), msg);
+
+	// a KeyUpdate request must not make the client send its answer
+	// encrypted by OpenSSL. Some versions answer on the next SSL_write()
+	// (which won't happen), others from within SSL_read()
+	TEST_EQUAL(SSL_key_update(p.server, SSL_KEY_UPDATE_REQUESTED), 1);
+	TEST_EQUAL(SSL_write(p.server, msg.data(), int(msg.size())), int(msg.size()));
+	p.transfer(p.server);
+	read_all(p.client);
+	TEST_EQUAL(BIO_ctrl_pending(SSL_get_wbio(p.client)), 0);
+
+	// a corrupt record makes OpenSSL send an alert. The read must fail
+	// without it
+	TEST_EQUAL(SSL_write(p.server, msg.data(), int(msg.size())), int(msg.size()));
+	std::vector<char> buf(std::size_t(BIO_ctrl_pending(SSL_get_wbio(p.server))));
+	BIO_read(SSL_get_wbio(p.server), buf.data(), int(buf.size()));
+	buf.back() ^= 1;
+	BIO_write(SSL_get_rbio(p.client), buf.data(), int(buf.size()));
+
+	std::array<char, 100> out;
+	int const ret = SSL_read(p.client, out.data(), int(out.size()));
+	TEST_CHECK(ret <= 0);
+	TEST_EQUAL(SSL_get_error(p.client, ret), SSL_ERROR_SSL);
+	TEST_EQUAL(BIO_ctrl_pending(SSL_get_wbio(p.client)), 0);
+}
+
+TORRENT_TEST(loopback)
+{
+	if (!ssl::ktls_supported())
+	{
+		std::printf("kernel does not support kTLS, skipping\n");
+		return;
+	}
+
+	tls_pair p("TLS_AES_128_GCM_SHA256");
+	TEST_CHECK(p.handshake());
+
+	io_context ios;
+	tcp::acceptor acceptor(ios, tcp::endpoint(address_v4::loopback(), 0));
+	tcp::socket client(ios);
+	client.connect(acceptor.local_endpoint());
+	tcp::socket server(ios);
+	acceptor.accept(server);
+
+	TEST_CHECK(ssl::enable_ktls_tx(p.client, client.native_handle()));
+
+	// the plain text we write is sent as a TLS record
+	std::string const msg = "hello kernel";
+	boost::asio::write(client, boost::asio::buffer(msg));
+
+	std::string received;
+	for (;;)
+	{
+		std::array<char, 1000> buf;
+		std::size_t const n = server.read_some(boost::asio::buffer(buf));
+		BIO_write(SSL_get_rbio(p.server), buf.data(), int(n));
+		int const ret = SSL_read(p.server, buf.data(), int(buf.size()));
+		if (ret > 0)
+		{
+			received.assign(buf.data(), std::size_t(ret));
+			break;
+		}
+		if (SSL_get_error(p.server, ret) != SSL_ERROR_WANT_READ) break;
+	}
+	TEST_EQUAL(received, msg);
+}
+
+#else
+TORRENT_TEST(disabled) {}
+#endif // TORRENT_USE_KTLS
@@ -0,0 +1,232 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "test.hpp"
+#include "setup_transfer.hpp"
+#include "settings.hpp"
+#include "test_utils.hpp"
+
+#include "libtorrent/session.hpp"
+#include "libtorrent/alert_types.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/torrent_info.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/ip_filter.hpp"
+#include "libtorrent/aux_/path.hpp"
+
+#include <cstring>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+// the info-dictionary is a little over 20 bytes per piece, which makes it
+// span several 16 kiB ut_metadata pieces
+std::shared_ptr<torrent_info> make_torrent(int const num_pieces)
+{
+	file_storage fs;
+	fs.add_file("metadata_transfer/file", std::int64_t(num_pieces) * 16 * 1024);
+	lt::create_torrent t(fs, 16 * 1024, create_torrent::v1_only);
+	for (auto const i : fs.piece_range())
+		t.set_hash(i, sha1_hash::max());
+	std::vector<char> buf;
+	bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<torrent_info>(buf, from_span);
+}
+
+settings_pack metadata_settings()
+{
+	settings_pack pack = settings();
+	pack.set_str(settings_pack::listen_interfaces, test_listen_interface());
+	return pack;
+}
+
+void add_seed(lt::session& ses, std::shared_ptr<torrent_info> ti)
+{
+	wait_for_listen(ses, "seed");
+	add_torrent_params p;
+	p.ti = std::move(ti);
+	p.save_path = "metadata_transfer_seed";
+	p.flags &= ~torrent_flags::paused;
+	p.flags &= ~torrent_flags::auto_managed;
+	// the file is never read, the seed only serves the metadata
+	p.flags |= torrent_flags::seed_mode;
+	ses.add_torrent(p);
+}
+
+add_torrent_params magnet_params(torrent_info const& ti)
+{
+	add_torrent_params p;
+	p.info_hashes = ti.info_hashes();
+	p.save_path = "metadata_transfer_downloader";
+	p.flags &= ~torrent_flags::paused;
+	p.flags &= ~torrent_flags::auto_managed;
+	// only the metadata is transferred, none of the file
+	p.file_priorities.assign(std::size_t(ti.num_files()), dont_download);
+	return p;
+}
+
+void connect(torrent_handle const& h, lt::session& seed)
+{
+	h.connect_peer(tcp::endpoint(make_address_v4("127.0.0.1")
+		, std::uint16_t(seed.listen_port())));
+}
+
+// waits for the downloader to receive the metadata. pieces_sent is set to
+// the number of ut_metadata pieces each of the seeds sent.
+bool wait_for_metadata(lt::session& downloader
+	, std::vector<lt::session*> const& seeds
+	, std::vector<int>& pieces_sent)
+{
+	pieces_sent.assign(seeds.size(), 0);
+	time_point const start = clock_type::now();
+	bool received = false;
+	while (!received && clock_type::now() - start < seconds(20))
+	{
+		downloader.wait_for_alert(milliseconds(100));
+		received = print_alerts(downloader, "downloader", false, false
+			, [](alert const* a) { return alert_cast<metadata_received_alert>(a) != nullptr; }
+			, true);
+
+		for (std::size_t i = 0; i < seeds.size(); ++i)
+		{
+			std::vector<alert*> alerts;
+			seeds[i]->pop_alerts(&alerts);
+#ifndef TORRENT_DISABLE_LOGGING
+			for (alert const* a : alerts)
+			{
+				auto const* pl = alert_cast<peer_log_alert>(a);
+				if (pl == nullptr
+					|| pl->direction != peer_log_alert::outgoing_message
+					|| std::strcmp(pl->event_type, "UT_METADATA") != 0)
+					continue;
+				if (std::strncmp(pl->log_message(), "type: 1 ", 8) == 0)
+					++pieces_sent[i];
+			}
+#endif
+		}
+	}
+	return received;
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(transfer_metadata)
+{
+	// about 60 kiB of metadata, i.e. 4 ut_metadata pieces
+	auto const ti = make_torrent(3000);
+	TEST_CHECK(ti->info_section().size() > 3 * 16 * 1024);
+
+	lt::session seed(metadata_settings());
+	lt::session downloader(metadata_settings());
+	add_seed(seed, ti);
+
+	torrent_handle const h = downloader.add_torrent(magnet_params(*ti));
+	TEST_CHECK(!h.status().has_metadata);
+	connect(h, seed);
+
+	std::vector<int> pieces_sent;
+	TEST_CHECK(wait_for_metadata(downloader, {&seed}, pieces_sent));
+	TEST_CHECK(h.status().has_metadata);
+	auto const received = h.torrent_file();
+	TEST_CHECK(received && received->info_section() == ti->info_section());
+#ifndef TORRENT_DISABLE_LOGGING
+	TEST_EQUAL(pieces_sent[0], 4);
+#endif
+}
+
+TORRENT_TEST(transfer_metadata_from_two_peers)
+{
+	// about 320 kiB of metadata, i.e. 20 ut_metadata pieces. The seeds are
+	// rate limited, so that the requests are spread across both of them
+	// rather than one seed answering all of them before the other one has
+	// completed its handshake
+	auto const ti = make_torrent(16000);
+
+	settings_pack pack = metadata_settings();
+	pack.set_int(settings_pack::upload_rate_limit, 64 * 1024);
+	lt::session seed1(pack);
+	lt::session seed2(pack);
+	lt::session downloader(metadata_settings());
+
+	// apply the rate limit to local peers too
+	ip_filter f;
+	f.add_rule(make_address_v4("0.0.0.0"), make_address_v4("255.255.255.255")
+		, 1 << static_cast<std::uint32_t>(lt::session::global_peer_class_id));
+	seed1.set_peer_class_filter(f);
+	seed2.set_peer_class_filter(f);
+
+	add_seed(seed1, ti);
+	add_seed(seed2, ti);
+
+	torrent_handle const h = downloader.add_torrent(magnet_params(*ti));
+	connect(h, seed1);
+	connect(h, seed2);
+
+	std::vector<int> pieces_sent;
+	TEST_CHECK(wait_for_metadata(downloader, {&seed1, &seed2}, pieces_sent));
+	TEST_CHECK(h.status().has_metadata);
+	auto const received = h.torrent_file();
+	TEST_CHECK(received && received->info_section() == ti->info_section());
+#ifndef TORRENT_DISABLE_LOGGING
+	std::printf("pieces sent: %d %d\n", pieces_sent[0], pieces_sent[1]);
+	TEST_CHECK(pieces_sent[0] > 0);
+	TEST_CHECK(pieces_sent[1] > 0);
+	TEST_CHECK(pieces_sent[0] + pieces_sent[1] >= 20);
+#endif
+}
+
+TORRENT_TEST(metadata_cache_after_transfer)
+{
+	auto const ti = make_torrent(3000);
+
+	lt::session seed(metadata_settings());
+	lt::session downloader(metadata_settings());
+	add_seed(seed, ti);
+
+	add_torrent_params const p = magnet_params(*ti);
+	torrent_handle h = downloader.add_torrent(p);
+	connect(h, seed);
+
+	std::vector<int> pieces_sent;
+	TEST_CHECK(wait_for_metadata(downloader, {&seed}, pieces_sent));
+
+	downloader.remove_torrent(h);
+	TEST_CHECK(wait_for_alert(downloader, torrent_removed_alert::alert_type, "downloader"));
+
+	// adding the magnet link again finds the metadata in the session's
+	// cache, without connecting to any peer
+	h = downloader.add_torrent(p);
+	TEST_CHECK(h.status().has_metadata);
+	auto const cached = h.torrent_file();
+	TEST_CHECK(cached && cached->info_section() == ti->info_section());
+}
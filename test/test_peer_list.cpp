@@ -575,6 +575,35 @@ TORRENT_TEST(erase_peers)
 	TEST_CHECK(st.erased.size() == 1 || peer == nullptr);
 }
 
+TORRENT_TEST(shed_peers)
+{
+	torrent_state st = init_state();
+	mock_torrent t(&st);
+	st.allow_multiple_connections_per_ip = true;
+	peer_list p(allocator);
+	t.m_p = &p;
+
+	for (int i = 0; i < 50; ++i)
+		TEST_CHECK(add_peer(p, st, rand_tcp_ep()));
+	TEST_EQUAL(p.num_peers(), 50);
+
+	std::int64_t const before = p.memory_usage();
+
+	torrent_peer* connected = *p.begin();
+	t.connect_to_peer(connected);
+
+	TEST_EQUAL(p.shed_peers(20, &st), 30);
+	TEST_EQUAL(p.num_peers(), 20);
+	TEST_EQUAL(int(st.erased.size()), 30);
+	TEST_CHECK(p.memory_usage() < before);
+	st.erased.clear();
+
+	// connected peers are never shed
+	TEST_EQUAL(p.shed_peers(0, &st), 19);
+	TEST_EQUAL(p.num_peers(), 1);
+	TEST_CHECK(*p.begin() == connected);
+}
+
 // test set_ip_filter
 TORRENT_TEST(set_ip_filter)
 {
@@ -0,0 +1,204 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "test.hpp"
+#include "libtorrent/aux_/pex_tracker.hpp"
+#include "libtorrent/bdecode.hpp"
+#include "libtorrent/address.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+struct connection
+{
+	tcp::endpoint ep;
+	bool connected = true;
+};
+
+using tracker = aux::pex_tracker<connection>;
+
+void update(tracker& t)
+{
+	t.update([](connection const& c, tracker::advertised_peer& ap)
+	{
+		if (!c.connected) return false;
+		ap.ep = c.ep;
+		ap.flags = pex_seed;
+		return true;
+	});
+}
+
+tcp::endpoint ep(char const* ip, int const port)
+{
+	return tcp::endpoint(make_address(ip), std::uint16_t(port));
+}
+
+// the endpoints in one of the compact peer lists of a message, sorted
+std::vector<tcp::endpoint> peers(aux::pex_msg_t const& msg, char const* key)
+{
+	error_code ec;
+	bdecode_node const e = bdecode(*msg, ec);
+	TEST_CHECK(!ec);
+	std::vector<tcp::endpoint> ret;
+	if (ec) return ret;
+	std::string const list(e.dict_find_string_value(key));
+	bool const v6 = std::string(key).find('6') != std::string::npos;
+	int const size = v6 ? 18 : 6;
+	char const* in = list.data();
+	for (int i = 0; i < int(list.size()) / size; ++i)
+	{
+		ret.push_back(v6 ? aux::read_v6_endpoint<tcp::endpoint>(in)
+			: aux::read_v4_endpoint<tcp::endpoint>(in));
+	}
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+
+std::string peer_flags(aux::pex_msg_t const& msg, char const* key)
+{
+	error_code ec;
+	bdecode_node const e = bdecode(*msg, ec);
+	return std::string(e.dict_find_string_value(key));
+}
+
+using eps = std::vector<tcp::endpoint>;
+
+} // anonymous namespace
+
+TORRENT_TEST(connect)
+{
+	connection a{ep("10.0.0.1", 1000)};
+	connection b{ep("10.0.0.2", 2000)};
+	connection c{ep("2001::1", 3000)};
+
+	tracker t;
+	TEST_CHECK(!t.full_msg());
+	t.peer_connected(&a);
+	t.peer_connected(&b);
+	t.peer_connected(&c);
+	update(t);
+
+	TEST_EQUAL(t.peers_in_msg(), 3);
+	TEST_CHECK(peers(t.diff_msg(), "added") == (eps{a.ep, b.ep}));
+	TEST_CHECK(peers(t.diff_msg(), "added6") == (eps{c.ep}));
+	TEST_EQUAL(peer_flags(t.diff_msg(), "added.f"), std::string(2, char(pex_seed)));
+	TEST_CHECK(peers(t.full_msg(), "added") == (eps{a.ep, b.ep}));
+	TEST_CHECK(peers(t.full_msg(), "added6") == (eps{c.ep}));
+
+	// nothing changed
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 0);
+	TEST_CHECK(peers(t.diff_msg(), "added").empty());
+	TEST_CHECK(peers(t.full_msg(), "added") == (eps{a.ep, b.ep}));
+}
+
+TORRENT_TEST(not_advertised_until_ready)
+{
+	connection a{ep("10.0.0.1", 1000), false};
+
+	tracker t;
+	t.peer_connected(&a);
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 0);
+	TEST_CHECK(peers(t.full_msg(), "added").empty());
+
+	a.connected = true;
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 1);
+	TEST_CHECK(peers(t.diff_msg(), "added") == (eps{a.ep}));
+	TEST_CHECK(peers(t.full_msg(), "added") == (eps{a.ep}));
+}
+
+TORRENT_TEST(disconnect)
+{
+	connection a{ep("10.0.0.1", 1000)};
+	connection b{ep("10.0.0.2", 2000)};
+	connection c{ep("2001::1", 3000)};
+
+	tracker t;
+	t.peer_connected(&a);
+	t.peer_connected(&b);
+	t.peer_connected(&c);
+	update(t);
+
+	// a tick with only dropped peers must remove them from the full message
+	// too, it's what new peers are sent
+	t.peer_disconnected(&a);
+	t.peer_disconnected(&c);
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 2);
+	TEST_CHECK(peers(t.diff_msg(), "added").empty());
+	TEST_CHECK(peers(t.diff_msg(), "dropped") == (eps{a.ep}));
+	TEST_CHECK(peers(t.diff_msg(), "dropped6") == (eps{c.ep}));
+	TEST_CHECK(peers(t.full_msg(), "added") == (eps{b.ep}));
+	TEST_CHECK(peers(t.full_msg(), "added6").empty());
+	TEST_CHECK(peers(t.full_msg(), "dropped").empty());
+
+	// dropped peers are only reported once
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 0);
+	TEST_CHECK(peers(t.diff_msg(), "dropped").empty());
+}
+
+TORRENT_TEST(disconnect_before_advertised)
+{
+	connection a{ep("10.0.0.1", 1000)};
+
+	tracker t;
+	t.peer_connected(&a);
+	t.peer_disconnected(&a);
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 0);
+	TEST_CHECK(peers(t.diff_msg(), "dropped").empty());
+	TEST_CHECK(peers(t.full_msg(), "added").empty());
+}
+
+TORRENT_TEST(max_peer_entries)
+{
+	std::vector<connection> conns;
+	for (int i = 0; i < tracker::max_peer_entries + 10; ++i)
+		conns.push_back(connection{ep("10.0.0.1", 1000 + i)});
+
+	tracker t;
+	for (auto const& c : conns) t.peer_connected(&c);
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), tracker::max_peer_entries);
+
+	// the remaining peers are added by the next message
+	update(t);
+	TEST_EQUAL(t.peers_in_msg(), 10);
+	TEST_EQUAL(int(peers(t.full_msg(), "added").size()), tracker::max_peer_entries);
+}
@@ -2826,6 +2826,91 @@ TORRENT_TEST(piece_extent_affinity_no_duplicates)
 	TEST_CHECK(picked == full_piece(9_piece, blocks));
 }
 
+TORRENT_TEST(wanted_pieces)
+{
+	// pieces we have and pieces with priority 0 are not wanted
+	auto p = setup_picker("1111111", "*  *   ", "1101111", "");
+	auto const& wanted = p->wanted_pieces();
+	TEST_EQUAL(wanted.size(), 7);
+	TEST_CHECK(!wanted[0_piece]);
+	TEST_CHECK(wanted[1_piece]);
+	TEST_CHECK(!wanted[2_piece]);
+	TEST_CHECK(!wanted[3_piece]);
+	TEST_CHECK(wanted[4_piece]);
+	TEST_EQUAL(wanted.count(), 4);
+
+	p->set_piece_priority(2_piece, low_priority);
+	TEST_CHECK(wanted[2_piece]);
+	p->set_piece_priority(4_piece, dont_download);
+	TEST_CHECK(!wanted[4_piece]);
+
+	p->mark_as_downloading({1_piece, 0}, &peer_struct);
+	p->piece_passed(1_piece);
+	TEST_CHECK(!wanted[1_piece]);
+	p->we_dont_have(1_piece);
+	TEST_CHECK(wanted[1_piece]);
+
+	p->we_have_all();
+	TEST_EQUAL(wanted.count(), 0);
+}
+
+TORRENT_TEST(wanted_changes)
+{
+	auto p = setup_picker("1111111", "       ", "1111111", "");
+	std::uint64_t const start = p->wanted_sequence();
+
+	std::vector<std::pair<piece_index_t, bool>> changes;
+	auto record = [&](piece_index_t const piece, bool const wanted)
+	{ changes.emplace_back(piece, wanted); };
+
+	TEST_CHECK(p->wanted_changes_since(start, record));
+	TEST_CHECK(changes.empty());
+
+	p->set_piece_priority(2_piece, dont_download);
+	p->set_piece_priority(3_piece, dont_download);
+	// not a change to the wanted pieces
+	p->set_piece_priority(3_piece, dont_download);
+	p->set_piece_priority(2_piece, low_priority);
+	TEST_EQUAL(p->wanted_sequence(), start + 3);
+
+	TEST_CHECK(p->wanted_changes_since(start, record));
+	TEST_CHECK((changes == std::vector<std::pair<piece_index_t, bool>>{
+		{2_piece, false}, {3_piece, false}, {2_piece, true}}));
+
+	changes.clear();
+	TEST_CHECK(p->wanted_changes_since(start + 2, record));
+	TEST_CHECK((changes == std::vector<std::pair<piece_index_t, bool>>{
+		{2_piece, true}}));
+
+	// a sequence number from the future
+	TEST_CHECK(!p->wanted_changes_since(start + 4, record));
+
+	// rewriting all of them forgets the changes
+	changes.clear();
+	std::uint64_t const before = p->wanted_sequence();
+	p->we_have_all();
+	TEST_CHECK(!p->wanted_changes_since(before, record));
+	TEST_CHECK(changes.empty());
+	TEST_CHECK(p->wanted_changes_since(p->wanted_sequence(), record));
+}
+
+TORRENT_TEST(wanted_changes_forget_old)
+{
+	auto p = setup_picker("1111111", "       ", "1111111", "");
+	std::uint64_t const start = p->wanted_sequence();
+
+	// only a limited number of changes are remembered
+	for (int i = 0; i < 100; ++i)
+		p->set_piece_priority(0_piece, i % 2 ? default_priority : dont_download);
+
+	int num_changes = 0;
+	auto count = [&](piece_index_t, bool) { ++num_changes; };
+	TEST_CHECK(!p->wanted_changes_since(start, count));
+	TEST_EQUAL(num_changes, 0);
+	TEST_CHECK(p->wanted_changes_since(p->wanted_sequence() - 10, count));
+	TEST_EQUAL(num_changes, 10);
+}
+
 TORRENT_TEST(piece_block_exported)
 {
 	// piece_block is part of the public API via picker_log_alert::blocks
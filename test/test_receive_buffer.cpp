@@ -37,6 +37,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 using namespace lt;
 using lt::aux::receive_buffer;
+using lt::aux::receive_buffer_pool;
 
 TORRENT_TEST(recv_buffer_init)
 {
@@ -167,6 +168,77 @@ TORRENT_TEST(recv_buffer_reserve)
 	TEST_CHECK(range2.size() >= 50);
 }
 
+TORRENT_TEST(recv_buffer_release)
+{
+	receive_buffer b;
+	b.reset(20);
+	TEST_CHECK(b.empty());
+
+	b.reserve(100);
+	b.received(20);
+	TEST_CHECK(!b.empty());
+
+	// consume the packet
+	b.advance_pos(20);
+	b.cut(20, 4);
+	b.normalize();
+	TEST_CHECK(b.empty());
+
+	b.release();
+	TEST_EQUAL(b.capacity(), 0);
+	TEST_EQUAL(b.packet_size(), 4);
+
+	auto const range = b.reserve(100);
+	TEST_CHECK(range.size() >= 100);
+	TEST_CHECK(b.capacity() >= 100);
+}
+
+TORRENT_TEST(recv_buffer_pool)
+{
+	receive_buffer_pool pool;
+	receive_buffer b(&pool);
+	b.reset(20);
+
+	// a small read borrows from the pool
+	b.reserve(100);
+	TEST_CHECK(b.pooled());
+	TEST_CHECK(b.capacity() >= receive_buffer_pool::buffer_size);
+	b.received(20);
+	b.advance_pos(20);
+	b.cut(20, 4);
+	b.normalize();
+
+	// and hands it back once we're done with it
+	b.release();
+	TEST_CHECK(!b.pooled());
+	TEST_EQUAL(b.capacity(), 0);
+	TEST_EQUAL(pool.num_free(), 1);
+
+	b.reserve(100);
+	TEST_CHECK(b.pooled());
+	TEST_EQUAL(pool.num_free(), 0);
+
+	// a large message grows out of the pooled buffer, and returns it
+	b.reset(16000);
+	b.received(1000);
+	b.grow(100000);
+	TEST_CHECK(!b.pooled());
+	TEST_CHECK(b.capacity() >= 16000);
+	TEST_EQUAL(pool.num_free(), 1);
+}
+
+TORRENT_TEST(recv_buffer_pool_large_read)
+{
+	receive_buffer_pool pool;
+	receive_buffer b(&pool);
+	b.reset(16000);
+
+	// reads larger than the pooled buffers don't use the pool
+	b.reserve(16000);
+	TEST_CHECK(!b.pooled());
+	TEST_EQUAL(pool.num_free(), 0);
+}
+
 TORRENT_TEST(receive_buffer_normalize)
 {
 	receive_buffer b;
@@ -0,0 +1,248 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/ssl.hpp"
+
+#if TORRENT_USE_SSL_SESSION_CACHE
+
+#include "libtorrent/aux_/path.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+std::string const cert_file = combine_path("..", combine_path("ssl", "server.pem"));
+
+int accept_any(int, X509_STORE_CTX*) { return 1; }
+
+// a server context that verifies peer certificates, like the ones SSL
+// torrents use
+void setup_server(ssl::context& ctx, string_view const id)
+{
+	ctx.use_certificate_chain_file(cert_file);
+	ctx.use_private_key_file(cert_file, ssl::context::pem);
+	SSL_CTX_set_verify(ctx.native_handle()
+		, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, &accept_any);
+	ssl::set_session_id_context(ctx.native_handle(), id);
+}
+
+// the context incoming connections start out on. It hands them over to the
+// context named by the SNI. Connections without SNI stay on it, like
+// connections to a tracker or web seed
+int switch_context(SSL* s, int*, void* arg)
+{
+	char const* name = SSL_get_servername(s, TLSEXT_NAMETYPE_host_name);
+	if (name == nullptr) return SSL_TLSEXT_ERR_NOACK;
+	auto* ctxs = static_cast<std::vector<ssl::context*>*>(arg);
+	std::size_t const idx = std::size_t(name[0] - '0');
+	if (idx >= ctxs->size()) return SSL_TLSEXT_ERR_ALERT_FATAL;
+	return ssl::set_context(s, (*ctxs)[idx]->native_handle())
+		? SSL_TLSEXT_ERR_OK : SSL_TLSEXT_ERR_ALERT_FATAL;
+}
+
+void transfer(SSL* from, SSL* to)
+{
+	std::vector<char> buf(std::size_t(BIO_ctrl_pending(SSL_get_wbio(from))));
+	if (buf.empty()) return;
+	BIO_read(SSL_get_wbio(from), buf.data(), int(buf.size()));
+	BIO_write(SSL_get_rbio(to), buf.data(), int(buf.size()));
+}
+
+enum class handshake { failed, full, resumed };
+
+struct fixture
+{
+	fixture()
+		: client_ctx(ssl::context::tls)
+		, server_ctx(ssl::context::tls)
+		, torrent_ctx0(ssl::context::tls)
+		, torrent_ctx1(ssl::context::tls)
+	{
+		client_ctx.use_certificate_chain_file(cert_file);
+		client_ctx.use_private_key_file(cert_file, ssl::context::pem);
+		client_ctx.set_verify_mode(ssl::context::verify_none);
+		ssl::enable_session_cache(client_ctx.native_handle());
+
+		server_ctx.use_certificate_chain_file(cert_file);
+		server_ctx.use_private_key_file(cert_file, ssl::context::pem);
+		ssl::set_session_id_context(server_ctx.native_handle(), "server");
+		error_code ec;
+		ssl::set_server_name_callback(server_ctx.native_handle(), &switch_context
+			, &contexts, ec);
+
+		setup_server(torrent_ctx0, "torrent 0");
+		setup_server(torrent_ctx1, "torrent 1");
+		contexts = {&torrent_ctx0, &torrent_ctx1};
+	}
+
+	// runs a connection from the client to the server, asking for the given
+	// torrent (or none, if nullptr)
+	handshake connect(std::string const& endpoint, char const* torrent
+		, int const version = TLS1_3_VERSION)
+	{
+		SSL_CTX_set_max_proto_version(client_ctx.native_handle(), version);
+		SSL* client = SSL_new(client_ctx.native_handle());
+		SSL* server = SSL_new(server_ctx.native_handle());
+		SSL_set_bio(client, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+		SSL_set_bio(server, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+		SSL_set_connect_state(client);
+		SSL_set_accept_state(server);
+
+		error_code ec;
+		if (torrent != nullptr) ssl::set_host_name(client, torrent, ec);
+		ssl::resume_session(client, endpoint);
+
+		bool done = false;
+		for (int i = 0; i < 10 && !done; ++i)
+		{
+			int const c = SSL_do_handshake(client);
+			transfer(client, server);
+			int const s = SSL_do_handshake(server);
+			transfer(server, client);
+			done = c == 1 && s == 1;
+		}
+
+		handshake ret = handshake::failed;
+		if (done)
+		{
+			// TLS 1.3 session tickets arrive after the handshake
+			char buf[10];
+			TEST_CHECK(SSL_read(client, buf, sizeof(buf)) <= 0);
+
+			ret = SSL_session_reused(client) == 1
+				? handshake::resumed : handshake::full;
+			TEST_EQUAL(SSL_session_reused(server) == 1, ret == handshake::resumed);
+		}
+		else
+		{
+			// this is what ssl_stream does when the handshake fails
+			ssl::forget_session(client);
+		}
+		SSL_free(client);
+		SSL_free(server);
+		return ret;
+	}
+
+	ssl::context client_ctx;
+	ssl::context server_ctx;
+	ssl::context torrent_ctx0;
+	ssl::context torrent_ctx1;
+	std::vector<ssl::context*> contexts;
+};
+
+} // anonymous namespace
+
+TORRENT_TEST(resume)
+{
+	fixture f;
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::resumed);
+	// we got new tickets on the resumed connection
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::resumed);
+	TEST_EQUAL(ssl::session_cache_size(f.client_ctx.native_handle()), 1);
+}
+
+TORRENT_TEST(resume_tls12)
+{
+	fixture f;
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0", TLS1_2_VERSION) == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0", TLS1_2_VERSION) == handshake::resumed);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0", TLS1_2_VERSION) == handshake::resumed);
+}
+
+TORRENT_TEST(resume_without_server_name)
+{
+	for (int const version : {TLS1_2_VERSION, TLS1_3_VERSION})
+	{
+		fixture f;
+		TEST_CHECK(f.connect("10.0.0.1:443", nullptr, version) == handshake::full);
+		TEST_CHECK(f.connect("10.0.0.1:443", nullptr, version) == handshake::resumed);
+	}
+}
+
+TORRENT_TEST(keyed_by_endpoint)
+{
+	fixture f;
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.2:6881", "0") == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.1:6882", "0") == handshake::full);
+	TEST_EQUAL(ssl::session_cache_size(f.client_ctx.native_handle()), 3);
+	TEST_CHECK(f.connect("10.0.0.2:6881", "0") == handshake::resumed);
+}
+
+TORRENT_TEST(keyed_by_server_name)
+{
+	fixture f;
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "1") == handshake::full);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::resumed);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "1") == handshake::resumed);
+}
+
+TORRENT_TEST(bound_to_torrent)
+{
+	for (int const version : {TLS1_2_VERSION, TLS1_3_VERSION})
+	{
+		fixture f;
+		TEST_CHECK(f.connect("10.0.0.1:6881", "0", version) == handshake::full);
+
+		// the client offers the session it got from torrent 0, but the server
+		// now hands the connection to torrent 1. That would skip verifying
+		// the client's certificate against torrent 1, so the connection is
+		// refused
+		f.contexts[0] = &f.torrent_ctx1;
+		TEST_CHECK(f.connect("10.0.0.1:6881", "0", version) == handshake::failed);
+
+		// the client dropped the session and does a full handshake
+		TEST_EQUAL(ssl::session_cache_size(f.client_ctx.native_handle()), 0);
+		TEST_CHECK(f.connect("10.0.0.1:6881", "0", version) == handshake::full);
+		TEST_CHECK(f.connect("10.0.0.1:6881", "0", version) == handshake::resumed);
+	}
+}
+
+TORRENT_TEST(clear)
+{
+	fixture f;
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::full);
+	TEST_EQUAL(ssl::session_cache_size(f.client_ctx.native_handle()), 1);
+	ssl::clear_session_cache(f.client_ctx.native_handle());
+	TEST_EQUAL(ssl::session_cache_size(f.client_ctx.native_handle()), 0);
+	TEST_CHECK(f.connect("10.0.0.1:6881", "0") == handshake::full);
+}
+
+#else
+TORRENT_TEST(disabled) {}
+#endif // TORRENT_USE_SSL_SESSION_CACHE
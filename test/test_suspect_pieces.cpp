@@ -0,0 +1,195 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "test_utils.hpp"
+#include "libtorrent/aux_/suspect_pieces.hpp"
+#include "libtorrent/hasher.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+using pieces = aux::suspect_pieces<int>;
+using record = pieces::block_record;
+
+sha1_hash digest(std::string const& data)
+{
+	return hasher(data).final();
+}
+
+// records the peers that are banned, in order
+struct ban_log
+{
+	std::vector<int>& banned;
+	void operator()(record const& r, sha1_hash const&) const
+	{ banned.push_back(r.peer); }
+};
+
+} // anonymous namespace
+
+TORRENT_TEST(poisoned_peer_banned_on_pass)
+{
+	pieces s(100);
+	std::vector<int> banned;
+	ban_log const ban{banned};
+
+	TEST_CHECK(!s.is_suspect(0_piece));
+
+	// the first time a piece fails, all blocks need to be read back
+	std::vector<bool> read_back = s.piece_failed(0_piece, 2, ban);
+	TEST_CHECK((read_back == std::vector<bool>{true, true}));
+	TEST_CHECK(s.is_suspect(0_piece));
+
+	// peer 1 sent a bad block 0, peer 2 a good block 1
+	s.failed_block(0_piece, {1, digest("bad"), 0}, ban);
+	s.failed_block(0_piece, {2, digest("good1"), 1}, ban);
+	TEST_EQUAL(s.num_records(), 2);
+
+	// the next attempt is hashed as it's received
+	s.block_received(0_piece, {3, digest("good0"), 0});
+	s.block_received(0_piece, {2, digest("good1"), 1});
+
+	std::vector<record> const unresolved = s.piece_passed(0_piece, ban);
+	TEST_CHECK(unresolved.empty());
+	TEST_CHECK((banned == std::vector<int>{1}));
+	TEST_CHECK(!s.is_suspect(0_piece));
+	TEST_EQUAL(s.num_records(), 0);
+	TEST_EQUAL(s.memory_usage(), 0);
+}
+
+TORRENT_TEST(different_data_in_two_failures)
+{
+	pieces s(100);
+	std::vector<int> banned;
+	ban_log const ban{banned};
+
+	s.piece_failed(0_piece, 2, ban);
+	s.failed_block(0_piece, {1, digest("bad-a"), 0}, ban);
+	s.failed_block(0_piece, {2, digest("good"), 1}, ban);
+
+	// peer 1 sends different data for the same block, and the piece fails
+	// again. At least one of its blocks was bad. Peer 2 sent the same data
+	// both times, which may well be good
+	s.block_received(0_piece, {1, digest("bad-b"), 0});
+	s.block_received(0_piece, {2, digest("good"), 1});
+	std::vector<bool> const read_back = s.piece_failed(0_piece, 2, ban);
+	TEST_CHECK((banned == std::vector<int>{1}));
+
+	// all blocks of this attempt were hashed on receive
+	TEST_CHECK((read_back == std::vector<bool>{false, false}));
+	TEST_EQUAL(s.num_records(), 2);
+}
+
+TORRENT_TEST(unhashed_blocks_are_read_back)
+{
+	pieces s(100);
+	std::vector<int> banned;
+	ban_log const ban{banned};
+
+	s.piece_failed(0_piece, 3, ban);
+	s.failed_block(0_piece, {1, digest("a"), 0}, ban);
+	s.failed_block(0_piece, {1, digest("b"), 1}, ban);
+
+	// only block 1 of the second attempt was hashed when it was received,
+	// e.g. because the others bypassed the peer plugins
+	s.block_received(0_piece, {2, digest("c"), 1});
+	std::vector<bool> const read_back = s.piece_failed(0_piece, 3, ban);
+	TEST_CHECK((read_back == std::vector<bool>{true, false, true}));
+
+	// when the piece passes, failed blocks without a hash of the passing
+	// data are returned, to be compared against the data on disk
+	std::vector<record> const unresolved = s.piece_passed(0_piece, ban);
+	TEST_EQUAL(int(unresolved.size()), 3);
+	TEST_CHECK(banned.empty());
+}
+
+TORRENT_TEST(ambiguous_block)
+{
+	pieces s(100);
+	std::vector<int> banned;
+	ban_log const ban{banned};
+
+	s.piece_failed(0_piece, 1, ban);
+	s.failed_block(0_piece, {1, digest("bad"), 0}, ban);
+
+	// two peers sent different data for the block (end-game mode), we don't
+	// know which one made the piece pass
+	s.block_received(0_piece, {2, digest("x"), 0});
+	s.block_received(0_piece, {3, digest("y"), 0});
+	std::vector<record> const unresolved = s.piece_passed(0_piece, ban);
+	TEST_CHECK(unresolved.empty());
+	TEST_CHECK(banned.empty());
+}
+
+TORRENT_TEST(memory_bound)
+{
+	int const max_records = 100;
+	pieces s(max_records);
+	std::vector<int> banned;
+	ban_log const ban{banned};
+
+	// a poisoned peer makes every piece fail. The hashes kept for them are
+	// bounded, the least recently failed pieces are evicted
+	for (piece_index_t p{0}; p < piece_index_t{1000}; ++p)
+	{
+		s.piece_failed(p, 4, ban);
+		for (int b = 0; b < 4; ++b)
+			s.failed_block(p, {1, digest("bad"), b}, ban);
+		TEST_CHECK(s.num_records() <= max_records);
+	}
+	TEST_EQUAL(s.num_records(), max_records);
+	TEST_EQUAL(s.num_pieces(), max_records / 4);
+	TEST_CHECK(s.is_suspect(piece_index_t{999}));
+	TEST_CHECK(!s.is_suspect(piece_index_t{0}));
+	std::int64_t const bounded = s.memory_usage();
+
+	// a piece failing again is moved to the front
+	s.piece_failed(piece_index_t{980}, 4, ban);
+	s.piece_failed(piece_index_t{1000}, 4, ban);
+	for (int b = 0; b < 4; ++b)
+		s.failed_block(piece_index_t{1000}, {1, digest("bad"), b}, ban);
+	TEST_CHECK(s.is_suspect(piece_index_t{980}));
+	TEST_CHECK(!s.is_suspect(piece_index_t{975}));
+	TEST_EQUAL(s.memory_usage(), bounded);
+
+	// when the good data arrives, the peer is banned
+	for (int b = 0; b < 4; ++b)
+		s.block_received(piece_index_t{999}, {2, digest("good"), b});
+	s.piece_passed(piece_index_t{999}, ban);
+	TEST_CHECK(!banned.empty());
+	for (int const p : banned) TEST_EQUAL(p, 1);
+	TEST_CHECK(s.num_records() <= max_records);
+}
@@ -50,9 +50,17 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "libtorrent/span.hpp"
 #include "libtorrent/session_params.hpp"
 #include "libtorrent/random.hpp"
+#include "libtorrent/session_stats.hpp"
+#include "libtorrent/io_context.hpp"
+#include "libtorrent/socket.hpp"
 #include "settings.hpp"
 #include <tuple>
+#include <map>
+#include <cstring>
+#include <thread>
+#include <future>
 #include <iostream>
+#include <fstream>
 
 #include "test.hpp"
 #include "test_utils.hpp"
@@ -550,6 +558,381 @@ TORRENT_TEST(torrent_status)
 	TEST_EQUAL(static_cast<int>(torrent_status::error_file_exception), -5);
 }
 
+TORRENT_TEST(status_snapshot)
+{
+	lt::settings_pack pack = settings();
+	pack.set_int(settings_pack::tick_interval, 100);
+	lt::session ses(pack);
+
+	add_torrent_params p = parse_magnet_uri(
+		"magnet:?xt=urn:btih:abababababababababababababababababababab&dn=snapshot");
+	p.save_path = ".";
+	p.flags &= ~torrent_flags::auto_managed;
+	p.flags |= torrent_flags::paused;
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	std::shared_ptr<torrent_status const> const first = h.status_snapshot();
+	TEST_CHECK(first);
+	TEST_EQUAL(first->name, "snapshot");
+	TEST_CHECK(first->handle == h);
+
+	// no state change, the same snapshot is returned
+	TEST_CHECK(h.status_snapshot() == first);
+
+	int const old_limit = first->uploads_limit;
+	h.set_max_uploads(7);
+
+	// the change is published within a tick
+	std::shared_ptr<torrent_status const> st;
+	for (int i = 0; i < 50; ++i)
+	{
+		st = h.status_snapshot();
+		if (st->uploads_limit == 7) break;
+		std::this_thread::sleep_for(lt::milliseconds(100));
+	}
+	TEST_EQUAL(st->uploads_limit, 7);
+	TEST_CHECK(st != first);
+
+	// earlier snapshots are not modified
+	TEST_EQUAL(first->uploads_limit, old_limit);
+}
+
+TORRENT_TEST(async_queries)
+{
+	lt::session ses(settings());
+
+	add_torrent_params p = parse_magnet_uri(
+		"magnet:?xt=urn:btih:abababababababababababababababababababab&dn=async"
+		"&tr=http://127.0.0.1:1/announce");
+	p.save_path = ".";
+	p.flags &= ~torrent_flags::auto_managed;
+	p.flags |= torrent_flags::paused;
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	std::promise<std::vector<torrent_handle>> torrents;
+	ses.async_get_torrents([&](error_code const& ec, std::vector<torrent_handle> v)
+		{
+			TEST_CHECK(!ec);
+			torrents.set_value(std::move(v));
+		});
+	std::vector<torrent_handle> const all = torrents.get_future().get();
+	TEST_EQUAL(all.size(), 1);
+	TEST_CHECK(all.front() == h);
+
+	std::promise<torrent_handle> found;
+	ses.async_find_torrent(h.info_hashes().v1
+		, [&](error_code const&, torrent_handle th) { found.set_value(std::move(th)); });
+	TEST_CHECK(found.get_future().get() == h);
+
+	std::promise<torrent_status> status;
+	h.async_status(torrent_handle::query_name
+		, [&](error_code const&, torrent_status st) { status.set_value(std::move(st)); });
+	TEST_EQUAL(status.get_future().get().name, "async");
+
+	std::promise<std::vector<torrent_status>> batch;
+	std::vector<torrent_status> to_refresh(1);
+	to_refresh[0].handle = h;
+	ses.async_refresh_torrent_status(std::move(to_refresh), torrent_handle::query_name
+		, [&](error_code const&, std::vector<torrent_status> v) { batch.set_value(std::move(v)); });
+	std::vector<torrent_status> const refreshed = batch.get_future().get();
+	TEST_EQUAL(refreshed.size(), 1);
+	TEST_EQUAL(refreshed.front().name, "async");
+
+	std::promise<std::vector<announce_entry>> trackers;
+	h.async_trackers([&](error_code const&, std::vector<announce_entry> v)
+		{ trackers.set_value(std::move(v)); });
+	std::vector<announce_entry> const tr = trackers.get_future().get();
+	TEST_EQUAL(tr.size(), 1);
+	if (tr.size() == 1) TEST_EQUAL(tr.front().url, "http://127.0.0.1:1/announce");
+
+	std::promise<std::vector<peer_info>> peers;
+	h.async_get_peer_info([&](error_code const&, std::vector<peer_info> v)
+		{ peers.set_value(std::move(v)); });
+	TEST_CHECK(peers.get_future().get().empty());
+}
+
+TORRENT_TEST(async_queries_always_complete)
+{
+	// invalid handles complete the handler right away
+	std::promise<error_code> torrent_ec;
+	torrent_handle().async_status({}
+		, [&](error_code const& ec, torrent_status) { torrent_ec.set_value(ec); });
+	TEST_EQUAL(torrent_ec.get_future().get(), error_code(errors::invalid_torrent_handle));
+
+	std::promise<error_code> session_ec;
+	session_handle().async_get_torrents(
+		[&](error_code const& ec, std::vector<torrent_handle>) { session_ec.set_value(ec); });
+	TEST_EQUAL(session_ec.get_future().get(), error_code(errors::invalid_session_handle));
+
+	// a call that's still queued when the session shuts down is completed
+	// too, either with its result or with operation_aborted. Either way,
+	// exactly once
+	int calls = 0;
+	error_code result;
+	{
+		lt::session ses(settings());
+		ses.async_get_torrents([&](error_code const& ec, std::vector<torrent_handle>)
+			{
+				++calls;
+				result = ec;
+			});
+	}
+	TEST_EQUAL(calls, 1);
+	TEST_CHECK(!result || result == boost::asio::error::operation_aborted);
+}
+
+#ifndef TORRENT_DISABLE_LOGGING
+namespace {
+
+// waits until each of the torrents in refused, or num_torrents torrents if
+// it's empty, have been turned away by the web seed host limit once more
+bool wait_for_host_limit(lt::session& ses, std::map<torrent_handle, int>& refused
+	, int const num_torrents)
+{
+	std::map<torrent_handle, int> const before = refused;
+	auto const done = [&]
+	{
+		if (int(refused.size()) < num_torrents) return false;
+		for (auto const& r : refused)
+		{
+			auto const i = before.find(r.first);
+			if (i != before.end() && r.second <= i->second) return false;
+		}
+		return true;
+	};
+
+	time_point const end = clock_type::now() + seconds(30);
+	while (!done())
+	{
+		if (clock_type::now() > end) return false;
+		ses.wait_for_alert(seconds(1));
+		std::vector<alert*> alerts;
+		ses.pop_alerts(&alerts);
+		for (alert const* a : alerts)
+		{
+			auto const* la = alert_cast<torrent_log_alert>(a);
+			if (la == nullptr) continue;
+			if (std::strstr(la->log_message(), "web seed host connection limit reached") == nullptr)
+				continue;
+			++refused[la->handle];
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(web_seed_connections_per_host)
+{
+	// a web server that accepts connections but never responds, so the
+	// connections stay open
+	io_context ioc;
+	tcp::acceptor l(ioc);
+	l.open(tcp::v4());
+	l.bind(ep("127.0.0.1", 0));
+	l.listen();
+	std::string const url = "http://127.0.0.1:"
+		+ std::to_string(l.local_endpoint().port()) + "/";
+
+	lt::settings_pack pack = settings();
+	pack.set_int(settings_pack::max_web_seed_connections_per_host, 2);
+	lt::session ses(pack);
+
+	// all torrents are started at the same time, racing for the same host
+	for (int i = 0; i < 5; ++i)
+	{
+		file_storage fs;
+		fs.add_file("web_seed_host_limit/file" + std::to_string(i), 1024);
+		lt::create_torrent t(fs, 1024);
+		t.set_hash(0_piece, sha1_hash::max());
+		std::vector<char> buf;
+		bencode(std::back_inserter(buf), t.generate());
+
+		add_torrent_params p;
+		p.ti = std::make_shared<torrent_info>(buf, from_span);
+		p.save_path = ".";
+		p.url_seeds.push_back(url);
+		p.flags &= ~(torrent_flags::auto_managed | torrent_flags::paused);
+		ses.add_torrent(std::move(p));
+	}
+
+	// three of the torrents are turned away
+	std::map<torrent_handle, int> refused;
+	TEST_CHECK(wait_for_host_limit(ses, refused, 3));
+	TEST_EQUAL(int(refused.size()), 3);
+
+	// the other two connect
+	std::vector<tcp::socket> accepted;
+	for (int i = 0; i < 2; ++i)
+	{
+		tcp::socket s(ioc);
+		l.accept(s);
+		accepted.push_back(std::move(s));
+	}
+
+	// once the other torrents have been turned away again, with both
+	// connections established, there's still no third connection
+	TEST_CHECK(wait_for_host_limit(ses, refused, 3));
+	TEST_EQUAL(int(refused.size()), 3);
+
+	l.non_blocking(true);
+	tcp::socket s(ioc);
+	error_code ec;
+	l.accept(s, ec);
+	TEST_EQUAL(ec, error_code(boost::asio::error::would_block));
+}
+#endif
+
+namespace {
+
+std::shared_ptr<torrent_info> metadata_cache_torrent()
+{
+	file_storage fs;
+	fs.add_file("test_torrent_dir4/metadata_cache", 1024);
+	lt::create_torrent t(fs, 1024);
+	t.set_hash(0_piece, sha1_hash::max());
+	std::vector<char> buf;
+	bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<torrent_info>(buf, from_span);
+}
+
+void test_metadata_cache(int const cache_size, bool const expect_cached)
+{
+	auto const ti = metadata_cache_torrent();
+
+	lt::settings_pack pack = settings();
+	pack.set_int(settings_pack::metadata_cache_size, cache_size);
+	lt::session ses(pack);
+
+	add_torrent_params p;
+	p.info_hashes = ti->info_hashes();
+	p.save_path = ".";
+	p.flags &= ~torrent_flags::auto_managed;
+	p.flags |= torrent_flags::paused;
+
+	torrent_handle h = ses.add_torrent(p);
+	TEST_CHECK(!h.status().has_metadata);
+
+	// this is what happens when the metadata is downloaded from peers
+	TEST_CHECK(h.set_metadata(ti->info_section()));
+	TEST_CHECK(h.status().has_metadata);
+
+	ses.remove_torrent(h);
+	wait_for_alert(ses, torrent_removed_alert::alert_type, "ses");
+
+	h = ses.add_torrent(p);
+	TEST_EQUAL(h.status().has_metadata, expect_cached);
+	if (expect_cached)
+		TEST_CHECK(h.torrent_file()->info_section() == ti->info_section());
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(metadata_cache)
+{
+	test_metadata_cache(4 * 1024 * 1024, true);
+}
+
+TORRENT_TEST(metadata_cache_disabled)
+{
+	test_metadata_cache(0, false);
+}
+
+TORRENT_TEST(status_memory_usage)
+{
+	auto const ti = metadata_cache_torrent();
+
+	lt::session ses(settings());
+	add_torrent_params p;
+	p.ti = ti;
+	p.save_path = ".";
+	p.flags &= ~torrent_flags::auto_managed;
+	p.flags |= torrent_flags::paused;
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	torrent_status st = h.status({});
+	TEST_EQUAL(st.memory_metadata, 0);
+
+	// it's not included by default
+	st = h.status();
+	TEST_EQUAL(st.memory_metadata, 0);
+
+	st = h.status(torrent_handle::query_memory_usage);
+	TEST_CHECK(st.memory_metadata >= ti->metadata_size());
+	TEST_CHECK(st.memory_peer_list >= 0);
+
+	// any mask with the bit set includes it
+	torrent_status const st2 = h.status(status_flags_t::all()
+		& ~torrent_handle::query_pieces);
+	TEST_EQUAL(st2.memory_metadata, st.memory_metadata);
+
+	// the session counters include this torrent's metadata
+	ses.post_session_stats();
+	alert const* a = wait_for_alert(ses, session_stats_alert::alert_type, "ses");
+	TEST_CHECK(a);
+	if (a == nullptr) return;
+	auto const* stats = alert_cast<session_stats_alert>(a);
+	int const idx = find_metric_idx("ses.torrent_memory_metadata");
+	TEST_CHECK(idx >= 0);
+	if (idx < 0) return;
+	TEST_EQUAL(stats->counters()[idx], st.memory_metadata);
+}
+
+TORRENT_TEST(shed_idle_peer_list)
+{
+	auto const ti = metadata_cache_torrent();
+
+	// seed-mode only checks the file sizes, the torrent needs its file on
+	// disk to be considered finished
+	error_code ec;
+	create_directory("test_torrent_dir4", ec);
+	TEST_CHECK(!ec);
+	std::ofstream("test_torrent_dir4/metadata_cache", std::ios::binary)
+		<< std::string(1024, '\0');
+
+	lt::settings_pack pack = settings();
+	pack.set_int(settings_pack::shed_peer_list_timeout, 1);
+	// keep the torrent queued
+	pack.set_int(settings_pack::active_seeds, 0);
+	pack.set_int(settings_pack::active_limit, 0);
+	lt::session ses(pack);
+
+	add_torrent_params p;
+	p.ti = ti;
+	p.save_path = ".";
+	p.flags |= torrent_flags::seed_mode | torrent_flags::auto_managed
+		| torrent_flags::paused;
+	p.peers.push_back(ep("10.0.0.1", 6881));
+	p.peers.push_back(ep("10.0.0.2", 6881));
+	p.banned_peers.push_back(ep("10.0.0.3", 6881));
+	torrent_handle h = ses.add_torrent(std::move(p));
+
+	torrent_status st;
+	for (int i = 0; i < 100; ++i)
+	{
+		st = h.status();
+		if (st.peer_list_shed) break;
+		std::this_thread::sleep_for(lt::milliseconds(100));
+	}
+	TEST_CHECK(st.peer_list_shed);
+	TEST_EQUAL(st.list_peers, 0);
+
+	// the peers are still saved in the resume data
+	h.save_resume_data();
+	alert const* a = wait_for_alert(ses, save_resume_data_alert::alert_type, "ses");
+	TEST_CHECK(a);
+	if (a == nullptr) return;
+	add_torrent_params const& rd = alert_cast<save_resume_data_alert>(a)->params;
+	TEST_EQUAL(rd.peers.size(), 2);
+	TEST_EQUAL(rd.banned_peers.size(), 1);
+
+	// adding a peer restores the peer list
+	h.connect_peer(ep("10.0.0.4", 6881));
+	st = h.status();
+	TEST_CHECK(!st.peer_list_shed);
+	TEST_EQUAL(st.list_peers, 4);
+}
+
 namespace {
 
 void test_queue(add_torrent_params const& atp)
@@ -89,6 +89,15 @@ TORRENT_TEST(mutable_torrents)
 
 	TEST_CHECK(similar == ti.similar_torrents());
 	TEST_CHECK(collections == ti.collections());
+
+	// info() only decodes the value of the key it looks up
+	bdecode_node const c = ti.info("collections");
+	TEST_EQUAL(c.type(), bdecode_node::list_t);
+	TEST_EQUAL(c.list_size(), 2);
+	TEST_EQUAL(c.list_string_value_at(1), "collection2");
+	TEST_EQUAL(ti.info("similar").list_size(), 2);
+	TEST_EQUAL(ti.info("piece length").int_value(), 0x4000);
+	TEST_CHECK(!ti.info("no-such-key"));
 }
 #endif
 
@@ -34,6 +34,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "test.hpp"
 #include "libtorrent/aux_/torrent_list.hpp"
 #include "libtorrent/sha1_hash.hpp"
+#include "libtorrent/hasher.hpp"
+
+#include <vector>
 
 using namespace lt;
 
@@ -247,3 +250,106 @@ TORRENT_TEST(torrent_list_obfuscated_lookup)
 }
 #endif
 
+
+TORRENT_TEST(torrent_list_many)
+{
+	aux::torrent_list<int> l;
+	std::vector<sha1_hash> hashes;
+	for (int i = 0; i < 2000; ++i)
+	{
+		hasher h;
+		h.update(reinterpret_cast<char const*>(&i), sizeof(i));
+		hashes.push_back(h.final());
+		TEST_CHECK(l.insert(ih(hashes.back()), std::make_shared<int>(i)));
+	}
+	TEST_EQUAL(l.size(), 2000);
+
+	// erase every other torrent, moving others around in the array
+	for (int i = 0; i < 2000; i += 2)
+		TEST_CHECK(l.erase(ih(hashes[std::size_t(i)])));
+	TEST_EQUAL(l.size(), 1000);
+
+	for (int i = 0; i < 2000; ++i)
+	{
+		int const* t = l.find(hashes[std::size_t(i)]);
+		if (i & 1)
+		{
+			TEST_CHECK(t != nullptr);
+			if (t) TEST_EQUAL(*t, i);
+		}
+		else
+		{
+			TEST_CHECK(t == nullptr);
+		}
+	}
+
+	for (int i = 1; i < 2000; i += 2)
+		TEST_CHECK(l.erase(ih(hashes[std::size_t(i)])));
+	TEST_CHECK(l.empty());
+	TEST_CHECK(l.find(hashes[1]) == nullptr);
+}
+
+TORRENT_TEST(torrent_list_erase_hybrid)
+{
+	aux::torrent_list<int> l;
+	l.insert(hybrid, std::make_shared<int>(1337));
+
+	// erasing by one of the hashes removes all of them
+	TEST_CHECK(l.erase(v1));
+	TEST_CHECK(l.empty());
+	TEST_CHECK(l.find(sha1_1) == nullptr);
+	TEST_CHECK(l.find(sha2_1_truncated) == nullptr);
+}
+
+TORRENT_TEST(torrent_list_update_info_hash)
+{
+	aux::torrent_list<int> l;
+	l.insert(ih(sha1_2), std::make_shared<int>(1));
+	l.insert(v1, std::make_shared<int>(1337));
+	l.insert(ih(sha1_3), std::make_shared<int>(2));
+
+	// the torrent learns its v2 info-hash
+	TEST_CHECK(l.update_info_hash(v1, hybrid));
+	TEST_EQUAL(*l.find(sha1_1), 1337);
+	TEST_EQUAL(*l.find(sha2_1_truncated), 1337);
+
+	// it keeps its position in the list
+	TEST_EQUAL(*l[1], 1337);
+
+	// the new hash can't collide with another torrent
+	TEST_CHECK(!l.update_info_hash(ih(sha1_3), hybrid));
+	TEST_CHECK(!l.update_info_hash(ih(sha1_4), ih(sha1_4)));
+
+	TEST_CHECK(l.update_info_hash(hybrid, v2));
+	TEST_CHECK(l.find(sha1_1) == nullptr);
+	TEST_EQUAL(*l.find(sha2_1_truncated), 1337);
+	TEST_EQUAL(l.size(), 3);
+}
+
+#if !defined TORRENT_DISABLE_ENCRYPTION
+TORRENT_TEST(torrent_list_obfuscated_version)
+{
+	auto obfuscate = [](sha1_hash const& hash)
+	{
+		static char const req2[4] = {'r', 'e', 'q', '2'};
+		hasher h(req2);
+		h.update(hash);
+		return h.final();
+	};
+
+	aux::torrent_list<int> l;
+	l.insert(hybrid, std::make_shared<int>(1337));
+
+	protocol_version v = protocol_version::V2;
+	TEST_EQUAL(*l.find_obfuscated(obfuscate(sha1_1), &v), 1337);
+	TEST_CHECK(v == protocol_version::V1);
+	TEST_EQUAL(*l.find_obfuscated(obfuscate(sha2_1_truncated), &v), 1337);
+	TEST_CHECK(v == protocol_version::V2);
+
+	// after updating the info-hash, the obfuscated index follows
+	TEST_CHECK(l.update_info_hash(hybrid, v1));
+	TEST_CHECK(l.find_obfuscated(obfuscate(sha2_1_truncated)) == nullptr);
+	TEST_EQUAL(*l.find_obfuscated(obfuscate(sha1_1), &v), 1337);
+	TEST_CHECK(v == protocol_version::V1);
+}
+#endif
@@ -0,0 +1,188 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "test.hpp"
+#include "libtorrent/aux_/web_request_queue.hpp"
+#include "libtorrent/aux_/path.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace lt;
+
+namespace {
+
+using request = aux::web_file_request;
+
+// piece length 0x8000. "a" is pieces 0-1, the pad file piece 2 and "b"
+// pieces 3-4
+file_storage padded_storage()
+{
+	file_storage fs;
+	fs.set_piece_length(0x8000);
+	fs.add_file(combine_path("test", "a"), 0x10000);
+	fs.add_file(combine_path("test", ".pad"), 0x8000, file_storage::flag_pad_file);
+	fs.add_file(combine_path("test", "b"), 0x10000);
+	fs.set_num_pieces(aux::calc_num_pieces(fs));
+	return fs;
+}
+
+peer_request block(int const piece, int const start)
+{
+	return peer_request{piece_index_t(piece), start, 0x4000};
+}
+
+void check(std::vector<request> const& reqs, std::vector<request> const& expected)
+{
+	TEST_EQUAL(reqs.size(), expected.size());
+	for (std::size_t i = 0; i < std::min(reqs.size(), expected.size()); ++i)
+	{
+		TEST_EQUAL(reqs[i].file_index, expected[i].file_index);
+		TEST_EQUAL(reqs[i].start, expected[i].start);
+		TEST_EQUAL(reqs[i].length, expected[i].length);
+	}
+}
+
+} // anonymous namespace
+
+TORRENT_TEST(merge_adjacent)
+{
+	file_storage const fs = padded_storage();
+	aux::web_request_queue q;
+	q.push_back(block(0, 0));
+	q.push_back(block(0, 0x4000));
+	q.push_back(block(1, 0));
+	TEST_CHECK(!q.empty());
+
+	check(q.flush(fs), {{file_index_t(0), 0xc000, 0}});
+	TEST_CHECK(q.empty());
+	TEST_CHECK(q.flush(fs).empty());
+}
+
+TORRENT_TEST(gap)
+{
+	file_storage const fs = padded_storage();
+	aux::web_request_queue q;
+	q.push_back(block(0, 0));
+	q.push_back(block(1, 0));
+	// not in order
+	q.push_back(block(0, 0x4000));
+
+	check(q.flush(fs), {
+		{file_index_t(0), 0x4000, 0},
+		{file_index_t(0), 0x4000, 0x8000},
+		{file_index_t(0), 0x4000, 0x4000}});
+}
+
+TORRENT_TEST(file_boundary)
+{
+	file_storage fs;
+	fs.set_piece_length(0x4000);
+	fs.add_file(combine_path("test", "a"), 0x6000);
+	fs.add_file(combine_path("test", "b"), 0x6000);
+	fs.set_num_pieces(aux::calc_num_pieces(fs));
+
+	aux::web_request_queue q;
+	q.push_back(block(0, 0));
+	// this block spans both files
+	q.push_back(block(1, 0));
+	q.push_back({piece_index_t(2), 0, 0x4000});
+
+	check(q.flush(fs), {
+		{file_index_t(0), 0x6000, 0},
+		{file_index_t(1), 0x6000, 0}});
+}
+
+TORRENT_TEST(pad_file)
+{
+	file_storage const fs = padded_storage();
+	aux::web_request_queue q;
+	q.push_back(block(1, 0x4000));
+	q.push_back(block(2, 0));
+	q.push_back(block(2, 0x4000));
+	q.push_back(block(3, 0));
+
+	// the ranges of the pad file are neither merged with each other, nor with
+	// the files around it
+	check(q.flush(fs), {
+		{file_index_t(0), 0x4000, 0xc000},
+		{file_index_t(1), 0x4000, 0},
+		{file_index_t(1), 0x4000, 0x4000},
+		{file_index_t(2), 0x4000, 0}});
+}
+
+TORRENT_TEST(single_file)
+{
+	file_storage fs;
+	fs.set_piece_length(0x8000);
+	fs.add_file(combine_path("test", "a"), 0x18000);
+	fs.set_num_pieces(aux::calc_num_pieces(fs));
+
+	aux::web_request_queue q;
+	q.push_back(block(1, 0x4000));
+	q.push_back(block(2, 0));
+	// a request that only covers the end of a block, e.g. because we have
+	// restart data for the start of it
+	q.push_back({piece_index_t(2), 0x5000, 0x3000});
+
+	check(q.flush(fs), {
+		{file_index_t(0), 0x8000, 0xc000},
+		{file_index_t(0), 0x3000, 0x15000}});
+}
+
+TORRENT_TEST(cancel)
+{
+	file_storage const fs = padded_storage();
+	aux::web_request_queue q;
+	q.push_back(block(0, 0));
+	q.push_back(block(0, 0x4000));
+	q.push_back(block(1, 0));
+
+	// requests not in the queue can't be cancelled
+	TEST_CHECK(!q.cancel(block(3, 0)));
+
+	TEST_CHECK(q.cancel(block(0, 0x4000)));
+	TEST_CHECK(!q.cancel(block(0, 0x4000)));
+
+	// with the middle block gone, the others aren't adjacent anymore
+	check(q.flush(fs), {
+		{file_index_t(0), 0x4000, 0},
+		{file_index_t(0), 0x4000, 0x8000}});
+
+	// once sent, it's too late
+	TEST_CHECK(!q.cancel(block(0, 0)));
+
+	q.push_back(block(4, 0));
+	TEST_CHECK(q.cancel(block(4, 0)));
+	TEST_CHECK(q.empty());
+	TEST_CHECK(q.flush(fs).empty());
+}
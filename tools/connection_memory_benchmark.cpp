@@ -0,0 +1,214 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "libtorrent/session.hpp"
+#include "libtorrent/settings_pack.hpp"
+#include "libtorrent/create_torrent.hpp"
+#include "libtorrent/torrent_info.hpp"
+#include "libtorrent/add_torrent_params.hpp"
+#include "libtorrent/torrent_status.hpp"
+#include "libtorrent/bencode.hpp"
+#include "libtorrent/socket.hpp"
+#include "libtorrent/io_context.hpp"
+#include "libtorrent/peer_connection.hpp"
+#include "libtorrent/bt_peer_connection.hpp"
+
+#if defined __GLIBC__ && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define TORRENT_HAS_MALLINFO2 1
+#else
+#define TORRENT_HAS_MALLINFO2 0
+#endif
+
+// measures the memory cost of idle peer connections. A session with a single
+// torrent accepts a number of plain BitTorrent connections from localhost.
+// Once they have completed the handshake they are left idle, and the heap
+// growth per connection is reported, along with the size of the connection
+// objects themselves.
+
+using namespace std::literals::chrono_literals;
+
+namespace {
+
+std::int64_t heap_in_use()
+{
+#if TORRENT_HAS_MALLINFO2
+	return std::int64_t(::mallinfo2().uordblks);
+#else
+	return -1;
+#endif
+}
+
+std::shared_ptr<lt::torrent_info> make_torrent()
+{
+	lt::file_storage fs;
+	fs.add_file("connection_memory_benchmark", 16 * 1024 * 1024);
+	lt::create_torrent t(fs, 1024 * 1024);
+	for (auto const i : fs.piece_range())
+		t.set_hash(i, lt::sha1_hash::max());
+	std::vector<char> buf;
+	lt::bencode(std::back_inserter(buf), t.generate());
+	return std::make_shared<lt::torrent_info>(buf, lt::from_span);
+}
+
+int num_peers(lt::torrent_handle const& h)
+{
+	return h.status({}).num_peers;
+}
+
+bool wait_for_peers(lt::torrent_handle const& h, int const num)
+{
+	for (int i = 0; i < 300; ++i)
+	{
+		if (num_peers(h) >= num) return true;
+		std::this_thread::sleep_for(100ms);
+	}
+	return false;
+}
+
+}
+
+int main(int argc, char const* argv[])
+{
+	int num_connections = 500;
+	if (argc > 1) num_connections = std::atoi(argv[1]);
+	if (num_connections <= 0)
+	{
+		std::cerr << "usage: connection_memory_benchmark [connections]\n";
+		return 1;
+	}
+
+	std::printf("sizeof(peer_connection): %d\nsizeof(bt_peer_connection): %d\n"
+		, int(sizeof(lt::peer_connection)), int(sizeof(lt::bt_peer_connection)));
+
+	lt::settings_pack pack;
+	pack.set_str(lt::settings_pack::listen_interfaces, "127.0.0.1:0");
+	pack.set_bool(lt::settings_pack::enable_dht, false);
+	pack.set_bool(lt::settings_pack::enable_lsd, false);
+	pack.set_bool(lt::settings_pack::enable_upnp, false);
+	pack.set_bool(lt::settings_pack::enable_natpmp, false);
+	pack.set_bool(lt::settings_pack::enable_incoming_utp, false);
+	pack.set_bool(lt::settings_pack::enable_outgoing_utp, false);
+	pack.set_bool(lt::settings_pack::allow_multiple_connections_per_ip, true);
+	// connections from localhost count 1.5 times against the limit
+	pack.set_int(lt::settings_pack::connections_limit, num_connections * 2 + 100);
+	pack.set_int(lt::settings_pack::alert_mask, 0);
+	lt::session ses(pack);
+
+	lt::add_torrent_params p;
+	p.ti = make_torrent();
+	p.save_path = ".";
+	p.flags &= ~lt::torrent_flags::auto_managed;
+	p.flags &= ~lt::torrent_flags::paused;
+	p.max_connections = num_connections * 2 + 100;
+	lt::torrent_handle h = ses.add_torrent(std::move(p));
+	lt::sha1_hash const ih = h.info_hashes().get_best();
+
+	int port = 0;
+	for (int i = 0; i < 100 && port == 0; ++i)
+	{
+		port = ses.listen_port();
+		if (port == 0) std::this_thread::sleep_for(100ms);
+	}
+	if (port == 0)
+	{
+		std::cerr << "session failed to listen\n";
+		return 1;
+	}
+
+	// open our end of the connections up-front, so that their memory isn't
+	// attributed to the session
+	lt::io_context ios;
+	lt::tcp::endpoint const ep(lt::make_address_v4("127.0.0.1"), std::uint16_t(port));
+	std::vector<lt::tcp::socket> peers;
+	peers.reserve(std::size_t(num_connections));
+	for (int i = 0; i < num_connections; ++i)
+	{
+		peers.emplace_back(ios);
+		peers.back().open(lt::tcp::v4());
+	}
+
+	// let the session settle before taking the baseline
+	std::this_thread::sleep_for(1s);
+	std::int64_t const heap_before = heap_in_use();
+
+	for (int i = 0; i < num_connections; ++i)
+	{
+		char handshake[68] = "\x13" "BitTorrent protocol";
+		std::memset(handshake + 20, 0, 8);
+		std::memcpy(handshake + 28, ih.data(), 20);
+		std::snprintf(handshake + 48, 21, "-CM0001-%012d", i);
+
+		lt::error_code ec;
+		auto& s = peers[std::size_t(i)];
+		s.connect(ep, ec);
+		if (!ec) boost::asio::write(s, boost::asio::buffer(handshake, 68), ec);
+		if (!ec) boost::asio::read(s, boost::asio::buffer(handshake, 68), ec);
+		if (ec)
+		{
+			std::cerr << "connection " << i << " failed: " << ec.message() << '\n';
+			return 1;
+		}
+	}
+
+	if (!wait_for_peers(h, num_connections))
+	{
+		std::cerr << "only " << num_peers(h) << " out of " << num_connections
+			<< " connections were accepted\n";
+		return 1;
+	}
+
+	// give the connections time to go idle
+	std::this_thread::sleep_for(2s);
+	std::int64_t const heap_after = heap_in_use();
+
+	std::printf("connections: %d\n", num_connections);
+	if (heap_before >= 0)
+	{
+		std::printf("heap per idle connection: %.0f bytes\n"
+			, double(heap_after - heap_before) / num_connections);
+	}
+	else
+	{
+		std::printf("heap usage not available on this platform\n");
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+
+Copyright (c) 2026, Arvid Norberg
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in
+      the documentation and/or other materials provided with the distribution.
+    * Neither the name of the author nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+#include "libtorrent/config.hpp"
+#include "libtorrent/time.hpp"
+#include "libtorrent/hasher.hpp"
+#include "libtorrent/info_hash.hpp"
+#include "libtorrent/aux_/torrent_list.hpp"
+
+#if !defined TORRENT_DISABLE_ENCRYPTION
+#include "libtorrent/pe_crypto.hpp"
+#endif
+
+// measures the cost of the part of an incoming encrypted handshake that
+// depends on the number of torrents in the session: looking up the torrent
+// by the obfuscated info-hash the initiating side sends. The Diffie-Hellman
+// key exchange, which doesn't depend on the number of torrents, is measured
+// separately for reference.
+
+namespace {
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+#if !defined TORRENT_DISABLE_ENCRYPTION
+
+lt::sha1_hash make_hash(std::uint64_t const n)
+{
+	lt::hasher h;
+	h.update({reinterpret_cast<char const*>(&n), sizeof(n)});
+	return h.final();
+}
+
+lt::sha1_hash tagged_hash(char const (&tag)[5], lt::sha1_hash const& h)
+{
+	lt::hasher ret(tag, 4);
+	ret.update(h);
+	return ret.final();
+}
+
+void run_test(int const num_torrents, int const num_handshakes)
+{
+	std::vector<lt::info_hash_t> hashes;
+	std::vector<std::shared_ptr<int>> torrents;
+	hashes.reserve(std::size_t(num_torrents));
+	torrents.reserve(std::size_t(num_torrents));
+	for (int i = 0; i < num_torrents; ++i)
+	{
+		// every other torrent is a hybrid torrent
+		if (i & 1)
+		{
+			lt::sha1_hash const v1 = make_hash(std::uint64_t(i));
+			lt::sha1_hash const v2a = make_hash(std::uint64_t(i) | (1ULL << 40));
+			lt::sha1_hash const v2b = make_hash(std::uint64_t(i) | (1ULL << 41));
+			lt::sha256_hash v2;
+			std::memcpy(v2.data(), v2a.data(), 20);
+			std::memcpy(v2.data() + 20, v2b.data(), 12);
+			hashes.emplace_back(v1, v2);
+		}
+		else
+		{
+			hashes.emplace_back(make_hash(std::uint64_t(i)));
+		}
+		torrents.push_back(std::make_shared<int>(i));
+	}
+
+	// the handshakes, as they arrive on the wire. The responding side first
+	// derives SHA1("req3", S) from the shared secret, and XORs it with the
+	// received hash to get SHA1("req2", info-hash)
+	std::mt19937 rng(num_torrents);
+	std::vector<lt::sha1_hash> secrets;
+	std::vector<lt::sha1_hash> received;
+	secrets.reserve(std::size_t(num_handshakes));
+	received.reserve(std::size_t(num_handshakes));
+	for (int i = 0; i < num_handshakes; ++i)
+	{
+		auto const t = std::uniform_int_distribution<int>(0, num_torrents - 1)(rng);
+		lt::sha1_hash const secret = make_hash(std::uint64_t(rng()) << 32 | rng());
+		secrets.push_back(secret);
+		received.push_back(tagged_hash("req2", hashes[std::size_t(t)].get_best())
+			^ tagged_hash("req3", secret));
+	}
+
+	lt::aux::torrent_list<int> list;
+	auto const start_add = lt::clock_type::now();
+	for (int i = 0; i < num_torrents; ++i)
+		list.insert(hashes[std::size_t(i)], torrents[std::size_t(i)]);
+	auto const add_time = lt::clock_type::now() - start_add;
+
+	int found = 0;
+	auto const start_lookup = lt::clock_type::now();
+	for (int i = 0; i < num_handshakes; ++i)
+	{
+		lt::sha1_hash const obfuscated = received[std::size_t(i)]
+			^ tagged_hash("req3", secrets[std::size_t(i)]);
+		if (list.find_obfuscated(obfuscated) != nullptr) ++found;
+	}
+	auto const lookup_time = lt::clock_type::now() - start_lookup;
+
+	if (found != num_handshakes)
+	{
+		std::cerr << "only found " << found << " out of " << num_handshakes << " torrents\n";
+		std::exit(1);
+	}
+
+	std::printf("%10d torrents: add: %7.0f ns/torrent  handshake lookup: %6.0f ns\n"
+		, num_torrents
+		, double(duration_cast<nanoseconds>(add_time).count()) / num_torrents
+		, double(duration_cast<nanoseconds>(lookup_time).count()) / num_handshakes);
+}
+
+void run_dh_test(int const num_handshakes)
+{
+	lt::dh_key_exchange remote;
+	auto const start = lt::clock_type::now();
+	for (int i = 0; i < num_handshakes; ++i)
+	{
+		lt::dh_key_exchange local;
+		local.compute_secret(remote.get_local_key());
+	}
+	auto const dh_time = lt::clock_type::now() - start;
+	std::printf("DH key exchange: %.0f ns/handshake\n"
+		, double(duration_cast<nanoseconds>(dh_time).count()) / num_handshakes);
+}
+#endif
+
+}
+
+int main(int argc, char const* argv[])
+{
+#if defined TORRENT_DISABLE_ENCRYPTION
+	TORRENT_UNUSED(argc);
+	TORRENT_UNUSED(argv);
+	std::cerr << "built without encryption support\n";
+	return 1;
+#else
+	int max_torrents = 1000000;
+	int num_handshakes = 1000000;
+	if (argc > 1) max_torrents = std::atoi(argv[1]);
+	if (argc > 2) num_handshakes = std::atoi(argv[2]);
+	if (max_torrents <= 0 || num_handshakes <= 0)
+	{
+		std::cerr << "usage: handshake_benchmark [max-torrents] [handshakes]\n";
+		return 1;
+	}
+
+	for (int n = 1000; n <= max_torrents; n *= 10)
+		run_test(n, num_handshakes);
+
+	run_dh_test(std::min(num_handshakes, 1000));
+	return 0;
+#endif
+}